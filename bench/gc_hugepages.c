@@ -0,0 +1,90 @@
+#include "../tests/harness.h"
+
+/*
+   a collection-heavy workload for comparing the heap with and without --huge-pages.
+
+   A ring of lists is kept on the stack and entries are replaced at random, so most of what is
+   allocated dies young but every collection still has a large, scattered live set to copy.
+   Run it under perf to see the TLB side:
+
+     perf stat -e dTLB-load-misses,dTLB-store-misses ./gc_hugepages [--huge-pages] [--gc-threads=n] [rounds]
+ */
+
+#define NLISTS   4096
+#define LISTLEN  256
+#define NROUNDS  200000
+
+static val_t mk_range(size_t n, rint_t from)
+{
+  val_t out = R_NIL;
+
+  while (n--)
+    out = (val_t)mk_pair(fixnum(from + (rint_t)n),out);
+
+  return out;
+}
+
+int main(int argc, char** argv)
+{
+  size_t nrounds = NROUNDS;
+
+  for (int i = 1; i < argc; i++)
+    {
+      if (!strcmp(argv[i],"--huge-pages"))
+	HEAP_HUGEPAGES = true;
+
+      else if (!strncmp(argv[i],"--gc-threads=",13))
+	GC_NTHREADS = max(atoi(argv[i]+13),1);
+
+      else
+	nrounds = strtoul(argv[i],NULL,10);
+    }
+
+  hn_init();
+
+  val_t base = pushn(NLISTS);
+
+  for (size_t i = 1; i <= NLISTS; i++)
+    *stack_ref(base + i) = R_NIL;
+
+  uint64_t seed = 88172645463325252ull;
+  double t0 = hn_clock();
+
+  for (size_t r = 0; r < nrounds; r++)
+    {
+      seed ^= seed << 13;
+      seed ^= seed >> 7;
+      seed ^= seed << 17;
+
+      val_t l = mk_range(LISTLEN,(rint_t)r);
+      *stack_ref(base + 1 + seed % NLISTS) = l;
+    }
+
+  double elapsed = hn_clock() - t0;
+
+  // every surviving list still has to count up from its first element
+  size_t broken = 0;
+
+  for (size_t i = 1; i <= NLISTS; i++)
+    {
+      val_t l = *stack_ref(base + i);
+      size_t n = 0;
+
+      for (rint_t first = l ? ival(car_(l)) : 0; l; l = cdr_(l), n++)
+	broken += ival(car_(l)) != first + (rint_t)n;
+
+      broken += n && n != LISTLEN;
+    }
+
+  printf("huge pages:   %s\n", HEAP_HUGEPAGES ? "on" : "off");
+  printf("rounds:       %zu (%zu pairs each)\n", nrounds, (size_t)LISTLEN);
+  printf("elapsed:      %.3f s\n", elapsed);
+  printf("collections:  %" PRIu64 "\n", GC_STATS.cycle);
+  printf("gc pause:     %.3f s\n", GC_TOTAL_PAUSE);
+  printf("copied:       %zu MB\n", GC_TOTAL_COPIED >> 20);
+
+  if (broken)
+    fprintf(stderr,"%zu cells were corrupted\n", broken);
+
+  return broken != 0;
+}
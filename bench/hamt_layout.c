@@ -0,0 +1,118 @@
+#include "../tests/harness.h"
+
+/*
+   the CHAMP table layout: memory per entry and lookup latency for a table of fixnum bindings.
+
+   The same keys are loaded three ways - by hamt_build, by persistent hamt_put and by hamt_put
+   under one transient (whose nodes keep room to grow) - and each table's nodes are counted at
+   the size the allocator gives them. Lookups are timed over a shuffled order of the keys, half
+   of them present.
+
+     ./hamt_layout [entries] [lookups]
+ */
+
+#define NENTRIES (1ul << 20)
+#define NLOOKUPS (1ul << 22)
+
+static uint64_t SEED = 88172645463325252ull;
+
+static uint64_t xorshift(void)
+{
+  SEED ^= SEED << 13;
+  SEED ^= SEED >> 7;
+  SEED ^= SEED << 17;
+  return SEED;
+}
+
+// bytes allocated for the nodes under n, and the number of nodes
+static size_t nd_bytes(val_t n, size_t* nn)
+{
+  bvec_t* nb = ptr(bvec_t*,n);
+  size_t out = calc_mem_size(BVEC_HDR_SZ + nb->bv_cap * 8), nsub = popcnt(nb->bv_nmap);
+  val_t* subs = nb->bv_elements + popcnt(nb->bv_bmap) * nb->bv_width;
+
+  (*nn)++;
+
+  // below the last level the node is a collision run with no subnodes
+  for (size_t i = 0; i < nsub; i++)
+    out += nd_bytes(subs[i],nn);
+
+  return out;
+}
+
+static void report(const chr_t* name, val_t root, size_t n, double build)
+{
+  size_t nn = 0, nb = nd_bytes(root,&nn);
+
+  printf("%-10s %8.1f bytes/entry  %8zu nodes  %7.1f ns/insert\n",
+	 name, (double)nb / n, nn, build * 1e9 / n);
+}
+
+static double lookups(val_t root, const val_t* keys, size_t n, size_t nl)
+{
+  size_t hits = 0;
+  double t0 = hn_clock();
+
+  for (size_t i = 0; i < nl; i++)
+    hits += hamt_search(root,keys[i % (2 * n)]) != NULL;
+
+  double ns = (hn_clock() - t0) * 1e9 / nl;
+
+  if (hits != nl / 2 + (nl % 2))
+    fprintf(stderr,"lookup found %zu of %zu keys\n",hits,nl);
+
+  return ns;
+}
+
+int main(int argc, char** argv)
+{
+  size_t n  = argc > 1 ? strtoul(argv[1],NULL,10) : NENTRIES;
+  size_t nl = argc > 2 ? strtoul(argv[2],NULL,10) : NLOOKUPS;
+
+  // the tables are only held in C locals
+  GC_AUTO = false;
+  hn_init();
+
+  // the first n keys go in the tables; the probe order interleaves them with n absent keys
+  val_t* keys  = vm_cmalloc(n * sizeof(val_t)), *vals = vm_cmalloc(n * sizeof(val_t));
+  val_t* probe = vm_cmalloc(2 * n * sizeof(val_t));
+
+  for (size_t i = 0; i < n; i++)
+    {
+      keys[i] = fixnum(xorshift() >> 8);
+      vals[i] = fixnum(i);
+    }
+
+  for (size_t i = 0; i < n; i++)
+    {
+      probe[2*i]   = keys[xorshift() % n];
+      probe[2*i+1] = fixnum(-(rint_t)i - 1);
+    }
+
+  size_t nk;
+  double t0 = hn_clock();
+  val_t bulk = hamt_build(keys,vals,n,BINDINGS,&nk);
+  report("build",bulk,nk,hn_clock() - t0);
+
+  val_t pers = (val_t)mk_hamt_nd(1,32,BINDINGS) | OBJECT;
+  t0 = hn_clock();
+
+  for (size_t i = 0; i < n; i++)
+    hamt_put(&pers,keys[i],vals[i],BINDINGS,0,NULL);
+
+  report("persistent",pers,nk,hn_clock() - t0);
+
+  val_t trans = (val_t)mk_hamt_nd(1,32,BINDINGS) | OBJECT;
+  uint64_t edit = hamt_transient();
+  t0 = hn_clock();
+
+  for (size_t i = 0; i < n; i++)
+    hamt_put(&trans,keys[i],vals[i],BINDINGS,edit,NULL);
+
+  report("transient",trans,nk,hn_clock() - t0);
+
+  printf("lookup     %8.1f ns (build)  %8.1f ns (persistent)  %8.1f ns (transient)\n",
+	 lookups(bulk,probe,n,nl), lookups(pers,probe,n,nl), lookups(trans,probe,n,nl));
+
+  return 0;
+}
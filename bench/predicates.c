@@ -0,0 +1,96 @@
+#include "../tests/harness.h"
+
+/*
+   type predicate throughput over a mix of immediate and heap values.
+
+   Each predicate is run over the same shuffled array of fixnums, flonums, immediate and heap
+   strings, bignums, boxed floats and list cells. The generic rows go through the type table
+   (val_type) the way every predicate did before dispatch moved onto the tag bits, for comparison.
+ */
+
+#define NVALS   4096
+#define NPASSES 20000
+
+static val_t VALS[NVALS];
+
+static bool generic_isstr(val_t v)   { return val_type(v)->tp_tpkey == STRING; }
+static bool generic_isint(val_t v)   { return val_type(v)->tp_tpkey == INTEGER || val_type(v)->tp_tpkey == BIGNUM; }
+static bool generic_isfloat(val_t v) { return val_type(v)->tp_tpkey == FLOAT; }
+
+static bool pred_tpkey(val_t v)     { return tpkey(v) == STRING; }
+static bool pred_isstr(val_t v)     { return isstr(v); }
+static bool pred_isheapstr(val_t v) { return isheapstr(v); }
+static bool pred_isint(val_t v)     { return isint(v); }
+static bool pred_isfloat(val_t v)   { return isfloat(v); }
+
+static const struct
+{
+  const chr_t* name;
+  bool (*pred)(val_t);
+} PREDICATES[] =
+  {
+    { "tpkey(v) == STRING", pred_tpkey      },
+    { "isstr",              pred_isstr      },
+    { "isheapstr",          pred_isheapstr  },
+    { "isint",              pred_isint      },
+    { "isfloat",            pred_isfloat    },
+    { "generic isstr",      generic_isstr   },
+    { "generic isint",      generic_isint   },
+    { "generic isfloat",    generic_isfloat },
+  };
+
+static val_t mk_value(size_t i)
+{
+  switch (i % 7)
+    {
+    case 0:  return fixnum(i);
+    case 1:  return mk_float(i * 0.5);
+    case 2:  return mk_str("short");
+    case 3:  return mk_str("a string that has to live on the heap");
+    case 4:  return mk_int(FIXNUM_MAX + (rint_t)i);
+    case 5:  return mk_float(1e300);
+    default: return (val_t)mk_pair(fixnum(i),R_NIL);
+    }
+}
+
+int main(int argc, char** argv)
+{
+  size_t npasses = argc > 1 ? strtoul(argv[1],NULL,10) : NPASSES;
+
+  // nothing may move while the values are only held in a C array
+  GC_AUTO = false;
+  hn_init();
+
+  for (size_t i = 0; i < NVALS; i++)
+    VALS[i] = mk_value(i);
+
+  uint64_t seed = 88172645463325252ull;
+
+  for (size_t i = NVALS - 1; i; i--)
+    {
+      seed ^= seed << 13;
+      seed ^= seed >> 7;
+      seed ^= seed << 17;
+
+      size_t j = seed % (i + 1);
+      val_t tmp = VALS[i];
+      VALS[i] = VALS[j];
+      VALS[j] = tmp;
+    }
+
+  for (size_t p = 0; p < sizeof(PREDICATES) / sizeof(PREDICATES[0]); p++)
+    {
+      bool (*pred)(val_t) = PREDICATES[p].pred;
+      size_t hits = 0;
+      double t0 = hn_clock();
+
+      for (size_t n = 0; n < npasses; n++)
+	for (size_t i = 0; i < NVALS; i++)
+	  hits += pred(VALS[i]);
+
+      double ns = (hn_clock() - t0) * 1e9 / (npasses * (double)NVALS);
+      printf("%-20s %6.2f ns/value  (%zu hits)\n", PREDICATES[p].name, ns, hits / npasses);
+    }
+
+  return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef arith_h
+#define arith_h
+
+#include "rsp_core.h"
+#include "values.h"
+#include "bignum.h"
+#include "nvec.h"
+
+/*
+   the arithmetic, comparison and bitwise builtins (arith.c). Binary operations accept any mix
+   of fixnums, bignums and floats, promoted to their common type; arithmetic and the elementwise
+   comparisons also take two numeric vectors.
+ */
+val_t bltn_add(val_t,val_t);
+val_t bltn_sub(val_t,val_t);
+val_t bltn_mul(val_t,val_t);
+val_t bltn_div(val_t,val_t);
+val_t bltn_rem(val_t,val_t);
+val_t bltn_neg(val_t);
+
+val_t bltn_eql(val_t,val_t);
+val_t bltn_neql(val_t,val_t);
+val_t bltn_lt(val_t,val_t);
+val_t bltn_le(val_t,val_t);
+val_t bltn_gt(val_t,val_t);
+val_t bltn_ge(val_t,val_t);
+
+val_t bltn_veql(val_t,val_t);
+val_t bltn_vlt(val_t,val_t);
+val_t bltn_vle(val_t,val_t);
+val_t bltn_vgt(val_t,val_t);
+val_t bltn_vge(val_t,val_t);
+
+val_t bltn_band(val_t*);
+val_t bltn_bor(val_t*);
+val_t bltn_bxor(val_t*);
+val_t bltn_lsh(val_t*);
+val_t bltn_rsh(val_t*);
+val_t bltn_bneg(val_t*);
+
+#endif
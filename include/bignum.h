@@ -0,0 +1,49 @@
+#ifndef bignum_h
+#define bignum_h
+
+#include "rsp_core.h"
+#include "values.h"
+#include "mem.h"
+#include "cval.h"
+#include "describe.h"
+
+/*
+   arbitrary precision integers. The magnitude is stored as little-endian 64-bit limbs with no
+   leading zero limbs, and is always too large for a fixnum (results that fit are returned as
+   fixnums), so every integer has exactly one representation.
+ */
+typedef uint64_t limb_t;
+
+typedef enum
+  {
+    BN_NEG = 0x01u,
+  } bnflags_t;
+
+struct bignum_t
+{
+  VOBJECT_HEAD;                // cmeta holds the sign, size is the number of limbs
+  limb_t limbs[1];
+};
+
+#define KARATSUBA_CUTOFF 32    // limbs (smaller products use the schoolbook method)
+
+bool      isbignum(val_t);
+bignum_t* sf_tobignum(const chr_t*,int32_t,const chr_t*,val_t*);
+val_t     mk_bignum(const limb_t*,size_t,bool);
+val_t     bn_parse(const chr_t*);
+rflt_t    bn_fval(val_t);
+val_t     bn_add(val_t,val_t);
+val_t     bn_sub(val_t,val_t);
+val_t     bn_mul(val_t,val_t);
+val_t     bn_div(val_t,val_t);
+val_t     bn_rem(val_t,val_t);
+val_t     bn_neg(val_t);
+int32_t   bn_ord(val_t,val_t);
+hash_t    bn_hash(val_t,uint32_t);
+void      bn_prn(val_t,riostrm_t*);
+
+#define tobignum(v) sf_tobignum(__FILE__,__LINE__,__func__,&(v))
+
+extern type_t BIGNUM_TYPE_OBJ;
+
+#endif
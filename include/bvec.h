@@ -10,22 +10,33 @@
 struct bvec_t
 {
   tpkey_t  type;
-  uint32_t bv_bmap;
-  val_t    bv_elements[1];
+  uint32_t bv_bmap;          // slots holding an entry
+  uint32_t bv_nmap;          // slots holding a subnode
+  uint32_t bv_cap;           // allocated elements (only transient nodes have spare room)
+  uint64_t bv_edit;          // the transient that owns this node (0 if it's persistent)
+  uint32_t bv_width;         // elements per entry
+  uint32_t bv_pad;
+  val_t    bv_elements[1];   // the entries in slot order, then the subnodes in slot order
 };
 
+#define BVEC_HDR_SZ 32
+#define BVEC_MAX    64       // elements in the largest node (32 bindings)
+
 
 uint32_t popcnt(uint32_t);
 uint32_t bmtoidx(uint32_t);
 uint8_t  idxtobm(uint32_t,uint8_t);
 bool     isbvec(val_t);
 bvec_t*  sf_tobvec(const chr_t*,int32_t,const chr_t*,val_t*);
-bvec_t*  mk_bvec(size_t,bool);
+bvec_t*  mk_bvec(size_t,uint32_t,bool);
 size_t   bvec_elcnt(val_t);
+size_t   bvec_used(bvec_t*);
 size_t   bvec_sizeof(type_t*,val_t);
 uint8_t  get_bm_index(uint32_t,uint8_t);
 val_t*   bvec_ref(bvec_t*,uint8_t);
-bvec_t*  cp_bvec(bvec_t*,int32_t);
+val_t*   bvec_child(bvec_t*,uint8_t);
+
+extern type_t BVEC_TYPE_OBJ;
 
 #define tobvec(v)  sf_tobvec(__FILE__,__LINE__,__func__,&(v))
 
@@ -10,11 +10,7 @@
 #define MK_TYPE_PREDICATE(lt,tk,tnm)		                                  \
   inline bool is##tnm(val_t v)                                                    \
   {                                                                               \
-    int t = v & LTAG_MASK;						          \
-    if (v & PTR_MASK)								  \
-       return  t == lt && tpkey(v) == tk;                                         \
-    									          \
-    return false;                                                                 \
+    return has_hdrtype(v,lt,tk);                                                  \
   }
 
 #define MK_SAFECAST_V(ctype,rtype,cnvt)                                           \
@@ -40,7 +36,7 @@
 	exit(EXIT_FAILURE)                                      ;		     \
         return (ctype)0                                         ;                    \
       }                                                                              \
-    return (ctype)cnvt(_update_fptr(v))                         ;                    \
+    return (ctype)cnvt(*v)                                      ;                    \
   }
 
 #endif
@@ -24,4 +24,18 @@ val_t  env_set(val_t nm, val_t val, val_t envt);
 val_t  env_get(val_t nm, val_t envt);
 val_t  rsp_eval(val_t expr, val_t envt, val_t nmspc);
 
+// builtins callable from lisp, by name (lib/builtin.c)
+typedef val_t (*rsp_bltn_t)(val_t*);
+
+typedef struct
+{
+  const chr_t* name;
+  rsp_bltn_t   fn;
+  size_t       argc;
+} rsp_bltn_spec_t;
+
+extern const rsp_bltn_spec_t RSP_BUILTINS[];
+
+const rsp_bltn_spec_t* rsp_builtin_ref(const chr_t*);
+
 #endif
@@ -28,8 +28,6 @@ val_t*     tb_setkey(table_t*,val_t,val_t);
 val_t*     tb_rmvkey(table_t*,val_t);
 void       prn_dict(val_t,iostrm_t*);
 void       prn_set(val_t,iostrm_t*);
-atom_t*    mk_atom(chr_t*,uint16_t);
-atom_t*    intern_string(chr_t*,hash_t,uint16_t);
 
 // callable types
 builtin_t* mk_builtin(void*,size_t,bool);
@@ -41,9 +39,9 @@ int32_t    check_argco(obj_t*,size_t);
 // direct data (direct.c)
 val_t     mk_bool(int32_t);
 val_t     mk_char(int32_t);
-val_t     mk_int(int32_t);
-val_t     mk_float(flt32_t);
-hash_t    hash_small(val_t);
+val_t     mk_int(rint_t);
+val_t     mk_float(rflt_t);
+hash_t    hash_small(val_t,uint32_t);
 void      prn_int(val_t,iostrm_t*);
 void      prn_float(val_t,iostrm_t*);
 void      prn_char(val_t,iostrm_t*);
@@ -11,19 +11,22 @@ const uint8_t DVAL_SHIFT    = 32;
 const val_t   SHIFTED_1     = LOWMASK + 1;
 const val_t   SHIFTED_2     = LOWMASK + 2;
 const val_t   LTAG_MASK     = 0x07ul;
-const val_t   PTR_MASK      = ~LTAG_MASK;
+const val_t   PTR_MASK      = 0x0000fffffffffff8ul;  // the high bits of a reference are free (see REF_BITS)
 const val_t   DTYPE_MASK    = 0xfffffff8ul;
+const val_t   FIXNUM_MASK   = 0x1ful;                // low bits of a fixnum (see rtypes.h)
+const val_t   FIXNUM_TAG    = 0x07ul;
+const uint8_t FIXNUM_SHIFT  = 5;
+const val_t   FLONUM_MASK   = 0x0ful;
+const val_t   FLONUM_TAG    = 0x0ful;
+const val_t   SSTR_MASK     = 0xfful;                // low byte of an immediate string (see rstr.h)
+const val_t   SSTR_TAG      = 0xf7ul;
 const val_t   SHIFTED_WEOF  = ((int64_t)WEOF) << 32;
-const val_t   SHIFTED_NAN   = (0x7fc00000ul << 32);
-const val_t   SHIFTED_MNAN  = (0xffc00000ul << 32);
-const val_t   SHIFTED_INF   = (0x7f800000ul << 32);
-const val_t   SHIFTED_MINF  = (0xffc00000ul << 32);
 
 // global array of type object pointers, indexable using type key
 extern type_t** GLOBAL_TYPES;
 // these counters ensure that types 
 uint32_t OTYPE_COUNTER = 0x1au;
-uint32_t DTYPE_COUNTER = 0x40u;
+uint32_t DTYPE_COUNTER = 0x50u;   // direct type codes go up in steps of 0x20 (skipping codes ending in 0xf0)
 
 const val_t R_GLOBAL_VALUES[16] =  {
   0,
@@ -31,9 +34,9 @@ const val_t R_GLOBAL_VALUES[16] =  {
   OBJECT,
   SHIFTED_1      | BOOL | DIRECT,
   BOOL           | DIRECT,
-  INTEGER        | DIRECT,
-  SHIFTED_1      | INTEGER | DIRECT,
-  SHIFTED_2      | INTEGER | DIRECT,
+  FIXNUM_TAG,
+  (1ul << 5)     | FIXNUM_TAG,                         // 1 << FIXNUM_SHIFT
+  (2ul << 5)     | FIXNUM_TAG,
   SHIFTED_WEOF   | CHAR    | DIRECT,
 };
 
@@ -75,7 +78,26 @@ extern const chr_t* BUILTIN_TYPE_NAMES[16];
 extern uchr_t *RAM, *FREE, *EXTRA;
 extern val_t HEAPSIZE, STACKSIZE, DUMPSIZE, HEAPCRITICAL;
 const  float RAM_LOAD_FACTOR = 0.8;
-extern bool GROWHEAP, GREWHEAP;
+const  val_t HEAP_INIT_SIZE  = 0x100000u;   // in words (8MB)
+const  size_t HEAP_RESERVE   = 1ul << 35;   // address space reserved for each semispace (in bytes)
+const  size_t STACK_RESERVE  = 1ul << 30;   // address space reserved for the stack or the dump on huge pages (in bytes)
+const  size_t HUGE_PAGE_SIZE = 1ul << 21;   // in bytes
+
+// young generation (objects are bump allocated here and promoted into RAM by gc_minor)
+extern uchr_t *NURSERY, *NFREE;
+extern val_t NURSERYSIZE, NURSERYCRITICAL;
+const  val_t NURSERY_INIT_SIZE = 0x40000u;  // in words (2MB)
+
+// requests of at least this many bytes go to the large object space
+const  size_t LOS_THRESHOLD = 0x4000u;
+
+// remembered set (old slots that point into the nursery)
+extern val_t** REMSET;
+extern val_t REMSETSIZE, REMSETCNT;
+
+// number of threads used to evacuate the heap (1 runs the serial collector)
+extern size_t GC_NTHREADS;
+#define GC_MAX_THREADS 64u
 
 // stack, registers, and top-level namespace
 extern val_t *STACK, *DUMP, DP;
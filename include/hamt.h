@@ -8,33 +8,13 @@
 #include "bvec.h"
 
 
-// base leaf type
-typedef struct leaf_t
-{
-  tpkey_t type;
-  hash_t  hash;
-  val_t   _keys;
-} leaf_t;
-
-// leaf type for maps that store bindings
-typedef struct dleaf_t
-{
-  tpkey_t type;
-  hash_t  hash;
-  val_t   key;
-  val_t   value;
-  struct dleaf_t* next;
-} dleaf_t;
-
-// leaf type for maps that don't store bindings
-typedef struct sleaf_t
-{
-  tpkey_t type;
-  hash_t  hash;
-  list_t* keys;
-} sleaf_t;
-
-
+/*
+   table nodes use the CHAMP layout: a slot whose key is alone at this level holds the entry
+   itself (the key, then its value in tables with bindings) under bv_bmap, and a slot shared by
+   several keys holds a subnode under bv_nmap. The entries come first in the node, followed by
+   the subnodes. Keys whose hashes are equal all the way down share a collision node below the
+   last level, which is just a run of entries (its bv_bmap has one bit per entry).
+ */
 typedef enum
   {
     L1_MASK        = 0x0000001fu,
@@ -64,24 +44,38 @@ typedef enum
     HLVL_SEVEN,
   } hamt_lvl_t;
 
+#define HAMT_DEPTH    7         // levels of hash slices (collision nodes sit below the last)
+
+#define hamt_width(fl) ((fl) & BINDINGS ? 2 : 1)
+
+/*
+   cursors walk the entries of a table in slot (hash) order without recursing or allocating:
+   each frame is a node and the slots in it not yet visited (a collision node is walked the
+   same way, through its count mask). The table must not change while a cursor is on it.
+ */
+typedef struct
+{
+  val_t    node;
+  uint32_t rest;
+} hamt_frame_t;
 
+typedef struct
+{
+  int32_t      top;
+  hamt_frame_t stack[HAMT_DEPTH+1];
+} hamt_cursor_t;
 
 uint32_t get_mask(hamt_lvl_t);
-bool     isleaf(val_t);
-bool     issleaf(val_t);
-bool     isdleaf(val_t);
-leaf_t*  sf_toleaf(const chr_t*,int32_t,const chr_t*,val_t*);
-dleaf_t* sf_todleaf(const chr_t*,int32_t,const chr_t*,val_t*);
-sleaf_t* sf_tosleaf(const chr_t*,int32_t,const chr_t*,val_t*);
 bvec_t*  mk_hamt_nd(uint8_t,size_t,uint16_t);
-leaf_t*  mk_leaf(hash_t,val_t,uint16_t);
-obj_t*   hamt_search(val_t,val_t);
-val_t    hamt_insert(val_t*,val_t,uint16_t,rcmp_t);
-val_t    hamt_put(val_t*,val_t,val_t,uint16_t,rcmp_t);
-int32_t  hamt_remove(val_t*,val_t,uint16_t);
-
-#define toleaf(v)  sf_toleaf(__FILE__,__LINE__,__func__,&(v))
-#define todleaf(v) sf_todleaf(__FILE__,__LINE__,__func__,&(v))
-#define tosleaf(v) sf_tosleaf(__FILE__,__LINE__,__func__,&(v))
+val_t*   hamt_search(val_t,val_t);
+uint64_t hamt_transient(void);
+val_t*   hamt_insert(val_t*,val_t,uint16_t,uint64_t,rcmp_t);
+val_t*   hamt_put(val_t*,val_t,val_t,uint16_t,uint64_t,rcmp_t);
+int32_t  hamt_remove(val_t*,val_t,uint16_t,uint64_t);
+val_t    hamt_build(const val_t*,const val_t*,size_t,uint16_t,size_t*);
+void     hamt_prn(val_t,riostrm_t*);
+void     hamt_cursor_init(hamt_cursor_t*,val_t);
+void     hamt_cursor_preserve(hamt_cursor_t*);
+val_t*   hamt_cursor_next(hamt_cursor_t*);
 
 #endif
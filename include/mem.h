@@ -4,6 +4,19 @@
 #include "values.h"
 
 // stack manipulation
+#define STACK_SEG_SHIFT 12
+#define STACK_SEG_SIZE  (1ul << STACK_SEG_SHIFT)   // in words
+#define STACK_SEG_MASK  (STACK_SEG_SIZE - 1)
+
+extern val_t** STACKSEGS;
+extern val_t** DUMPSEGS;
+
+// the address of a stack (or dump) slot by index; good until the slot is popped
+#define stack_ref(n)    (&STACKSEGS[(n) >> STACK_SEG_SHIFT][(n) & STACK_SEG_MASK])
+#define dump_ref(n)     (&DUMPSEGS[(n) >> STACK_SEG_SHIFT][(n) & STACK_SEG_MASK])
+
+void  init_stack(void);
+void  stack_trim(void);
 void  grow_stack();
 void  grow_dump();
 val_t pop();
@@ -24,11 +37,133 @@ void*    vm_alloc(size_t,size_t,size_t);
 void*    vm_realloc(val_t,size_t,size_t);
 size_t   calc_mem_size(size_t);
 size_t   val_asizeof(val_t,type_t*);
+void     init_heap(void);
 bool     gc_check(void);
 void     gc_resize(void);
 void     gc_run(void);
+void     gc_minor(void);
+void     gc_major(void);
 val_t    gc_trace(val_t);
 val_t    gc_copy(type_t*,val_t);
+bool     gc_isfromspace(val_t);
+bool     gc_isheapref(val_t);
+size_t   gc_nroots(void);
+#define  GC_CONST_BASE 3          // R_GLOBAL_CONSTANTS before this are the standard streams
+val_t*   gc_root(size_t);
+val_t*   gc_fields(type_t*,val_t,size_t*);
+
+// per-collection telemetry (the last bucket of objects also counts every type key past it)
+#define GC_STAT_NKEYS 64
+
+typedef struct
+{
+  uint64_t cycle;         // collections so far, this one included
+  bool     minor;
+  bool     grew;          // the semispaces grew during this collection
+  double   start;         // wall clock time at the start of the pause (seconds since the epoch)
+  double   pause;         // seconds
+  size_t   copied;        // bytes
+  size_t   used_before;   // bytes in use in the old space and the nursery
+  size_t   used_after;
+  size_t   allocated;     // bytes allocated in the nursery since the previous collection
+  size_t   heap_before;   // semispace capacity in bytes
+  size_t   heap_after;
+  size_t   los_before;    // bytes mapped for large objects
+  size_t   los_after;
+  size_t   objects[GC_STAT_NKEYS];
+} gc_stats_t;
+
+extern gc_stats_t GC_STATS;        // the most recent collection
+extern double     GC_TOTAL_PAUSE;
+extern size_t     GC_TOTAL_COPIED;
+extern bool       GC_LOG;          // stream one line per collection to stderr (set RSP_GC_LOG)
+
+void     gc_count_copy(tpkey_t,size_t);
+
+extern bool GCMINOR;          // a minor collection is in progress
+
+// heap sizing policies (gcpolicy.c)
+typedef struct
+{
+  const chr_t* name;
+  void   (*observe)(const gc_stats_t*);  // called after every collection
+  size_t (*target)(size_t);              // semispace size in words, given the words that may survive
+} gc_policy_t;
+
+extern gc_policy_t* GC_POLICY;
+extern gc_policy_t  GC_FIXED_POLICY, GC_ADAPTIVE_POLICY;
+extern val_t        HEAPINIT, HEAPMAX;
+extern double       GC_TIME_TARGET;     // fraction of run time the adaptive policy aims to spend in major collections
+
+bool     gc_set_policy(const chr_t*);
+
+// large object space (los.c)
+extern size_t LOS_BYTES;
+void*    los_alloc(size_t);
+bool     los_contains(const void*);
+bool     los_holds(const void*);
+bool     los_mark(val_t);
+void     los_remember_young(void);
+void     los_sweep(void);
+void     los_each(void (*)(void*,size_t));
+
+// old space layout, chosen at startup
+typedef enum
+  {
+    GC_SEMISPACE,   // copying between RAM and EXTRA
+    GC_IMMIX,       // mark-region blocks in RAM, no EXTRA
+  } gc_collector_t;
+
+extern gc_collector_t GC_COLLECTOR;
+
+bool     gc_set_collector(const chr_t*);
+
+// mark-region old space (immix.c)
+void*    immix_alloc(size_t);
+bool     immix_contains(const void*);
+size_t   immix_nwords(void);
+void     immix_collect(void);
+
+// allocation profiling (profile.c)
+extern size_t  PROF_INTERVAL;     // bytes between samples, 0 turns sampling off
+extern int64_t PROF_COUNTDOWN;    // bytes left until the next sample
+extern bool    PROF_CENSUS;       // take a heap census after every gc_run
+
+void     prof_start(size_t);
+void     prof_enter(const chr_t*);
+void     prof_call(const chr_t*);
+void     prof_leave(void);
+size_t   prof_depth(void);
+void     prof_unwind(size_t);
+void     prof_sample(void*,size_t,bool);
+void     prof_settype(void*,tpkey_t);
+void     prof_resolve(void);
+void     prof_census(void);
+void     prof_report(FILE*);
+void     prof_collapsed(FILE*);
+
+// address space backing the old space, the stack and the dump
+extern bool HEAP_HUGEPAGES;       // back the reservations with 2MB pages
+
+uchr_t*  vm_reserve(void*,size_t);
+void     vm_commit(uchr_t*,size_t,size_t);
+uchr_t*  heap_reserve(void*);
+void     heap_commit(uchr_t*,size_t);
+void     heap_release(uchr_t*,size_t);
+
+// heap images (image.c)
+bool     image_save(const chr_t*);
+bool     image_load(const chr_t*);
+
+// parallel collection (gcpar.c)
+void     gc_par_evacuate(void);
+size_t   gc_par_slack(void);
+
+// generational support
+bool     in_nursery(const void*);
+bool     v_in_young(val_t);
+void     gc_remember(val_t*);
+void     gc_wbarrier(val_t*,val_t);
 
 bool     v_in_heap(val_t,void*,uint64_t);
 bool     p_in_heap(void*,void*,uint64_t);
@@ -39,6 +174,34 @@ bool     p_in_heap(void*,void*,uint64_t);
 	   default:p_in_heap)(v,u,sz)
 
 
+/*
+   handle scopes - C code that keeps heap values in locals across an allocation registers the
+   locals here, so that a collection started by the allocation traces and updates them:
+
+     gc_scope_t s = gc_scope_open();
+     gc_preserve(v);               // a tagged val_t
+     gc_preserve_ptr(p,OBJECT);    // an untagged pointer, traced as if it had this tag
+     ...
+     gc_scope_close(s);
+
+   Code that holds pointers into the middle of heap objects can't be fixed up this way, and
+   should hold off collection with gc_defer/gc_allow instead (the nursery spills meanwhile).
+ */
+typedef size_t gc_scope_t;
+
+extern bool   GC_AUTO;        // collect when the nursery fills up (otherwise only gc_run does)
+extern size_t GC_DEFER;       // collection is held off while this is nonzero
+
+gc_scope_t gc_scope_open(void);
+void       gc_scope_close(gc_scope_t);
+void       gc_handle(val_t*,val_t);
+void       gc_defer(void);
+void       gc_allow(void);
+
+#define GC_TAGGED                  ((val_t)-1)
+#define gc_preserve(v)             gc_handle((val_t*)&(v),GC_TAGGED)
+#define gc_preserve_ptr(p,lt)      gc_handle((val_t*)&(p),(lt))
+
 /* allocation macros */
 #define vm_allocw(bs,wds)          vm_alloc(bs,wds,8)
 #define vm_allocb(bs,nb)           vm_alloc(bs,nb,1)
@@ -46,4 +209,11 @@ bool     p_in_heap(void*,void*,uint64_t);
 #define vm_reallocw(v,wds)         vm_realloc(v,wds,8)
 #define vm_reallocb(v,b)           vm_realloc(v,b,1)
 
+/* 
+   write barrier - every store of a value into an existing heap object must go through here
+   so that minor collections can find old->young references (mutators like rvec_rplcn and env_set
+   should use it as well).
+ */
+#define wbarrier(l,v)              gc_wbarrier((val_t*)&(l),(val_t)(v))
+
 #endif
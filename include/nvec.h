@@ -0,0 +1,56 @@
+#ifndef nvec_h
+#define nvec_h
+
+#include "rsp_core.h"
+#include "values.h"
+#include "mem.h"
+#include "cval.h"
+#include "describe.h"
+
+/*
+   typed numeric arrays - contiguous unboxed elements of one c_num_t type. The elementwise and
+   reduction kernels (nvec.c) are vectorized, and built for both AVX2 and the SSE2 baseline with
+   the version to run picked when the program loads.
+ */
+struct nvec_t
+{
+  VOBJECT_HEAD;             // cmeta is the element type (a c_num_t), size the element count
+  uchr_t data[16];
+};
+
+typedef enum
+  {
+    NV_ADD,
+    NV_SUB,
+    NV_MUL,
+    NV_DIV,
+    NV_REM,
+    NV_EQ,                  // comparisons give a vector of CNUM_UINT8 0s and 1s
+    NV_LT,
+    NV_LE,
+    NV_GT,
+    NV_GE,
+  } nv_op_t;
+
+bool    isnvec(val_t);
+nvec_t* sf_tonvec(const chr_t*,int32_t,const chr_t*,val_t*);
+nvec_t* mk_nvec(c_num_t,size_t);
+val_t   nvec_new(type_t*,val_t,size_t);
+size_t  nvec_sizeof(type_t*,val_t);
+size_t  nvec_elcnt(val_t);
+val_t   nvec_assocn(val_t,size_t);
+val_t   nvec_rplcn(val_t,size_t,val_t);
+val_t   nvec_binop(val_t,val_t,nv_op_t);
+val_t   nvec_sum(val_t);
+val_t   nvec_min(val_t);
+val_t   nvec_max(val_t);
+val_t   nvec_dot(val_t,val_t);
+hash_t  nvec_hash(val_t,uint32_t);
+int32_t nvec_ord(val_t,val_t);
+void    nvec_prn(val_t,riostrm_t*);
+
+#define tonvec(v) sf_tonvec(__FILE__,__LINE__,__func__,&(v))
+
+extern type_t NVEC_TYPE_OBJ;
+
+#endif
@@ -9,22 +9,46 @@
 #include "error.h"
 
 extern const type_t PAIR_TYPE_OBJ;
+extern const type_t LIST_TYPE_OBJ;
+
+/*
+   cdr-coded lists - a run of list cells built together stores only their cars, followed by the
+   cdr of the last cell. A cell is referenced by the address of the run, with CDR_CODED and its
+   index in the run in the high bits (see REF_BITS); the cdr of any other cell is the next one.
+ */
+#define CDR_RUN_MAX 1024u          // cells per run (longer lists are chained runs)
+
+typedef struct
+{
+  OBJECT_HEAD;                     // type is LIST, cmeta is the number of cells
+  val_t cells[];                   // the cars, then the cdr of the last cell
+} cdr_run_t;
+
+#define cdr_run(v)   ptr(cdr_run_t*,(v))
+#define cdr_cell(v)  (cdr_run(v)->cells[cdr_index(v)])
+#define cdr_last(v)  (cdr_index(v) + 1 == cdr_run(v)->cmeta)
+#define cdr_tail(v)  (cdr_run(v)->cells[cdr_run(v)->cmeta])
+#define cdr_succ(v)  ((v) + (1ul << CDR_SHIFT))
 
 // pairs
-list_t*   mk_list(val_t*,size_t);
+val_t     mk_list(val_t*,size_t);
+val_t     mk_stack_list(size_t,val_t);
 list_t*   mk_listn(size_t,...);
 pair_t*   mk_pair(val_t,val_t);
 val_t     rsp_cons(val_t,size_t);
 val_t     car(val_t);
 val_t     cdr(val_t);
+val_t*    car_loc(val_t);
+val_t*    cdr_loc(val_t*);
+size_t    pair_sizeof(type_t*,val_t);
 val_t     pair_relocate(type_t*,val_t,uchr_t**);
 hash_t    pair_hash(val_t,uint32_t);
 void      pair_prn(val_t,riostrm_t*);
 size_t    pair_elcnt(val_t);
-pair_t*   pair_append(pair_t**,val_t);
-val_t     pair_assocn(pair_t*,int32_t);
-int32_t   pair_assocv(pair_t*,val_t);
-pair_t*   pair_rplcn(pair_t*,int32_t, val_t);
+val_t     pair_append(val_t*,val_t);
+val_t     pair_assocn(val_t,int32_t);
+int32_t   pair_assocv(val_t,val_t);
+val_t     pair_rplcn(val_t,int32_t,val_t);
 val_t     pop_list(size_t,val_t*);
 bool      last_expression(val_t);
 pair_t*   sf_topair(const chr_t*,const int32_t,const chr_t*, val_t*);
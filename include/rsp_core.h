@@ -21,6 +21,7 @@
 #define unlikely(x) __builtin_expect((x), 0)
 #define likely(x)   __builtin_expect((x), 1)
 #define popcount(x) __builtin_popcount(x)
+#define prefetch(p) __builtin_prefetch((p))
 
 // type-generic min, max, and compare macros
 #define min(x,y)                     \
@@ -41,7 +42,7 @@
   ({                                                   \
      typeof(x) __x__ = x                             ; \
      typeof(y) __y__ = y                             ; \
-     (__x__ < __y__ ? -1 : 0) || (__x__ > y ? 1 : 0) ; \
+     __x__ < __y__ ? -1 : (__x__ > __y__ ? 1 : 0)    ; \
   })
 
 
@@ -20,7 +20,20 @@ struct bytes_t
   uchr_t bytes[16];
 };
 
+/*
+   immediate strings - a string of up to 7 bytes is stored in the value itself, one byte per
+   octet above the tag (byte i in bits 8i+8..8i+15). UTF-8 never contains a zero byte, so the
+   unused octets are zero and the length doesn't need to be stored. mk_str picks the form, the
+   string functions below accept either, and rstr_chars unpacks an immediate into a caller's buffer.
+ */
+#define SSTR_MAX     7
+#define issstr(v)    (((val_t)(v) & SSTR_MASK) == SSTR_TAG)
+
 bool     isstr(val_t);
+bool     isheapstr(val_t);
+val_t    mk_str(const chr_t*);
+val_t    mk_strval(const chr_t*);
+const chr_t* rstr_chars(val_t,chr_t*);
 bool     isbytes(val_t);
 void     rstr_prn(val_t,riostrm_t*);
 void     bytes_prn(val_t,riostrm_t*);
@@ -30,13 +43,13 @@ rstr_t*  mk_rstr(const chr_t*);
 bytes_t* mk_bytes(const uchr_t*,size_t);
 val_t    rstr_new(val_t,size_t);
 val_t    bytes_new(val_t,size_t);
-rchr_t   rstr_assocn(rstr_t*,rint_t);
-rint_t   rstr_assocv(rstr_t*,rchr_t);
+rchr_t   rstr_assocn(val_t,rint_t);
+rint_t   rstr_assocv(val_t,rchr_t);
 hash_t   rstr_hash(val_t,uint32_t);
 hash_t   bytes_hash(val_t,uint32_t);
 int32_t  rstr_ord(val_t,val_t);
 int32_t  bytes_ord(val_t,val_t);
-rstr_t*  sf_tostr(const chr_t*,int32_t,const chr_t*,val_t*);
+rstr_t*  sf_toheapstr(const chr_t*,int32_t,const chr_t*,val_t*);
 bytes_t* sf_tobytes(const chr_t*,int32_t,const chr_t*,val_t*);
 
 extern type_t RSTR_TYPE_OBJ;
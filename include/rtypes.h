@@ -12,9 +12,9 @@ typedef uint32_t  tpkey_t;
 
 /* core direct types */
 typedef bool     rbool_t;
-typedef int32_t  rint_t;
+typedef int64_t  rint_t;
 typedef cint32_t rchr_t;
-typedef flt32_t  rflt_t;
+typedef flt64_t  rflt_t;
 
 /* C types with a direct rascal representation */
 typedef FILE     riostrm_t;
@@ -33,8 +33,9 @@ typedef struct rstr_t     rstr_t;
 typedef struct bytes_t    bytes_t;
 typedef struct rvec_t     rvec_t;
 typedef struct bvec_t     bvec_t;
-typedef struct leaf_t     leaf_t;
 typedef struct function_t function_t;
+typedef struct bignum_t   bignum_t;
+typedef struct nvec_t     nvec_t;
 typedef struct builtin_t  builtin_t;
 
 /* metaobjects */
@@ -44,7 +45,18 @@ typedef struct type_t type_t;
 typedef val_t   (*rbuiltin_t)(val_t*,size_t);
 typedef int32_t (*rcmp_t)(val_t,val_t);
 
-// builtin typecodes - direct types must be multiples of 8
+/*
+   builtin typecodes. Direct values use the low bits after the DIRECT tag to say what they
+   hold:
+
+     xxxx1111  flonum  - a double with a 7-bit exponent in the upper 60 bits (see values.c)
+     xxx00111  fixnum  - a 59-bit signed integer in the upper 59 bits
+     11110111  string  - up to 7 bytes of UTF-8 in the upper 56 bits (see rstr.h)
+     xxx10111  other   - the type code in bits 3-31 and the value in the upper 32 bits
+
+   so the codes of the remaining direct types must be 16 mod 32, and can't end in 0xf0. NIL,
+   FLOAT and INTEGER are never stored in a value and only serve as type keys.
+ */
 enum
   {
     LIST     = 0x00u,
@@ -60,17 +72,18 @@ enum
     BYTES    = 0x0au,
     RVECTOR  = 0x0bu,
     BVECTOR  = 0x0cu,
-    TBDLEAF  = 0x0du,
-    TBSLEAF  = 0x0eu,
     TABLE    = 0x0fu,
     CHAR     = 0x10u,
     SYMTAB   = 0x11u,
     DATATYPE = 0x12u,
-    BOOL     = 0x18u,
+    BIGNUM   = 0x13u,
+    NVECTOR  = 0x14u,
     INTEGER  = 0x20u,
+    FLOAT    = 0x28u,
+    BOOL     = 0x30u,
   };
 
-/* the common numeric type can be found by bitwise OR-ing the codes */
+/* the common numeric type can be found by bitwise OR-ing the codes (builtin.c and nvec.c dispatch on it) */
 
 typedef enum
 {
@@ -137,6 +150,7 @@ struct symbol_t
 {
   uint32_t flags;
   hash_t hash;
+  symbol_t* next;   // the next interned symbol with the same hash
   chr_t name[8];
 };
 
@@ -168,8 +182,8 @@ struct vcval_t
 /* union types for handling different representations of rascal values */
 typedef union
 {
-  rint_t  integer;
-  rflt_t  float32;
+  int32_t integer;
+  flt32_t float32;
   rchr_t  unicode;
   rbool_t boolean;
   uint32_t bits32;
@@ -188,7 +202,7 @@ typedef union
   uchr_t*  mem;
   uint64_t bits64;
   rint_t   integer;
-  rflt_t   float32;
+  rflt_t   float64;
   rchr_t   unicode;
   rbool_t  boolean;
   uint32_t bits32;
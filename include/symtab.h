@@ -0,0 +1,33 @@
+#ifndef symtab_h
+#define symtab_h
+
+#include "rsp_core.h"
+#include "values.h"
+#include "mem.h"
+
+/*
+   interned symbols live outside the heap in a concurrent hash trie (symbols are never moved or
+   freed). Each node has 32 slots holding nothing, a symbol or a subnode; new symbols and
+   subnodes are published with a compare-and-swap on the parent's slot and never taken out, so
+   interning is lock-free and looking up an existing symbol is wait-free. Below the last hash
+   slice a slot holds a chain of the symbols with that hash, linked through next.
+ */
+typedef enum
+  {
+    SM_INTERNED = 0x01,
+    SM_GENSYM   = 0x02,
+    SM_RESERVED = 0x04,
+    SM_KEYWORD  = 0x08,
+  } sm_flags_t;
+
+#define SYMTAB_DEPTH  7         // 5-bit slices of the hash (the last has 2 bits)
+
+extern type_t SYMBOL_TYPE_OBJ;
+
+symbol_t* mk_symbol(chr_t*,uint32_t);
+symbol_t* symtab_lookup(const chr_t*);
+symbol_t* symtab_intern(const chr_t*,uint32_t);
+size_t    symtab_count(void);
+void      symtab_each(void (*)(symbol_t*));
+
+#endif
@@ -6,6 +6,7 @@
 #include "obj.h"
 #include "mem.h"
 #include "hamt.h"
+#include "symtab.h"
 #include "error.h"
 #include "describe.h"
 
@@ -17,22 +18,20 @@ typedef struct table_t
   val_t    keys;
 } table_t;
 
-typedef enum
-  {
-    SM_INTERNED = 0x01,
-    SM_GENSYM   = 0x02,
-    SM_RESERVED = 0x04,
-    SM_KEYWORD  = 0x08,
-  } sm_flags_t;
+extern type_t TABLE_TYPE_OBJ;
 
+bool      istable(val_t);
 table_t*  mk_table(size_t);
 table_t*  tb_prn(table_t*);
 val_t     tb_relocate(table_t*);
 val_t     tb_putkey(table_t*,val_t,val_t);
 val_t     tb_getkey(table_t*,val_t);
 val_t     tb_rmvkey(table_t*,val_t);
-table_t*  mk_symtab(size_t);
-table_t*  symtb_intern(table_t*,chr_t*);
-symbol_t* mk_symbol(chr_t*,uint32_t);
+
+// builtins (table.c)
+val_t     rsp_gc_stats(void);
+val_t     rsp_table_from(val_t);
+val_t     rsp_tb_reduce(val_t*);
+val_t     rsp_tb_each(val_t*);
 
 #endif
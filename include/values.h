@@ -4,7 +4,6 @@
 
 // checking tags, getting type information
 uint32_t   ltag(val_t);
-tpkey_t    tpkey(val_t);
 val_t      addr(val_t);
 void*      vptr(val_t);
 rsp_c32_t  value(val_t);
@@ -18,16 +17,87 @@ bool       v_aligned(val_t);
 obj_t*     objhead(val_t);
 
 #define ptr(t,v)             ((t)addr(v))
-#define uval(v)              (((rsp_c64_t)(v)).padded.bits.bits32)
-#define ival(v)              (((rsp_c64_t)(v)).padded.bits.integer)
-#define fval(v)              (((rsp_c64_t)(v)).padded.bits.float32)
-#define bval(v)              (((rsp_c64_t)(v)).padded.bits.boolean)
-#define cval(v)              (((rsp_c64_t)(v)).padded.bits.unicode)
+#define uval(v)              ((uint32_t)((val_t)(v) >> 32))
+#define bval(v)              ((rbool_t)((val_t)(v) >> 32))
+#define cval(v)              ((rchr_t)((val_t)(v) >> 32))
+
+// fixnums and flonums (see rtypes.h for the layout of direct values)
+#define FIXNUM_MAX           ((int64_t)((1ul << 58) - 1))
+#define FIXNUM_MIN           (-FIXNUM_MAX - 1)
+#define isfixnum(v)          (((val_t)(v) & FIXNUM_MASK) == FIXNUM_TAG)
+#define isflonum(v)          (((val_t)(v) & FLONUM_MASK) == FLONUM_TAG)
+#define fixnum_fits(i)       ((i) >= FIXNUM_MIN && (i) <= FIXNUM_MAX)
+#define fixnum(i)            (((val_t)(int64_t)(i) << FIXNUM_SHIFT) | FIXNUM_TAG)
+#define ival(v)              ((rint_t)(val_t)(v) >> FIXNUM_SHIFT)
+
+bool       flonum_fits(rflt_t);
+val_t      flonum(rflt_t);
+rflt_t     fval(val_t);
+val_t      mk_int(rint_t);    // a fixnum, or a bignum if it doesn't fit (direct.c)
+val_t      mk_float(rflt_t);  // a flonum, or a boxed FLOAT if it doesn't fit (direct.c)
+val_t      mk_bool(int32_t);  // R_TRUE or R_FALSE (direct.c)
+val_t      val_ftoi(val_t);   // the integer part of a float (direct.c)
+val_t      val_itof(val_t);
+val_t      stoi(chr_t*);      // a decimal integer literal, or R_EOF if s isn't one (direct.c)
+
+/*
+   fast type dispatch. The collector updates every reference before it returns, so outside a
+   collection the type of an object is one load from its header with no forwarding check, and
+   everything else is known from the tag bits. Only the collector should need trace_fptr (the
+   other forwarded objects are the old copies left by vm_realloc, whose callers drop them).
+ */
+#define hdr_tpkey(v)         (((obj_t*)((val_t)(v) & PTR_MASK))->type)
+#define isheaded(v)          (((val_t)(v) & LTAG_MASK) - OBJECT <= FUNCTION - OBJECT)
+
+static inline tpkey_t tpkey(val_t v)
+{
+  if (isheaded(v))
+    return (v & PTR_MASK) ? hdr_tpkey(v) : NIL;
+
+  if ((v & LTAG_MASK) == DIRECT)
+    {
+      if (isfixnum(v))
+	return INTEGER;
+
+      if (isflonum(v))
+	return FLOAT;
+
+      if ((v & SSTR_MASK) == SSTR_TAG)
+	return STRING;
+
+      return v & DTYPE_MASK;
+    }
+
+  return (v & PTR_MASK) ? (v & LTAG_MASK) : NIL;
+}
+
+// is v a reference with this tag to an object with this header type?
+#define has_hdrtype(v,lt,tk)                                            \
+  (((val_t)(v) & LTAG_MASK) == (lt) && ((val_t)(v) & PTR_MASK) && hdr_tpkey(v) == (tk))
+
+// numbers are immediate or boxed as cvalues
+static inline bool isint(val_t v)   { return isfixnum(v) || has_hdrtype(v,CVALUE,BIGNUM); }
+static inline bool isfloat(val_t v) { return isflonum(v) || has_hdrtype(v,CVALUE,FLOAT); }
+bool isboxed_float(val_t);   // a double that didn't fit in a flonum (direct.c)
 
 // general unsafe accessors
 #define car_(v)              (ptr(val_t*,(val_t)(v))[0])
 #define cdr_(v)              (ptr(val_t*,(val_t)(v))[1])
 
+/*
+   bits of a reference above the address. A cdr-coded list cell (see pairs.c) points at the
+   start of its run, and carries a flag and its index in the run here. Anything that moves an
+   object has to carry these over to the references it updates, so forwarding pointers are
+   read with fwd_.
+ */
+#define REF_BITS             (~(PTR_MASK | LTAG_MASK))
+#define CDR_CODED            (1ul << 63)
+#define CDR_SHIFT            48
+#define CDR_INDEX_MASK       0x7ffful
+#define cdr_coded(v)         (((val_t)(v) & CDR_CODED) != 0)
+#define cdr_index(v)         (((val_t)(v) >> CDR_SHIFT) & CDR_INDEX_MASK)
+#define fwd_(v)              (cdr_(v) | ((val_t)(v) & REF_BITS))
+
 val_t     tag_from_type(rsp_c64_t,type_t*);
 val_t     tag_from_tpkey(rsp_c64_t,tpkey_t);
 
@@ -51,6 +121,7 @@ hash_t   val_rehash(val_t,uint32_t);
 int32_t  val_eql(val_t,val_t);
 void     val_prn(val_t,riostrm_t*);
 int32_t  val_finalize(type_t*,val_t);
+val_t    rsp_apply(val_t,val_t*,size_t);
 
 // global value predicates
 bool isnil(val_t);
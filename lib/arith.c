@@ -0,0 +1,216 @@
+#include "../include/arith.h"
+
+/*
+   fixnum operations - each stores its result in r and returns true if the result doesn't fit
+   in a fixnum (or there isn't one), in which case the builtin redoes the operation on bignums
+   (or in floating point if either argument is a float).
+ */
+static inline bool add_fx(rint_t x, rint_t y, rint_t* r) { return __builtin_add_overflow(x,y,r) || !fixnum_fits(*r); }
+static inline bool sub_fx(rint_t x, rint_t y, rint_t* r) { return __builtin_sub_overflow(x,y,r) || !fixnum_fits(*r); }
+static inline bool mul_fx(rint_t x, rint_t y, rint_t* r) { return __builtin_mul_overflow(x,y,r) || !fixnum_fits(*r); }
+
+static inline bool div_fx(rint_t x, rint_t y, rint_t* r)
+{
+  if (unlikely(!y))
+    return true;
+
+  *r = x / y;
+  return !fixnum_fits(*r);
+}
+
+static inline bool rem_fx(rint_t x, rint_t y, rint_t* r)
+{
+  if (unlikely(!y))
+    return true;
+
+  *r = x % y;
+  return false;
+}
+
+static inline bool neg_fx(rint_t x, rint_t* r)
+{
+  *r = -x;
+  return !fixnum_fits(*r);
+}
+
+#define add_fl(x,y)  ((x) + (y))
+#define sub_fl(x,y)  ((x) - (y))
+#define mul_fl(x,y)  ((x) * (y))
+#define div_fl(x,y)  ((x) / (y))
+#define rem_fl(x,y)  fmod((x),(y))
+#define neg_fl(x)    (-(x))
+
+// numeric arguments as C values
+static inline rflt_t num_fval(val_t x)
+{
+  if (isfixnum(x))
+    return (rflt_t)ival(x);
+
+  if (isbignum(x))
+    return bn_fval(x);
+
+  assert(isfloat(x),TYPE_ERR,"number",val_typename(x));
+  return fval(x);
+}
+
+static inline rint_t num_ival(val_t x)
+{
+  assert(isfixnum(x),TYPE_ERR,"int",val_typename(x));
+  return ival(x);
+}
+
+/*
+   mixed-type dispatch. Every kind of number has a c_num_t code (fixnums are 64-bit integers,
+   bignums count as 128-bit integers, and floats are doubles), so the common type of two
+   arguments is the OR of their codes, and each builtin finds the kernel for that type with
+   one lookup in its own table. Anything that isn't a number gets the imaginary bit (no real
+   number has it), so any pair involving one lands in slot 0, which handles numeric vectors
+   and otherwise reports a type error. Two fixnums only reach the table when the fast path
+   overflows, so their slot goes straight to the bignum kernel.
+
+   These are the only scalar numbers. The narrower integers and f32 exist only as numeric vector
+   elements, which are promoted by nvec.c's table, and there is no complex representation yet.
+ */
+enum
+  {
+    NUM_OTHER,
+    NUM_FIX,
+    NUM_BIG,
+    NUM_FLT,
+    NUM_NSLOTS,
+  };
+
+#define NUM_NKEYS 0x40
+#define NUM_NONE  0x80u
+
+static const uint8_t NUM_CODES[NUM_NKEYS] =
+  {
+    [INTEGER] = CNUM_INT64,
+    [BIGNUM]  = CNUM_INT128,
+    [FLOAT]   = CNUM_FLOAT64,
+  };
+
+static const uint8_t NUM_SLOTS[256] =
+  {
+    [CNUM_INT64]    = NUM_FIX,
+    [CNUM_INT128]   = NUM_BIG,
+    [CNUM_FLOAT64]  = NUM_FLT,
+    [CNUM_FLOAT128] = NUM_FLT,    // a bignum with a float is done in floating point
+  };
+
+static inline c_num_t num_code(val_t x)
+{
+  tpkey_t k = tpkey(x);
+  c_num_t c = k < NUM_NKEYS ? NUM_CODES[k] : 0;
+  return c ? c : NUM_NONE;
+}
+
+typedef val_t (*numop1_t)(val_t);
+typedef val_t (*numop2_t)(val_t,val_t);
+
+static val_t num_type_err(val_t x, val_t y)
+{
+  val_t bad = num_code(x) == NUM_NONE ? x : y;
+  rsp_perror(__FILE__,__LINE__,__func__,TYPE_ERR,"number",val_typename(bad));
+  return NIL;
+}
+
+#define DECLARE_ARITHMETIC_1(fname,funci,funcb,funcf)                   \
+  static val_t fname ## _flk(val_t x) { return mk_float(funcf(fval(x))); } \
+  static val_t fname ## _err(val_t x) { return num_type_err(x,x); }     \
+                                                                        \
+  static const numop1_t fname ## _KERNELS[NUM_NSLOTS] =                 \
+    { fname ## _err, funcb, funcb, fname ## _flk };                     \
+                                                                        \
+  val_t bltn_## fname(val_t x)                                          \
+  {                                                                     \
+    rint_t r;                                                           \
+    if (likely(isfixnum(x)) && !funci(ival(x),&r))                      \
+      return fixnum(r);                                                 \
+    return fname ## _KERNELS[NUM_SLOTS[num_code(x)]](x);                \
+  }
+
+// two numeric vectors are combined elementwise
+#define DECLARE_ARITHMETIC_2(fname,funci,funcb,funcf,nvop)              \
+  static val_t fname ## _flk(val_t x, val_t y)                          \
+  {                                                                     \
+    return mk_float(funcf(num_fval(x),num_fval(y)));                    \
+  }                                                                     \
+                                                                        \
+  static val_t fname ## _other(val_t x, val_t y)                        \
+  {                                                                     \
+    if (isnvec(x) && isnvec(y))                                         \
+      return nvec_binop(x,y,nvop);                                      \
+    return num_type_err(x,y);                                           \
+  }                                                                     \
+                                                                        \
+  static const numop2_t fname ## _KERNELS[NUM_NSLOTS] =                 \
+    { fname ## _other, funcb, funcb, fname ## _flk };                   \
+                                                                        \
+  val_t bltn_## fname(val_t x, val_t y)                                 \
+  {                                                                     \
+    rint_t r;                                                           \
+    if (likely(isfixnum(x) && isfixnum(y))                              \
+	&& !funci(ival(x),ival(y),&r))                                  \
+      return fixnum(r);                                                 \
+    return fname ## _KERNELS[NUM_SLOTS[num_code(x) | num_code(y)]](x,y); \
+  }
+
+// fixnums compare without decoding (the tag bits are the same)
+#define DECLARE_COMPARISON_2(fname,op)                                  \
+  static val_t fname ## _bnk(val_t x, val_t y) { return mk_bool(bn_ord(x,y) op 0); } \
+  static val_t fname ## _flk(val_t x, val_t y) { return mk_bool(num_fval(x) op num_fval(y)); } \
+                                                                        \
+  static const numop2_t fname ## _KERNELS[NUM_NSLOTS] =                 \
+    { num_type_err, fname ## _bnk, fname ## _bnk, fname ## _flk };      \
+                                                                        \
+  val_t bltn_## fname(val_t x, val_t y)                                 \
+  {                                                                     \
+    if (likely(isfixnum(x) && isfixnum(y)))                             \
+      return mk_bool((int64_t)x op (int64_t)y);                         \
+    return fname ## _KERNELS[NUM_SLOTS[num_code(x) | num_code(y)]](x,y); \
+  }
+
+// the elementwise versions return a vector of 0s and 1s
+#define DECLARE_COMPARISON_NV(fname,nvop)                               \
+  val_t bltn_## fname(val_t x, val_t y)                                 \
+  {                                                                     \
+    return nvec_binop(x,y,nvop);                                        \
+  }
+
+
+#define DECLARE_BITWISE_2(fname,op)				\
+  val_t bltn_## fname(val_t* a)                                 \
+  {                                                             \
+      return mk_int(num_ival(a[1]) op num_ival(a[0]));		\
+  }
+
+#define DECLARE_BITWISE_1(fname,op)				\
+  val_t bltn_## fname(val_t* a)                                 \
+  {                                                             \
+      return mk_int(op num_ival(a[0]));		                \
+  }
+
+DECLARE_ARITHMETIC_2(add,add_fx,bn_add,add_fl,NV_ADD)
+DECLARE_ARITHMETIC_2(sub,sub_fx,bn_sub,sub_fl,NV_SUB)
+DECLARE_ARITHMETIC_2(mul,mul_fx,bn_mul,mul_fl,NV_MUL)
+DECLARE_ARITHMETIC_2(div,div_fx,bn_div,div_fl,NV_DIV)
+DECLARE_ARITHMETIC_2(rem,rem_fx,bn_rem,rem_fl,NV_REM)
+DECLARE_COMPARISON_2(eql,==)
+DECLARE_COMPARISON_2(neql,!=)
+DECLARE_COMPARISON_2(lt,<)
+DECLARE_COMPARISON_2(le,<=)
+DECLARE_COMPARISON_2(gt,>)
+DECLARE_COMPARISON_2(ge,>=)
+DECLARE_COMPARISON_NV(veql,NV_EQ)
+DECLARE_COMPARISON_NV(vlt,NV_LT)
+DECLARE_COMPARISON_NV(vle,NV_LE)
+DECLARE_COMPARISON_NV(vgt,NV_GT)
+DECLARE_COMPARISON_NV(vge,NV_GE)
+DECLARE_ARITHMETIC_1(neg,neg_fx,bn_neg,neg_fl)
+DECLARE_BITWISE_2(band,&)
+DECLARE_BITWISE_2(bor,|)
+DECLARE_BITWISE_2(bxor,^)
+DECLARE_BITWISE_2(lsh,<<)
+DECLARE_BITWISE_2(rsh,>>)
+DECLARE_BITWISE_1(bneg,~)
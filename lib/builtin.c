@@ -1,60 +1,19 @@
 #include "capi.h"
+#include "bignum.h"
+#include "nvec.h"
+#include "rvec.h"
+#include "pairs.h"
+#include "table.h"
+#include "arith.h"
+#include "eval.h"
 
 
-
-#define DECLARE_ARITHMETIC_1(fname,funci,funcf,rtni,rtnf)       \
-  val_t bltn_## fname(val_t x)					\
-    {                                                           \
-      if (isfloat(x))						\
-	return rtnf(funcf(fval(x)));				\
-    else                                                        \
-      return rtni(funci(toint(__FILE__,__LINE__,__func__,x)));	\
-  }
-
-
-#define DECLARE_ARITHMETIC_2(fname,funci,funcf,rtni,rtnf)	\
-  val_t bltn_## fname(val_t x, val_t y)                         \
-  {                                                             \
-       							        \
-  }
-
-
-#define DECLARE_BITWISE_2(fname,fnc)				\
-  val_t bltn_## fname(val_t* a)                                 \
-  {                                                             \
-      return vm_mk_int(fnc(toint(a[1]),toint(a[0])));		\
-  }
-
-#define DECLARE_BITWISE_1(fname,fnc)				\
-  val_t bltn_## fname(val_t* a)                                 \
-  {                                                             \
-      return vm_mk_int(fnc(toint(a[0])));		                \
-  }
-
-DECLARE_ARITHMETIC_2(add,add_ii,add_ff,vm_vm_vm_mk_int,vm_mk_float)
-DECLARE_ARITHMETIC_2(sub,sub_ii,sub_ff,vm_vm_mk_int,vm_mk_float)
-DECLARE_ARITHMETIC_2(mul,mul_ii,mul_ff,vm_vm_mk_int,vm_mk_float)
-DECLARE_ARITHMETIC_2(div,div_ii,div_ff,vm_vm_mk_int,vm_mk_float)
-DECLARE_ARITHMETIC_2(rem,rem_ii,rem_ff,vm_vm_mk_int,vm_mk_float)
-DECLARE_ARITHMETIC_2(eql,eql_ii,eql_ff,vm_mk_bool,vm_mk_bool)
-DECLARE_ARITHMETIC_2(neql,neql_ii,neql_ff,vm_mk_bool,vm_mk_bool)
-DECLARE_ARITHMETIC_2(lt,lt_ii,lt_ff,vm_mk_bool,vm_mk_bool)
-DECLARE_ARITHMETIC_2(le,le_ii,le_ff,vm_mk_bool,vm_mk_bool)
-DECLARE_ARITHMETIC_2(gt,gt_ii,gt_ff,vm_mk_bool,vm_mk_bool)
-DECLARE_ARITHMETIC_2(ge,ge_ii,ge_ff,vm_mk_bool,vm_mk_bool)
-DECLARE_ARITHMETIC_1(neg,neg_i,neg_f,vm_vm_mk_int,vm_vm_mk_int)
-DECLARE_BITWISE_2(band,and_ii)
-DECLARE_BITWISE_2(bor,or_ii)
-DECLARE_BITWISE_2(bxor,xor_ii)
-DECLARE_BITWISE_2(lsh,lsh_ii)
-DECLARE_BITWISE_2(rsh,rsh_ii)
-DECLARE_BITWISE_1(bneg,bneg_i)
-
 #define DECLARE_BUILTIN(fname,func,argc) DECLARE_BUILTIN_ ## argc ## _(fname,func)
 
 #define DECLARE_BUILTIN_0_(fname,func)	      \
-  val_t bltn_ ## fname(val_t* a)              \
+  val_t bltn_ ## fname ## _(val_t* a)         \
   {					      \
+     (void)a ;                                \
      return func() ;	                      \
   }
 
@@ -120,6 +79,15 @@ DECLARE_BUILTIN(rtypeof,rsp_typeof,1)         // get the associated type metaobj
 DECLARE_BUILTIN(atomicp,rsp_atomicp,1)        // is this value an atom?
 DECLARE_BUILTIN(callablep,rsp_callablep,1)    // is this value callable?
 DECLARE_BUILTIN(numericp,rsp_numericp,1)      // is this value numeric?
+DECLARE_BUILTIN(nvecp,isnvec,1)
+DECLARE_BUILTIN(vsum,nvec_sum,1)
+DECLARE_BUILTIN(vmin,nvec_min,1)
+DECLARE_BUILTIN(vmax,nvec_max,1)
+DECLARE_BUILTIN(vdot,nvec_dot,2)
+
+/* gc telemetry and tables (the functions are in table.c) */
+DECLARE_BUILTIN(gcstats,rsp_gc_stats,0)
+DECLARE_BUILTIN(tablefrom,rsp_table_from,1)
 
 /* 
    constructors that might create new heap objects take their arguments as a single stack, in case allocation triggers the GC.
@@ -132,11 +100,65 @@ DECLARE_BUILTIN_N(cons,rsp_cons)
 DECLARE_BUILTIN_N(sym,rsp_sym)
 DECLARE_BUILTIN_N(str,rsp_str)
 DECLARE_BUILTIN_N(iostream,rsp_iostream)
+DECLARE_BUILTIN_N(reduce,rsp_tb_reduce)
+DECLARE_BUILTIN_N(each,rsp_tb_each)
 DECLARE_BUILTIN_V(list,rsp_list)
 DECLARE_BUILTIN_V(fvec,rsp_fvec)
 DECLARE_BUILTIN_V(dvec,rsp_dvec)
 DECLARE_BUILTIN_V(table,rsp_table)
 
+/*
+   builtins that take their arguments as a stack, by their lisp names. This is what the toplevel
+   namespace gets bound from; rsp_builtin_ref looks one up by name.
+ */
+const rsp_bltn_spec_t RSP_BUILTINS[] =
+  {
+    { "int?",       bltn_intp_,       1 },
+    { "float?",     bltn_floatp_,     1 },
+    { "char?",      bltn_charp_,      1 },
+    { "cons?",      bltn_consp_,      1 },
+    { "list?",      bltn_listp_,      1 },
+    { "function?",  bltn_functionp_,  1 },
+    { "table?",     bltn_tablep_,     1 },
+    { "dvec?",      bltn_dvecp_,      1 },
+    { "fvec?",      bltn_fvecp_,      1 },
+    { "type?",      bltn_typep_,      1 },
+    { "bool?",      bltn_boolp_,      1 },
+    { "nil?",       bltn_nilp_,       1 },
+    { "none?",      bltn_nonep_,      1 },
+    { "true?",      bltn_truep_,      1 },
+    { "false?",     bltn_falsep_,     1 },
+    { "int",        bltn_int_,        1 },
+    { "float",      bltn_float_,      1 },
+    { "char",       bltn_char_,       1 },
+    { "id?",        bltn_idp_,        2 },
+    { "eqv?",       bltn_eqvp_,       2 },
+    { "isa?",       bltn_isap_,       2 },
+    { "typeof",     bltn_rtypeof_,    1 },
+    { "atomic?",    bltn_atomicp_,    1 },
+    { "callable?",  bltn_callablep_,  1 },
+    { "numeric?",   bltn_numericp_,   1 },
+    { "nvec?",      bltn_nvecp_,      1 },
+    { "vsum",       bltn_vsum_,       1 },
+    { "vmin",       bltn_vmin_,       1 },
+    { "vmax",       bltn_vmax_,       1 },
+    { "vdot",       bltn_vdot_,       2 },
+    { "gc-stats",   bltn_gcstats_,    0 },
+    { "table-from", bltn_tablefrom_,  1 },
+    { "reduce",     bltn_reduce_,     3 },
+    { "each",       bltn_each_,       2 },
+    { NULL,         NULL,             0 },
+  };
+
+const rsp_bltn_spec_t* rsp_builtin_ref(const chr_t* name)
+{
+  for (const rsp_bltn_spec_t* b = RSP_BUILTINS; b->name; b++)
+    if (!strcmp(b->name,name))
+      return b;
+
+  return NULL;
+}
+
 /* inlined functional bindings for C arithmetic */
 
 // arithmetic
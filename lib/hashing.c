@@ -62,14 +62,14 @@ inline hash_t hash_string(const chr_t* s, uint32_t r)
   return hash_bytes((uchr_t*)s, r, strlen(s));
 }
 
-inline hash_t hash_int(const int32_t i, uint32_t r)
+inline hash_t hash_int(const int64_t i, uint32_t r)
 {
-  return hash_bytes((uchr_t*)(&i), r, 4);
+  return hash_bytes((uchr_t*)(&i), r, 8);
 }
 
-inline hash_t hash_float(const flt32_t f, uint32_t r)
+inline hash_t hash_float(const flt64_t f, uint32_t r)
 {
-  return hash_bytes((uchr_t*)(&f), r, 4);
+  return hash_bytes((uchr_t*)(&f), r, 8);
 }
 
 
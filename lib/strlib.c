@@ -42,7 +42,7 @@ int u8strlen(const char* s)
   while ((next_cp = u8len(s)) != 0) {
     if (next_cp == -1) return -1;
     count++;
-    s++;
+    s += next_cp;
   }
 
   return count;
@@ -60,19 +60,17 @@ int u8strcmp(const char* sx, const char* sy)
 	return -2;
       if (yul == -1)
 	return 2;
-      if (xul < yul)
-	return -1;
-      if (xul > yul)
-	return 1;
+      if (wcx != wcy)
+	return wcx < wcy ? -1 : 1;
 
       sx += xul;
       sy += yul;
     }
 
-  if (*sx == '\0')
+  if (*sx == *sy)
+    return 0;
+  else if (*sx == '\0')
     return -1;
-  else if (*sy == '\0')
-    return 1;
   else
-    return 0;
+    return 1;
 }
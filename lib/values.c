@@ -1,5 +1,6 @@
 #include "../include/values.h"
 #include "../include/describe.h"
+#include "../include/mem.h"
 
 /* tag manipulation, type testing, pointer tracing */
 inline uint32_t ltag(val_t v)
@@ -7,23 +8,58 @@ inline uint32_t ltag(val_t v)
   return v & LTAG_MASK ;
 }
 
-tpkey_t tpkey(val_t v)
+/*
+   flonums - a double whose exponent is within 2^-62 <= |x| < 2^65 (or which is zero) is stored
+   in the upper 60 bits as its sign, the low 7 bits of its rebiased exponent and its full
+   mantissa. Anything else (including infinities and NaNs) is boxed as a FLOAT cvalue.
+ */
+#define FLONUM_EBIAS  960ul
+#define FLONUM_EMAX   127ul
+#define MANTISSA_MASK ((1ul << 52) - 1)
+
+inline bool flonum_fits(rflt_t f)
+{
+  uint64_t bits; memcpy(&bits,&f,8);
+  uint64_t e = (bits >> 52) & 0x7ff;
+
+  if (!e)
+    return !(bits & MANTISSA_MASK);
+
+  return e > FLONUM_EBIAS && e <= FLONUM_EBIAS + FLONUM_EMAX;
+}
+
+inline val_t flonum(rflt_t f)
 {
-  if (!(v & PTR_MASK))
-    return NIL;
+  uint64_t bits; memcpy(&bits,&f,8);
+  uint64_t e = (bits >> 52) & 0x7ff;
 
-  tpkey_t n = ltag(v);
-  switch (n)
+  if (e)
+    e -= FLONUM_EBIAS;
+
+  val_t payload = (bits >> 63) << 59 | e << 52 | (bits & MANTISSA_MASK);
+  return payload << 4 | FLONUM_TAG;
+}
+
+rflt_t fval(val_t v)
+{
+  rflt_t out;
+
+  if (isflonum(v))
     {
-      case PAIR ... IOSTRM:
-        return n;
-
-    case OBJECT ... FUNCTION:
-      return objhead(v)->type;
-	
-    case DIRECT: default:
-      return v & DTYPE_MASK;
+      val_t payload = v >> 4;
+      uint64_t e = (payload >> 52) & FLONUM_EMAX;
+
+      if (e)
+	e += FLONUM_EBIAS;
+
+      uint64_t bits = (payload >> 59) << 63 | e << 52 | (payload & MANTISSA_MASK);
+      memcpy(&out,&bits,8);
     }
+
+  else
+    memcpy(&out,((cval_t*)objhead(v))->c_data,8);
+
+  return out;
 }
 
 inline val_t addr(val_t v)
@@ -64,7 +100,7 @@ bool v_aligned(val_t v)
 
 inline obj_t* objhead(val_t v)
 {
-  return ptr(obj_t*,trace_fptr(v));
+  return ptr(obj_t*,v);
 }
 
 
@@ -115,6 +151,15 @@ hash_t   val_rehash(val_t v, uint32_t r)
   return to->tp_capi->hash(v,(to->tp_tpkey+1)*r);
 }
 
+// call f on the n values in args, which are already evaluated (the callee's type does the call)
+val_t rsp_apply(val_t f, val_t* args, size_t n)
+{
+  type_t* to = val_type(f);
+  assert(to->tp_capi->call,TYPE_ERR,"callable",to->name);
+
+  return to->tp_capi->call(ptr(type_t*,f),args,n);
+}
+
 /* predicates */
   MK_EQUALITY_PREDICATE(R_NIL,nil)
   MK_EQUALITY_PREDICATE(R_TRUE,true)
@@ -143,11 +188,17 @@ inline bool isallocated(val_t v, type_t* to)
   return false;
 }
 
+// only references into the heap can be forwarded
+static inline bool isfwdable(val_t v)
+{
+  return (v & PTR_MASK) && ltag(v) != DIRECT && ltag(v) != IOSTRM;
+}
+
 val_t trace_fptr(val_t v)
 {
-  if (isallocated(v, NULL))
+  if (isfwdable(v))
     while (isfptr(car_(v)))
-      v = cdr_(v);
+      v = fwd_(v);
 
   return v;
 }
@@ -155,9 +206,9 @@ val_t trace_fptr(val_t v)
 
 val_t _update_fptr(val_t* v)
 {
-  if (isallocated(*v,NULL))
+  if (isfwdable(*v))
     while (isfptr(car_(*v)))
-      *v = cdr_(*v);
+      *v = fwd_(*v);
 
   return *v;
 }
@@ -240,7 +291,7 @@ val_t datatype_call(type_t* to, val_t* args, size_t argc)
 
   if (to->tp_ltag == DIRECT)
     {
-      if (to->tp_tpkey <= INTEGER)
+      if (to->tp_tpkey <= BOOL)
 	new = capi->builtin_new((val_t)args, argc);
 
       else
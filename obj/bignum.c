@@ -0,0 +1,557 @@
+#include "../include/bignum.h"
+
+
+MK_TYPE_PREDICATE(CVALUE,BIGNUM,bignum)
+MK_SAFECAST_P(bignum_t*,bignum,addr)
+
+typedef unsigned __int128 dlimb_t;
+
+/*
+   magnitude arithmetic. These work on plain limb arrays outside the heap, so the collector
+   can't move anything out from under them; only the final result is copied into a bignum.
+ */
+
+// the length of a magnitude without its leading zero limbs
+static inline size_t mag_len(const limb_t* a, size_t n)
+{
+  while (n && !a[n-1])
+    n--;
+
+  return n;
+}
+
+static int32_t mag_cmp(const limb_t* a, size_t na, const limb_t* b, size_t nb)
+{
+  if (na != nb)
+    return na < nb ? -1 : 1;
+
+  for (size_t i = na; i--;)
+    if (a[i] != b[i])
+      return a[i] < b[i] ? -1 : 1;
+
+  return 0;
+}
+
+// a += b (na >= nb); returns the carry out of the top limb of a
+static limb_t mag_addto(limb_t* a, size_t na, const limb_t* b, size_t nb)
+{
+  limb_t c = 0;
+  size_t i = 0;
+
+  for (; i < nb; i++)
+    {
+      dlimb_t s = (dlimb_t)a[i] + b[i] + c;
+      a[i]      = (limb_t)s;
+      c         = s >> 64;
+    }
+
+  for (; c && i < na; i++)
+    c = ++a[i] == 0;
+
+  return c;
+}
+
+// a -= b (a >= b)
+static void mag_subfrom(limb_t* a, size_t na, const limb_t* b, size_t nb)
+{
+  limb_t br = 0;
+  size_t i = 0;
+
+  for (; i < nb; i++)
+    {
+      limb_t x = a[i], y = b[i];
+      a[i]     = x - y - br;
+      br       = x < y || x - y < br;
+    }
+
+  for (; br && i < na; i++)
+    br = a[i]-- == 0;
+}
+
+// a = a * m + c over n limbs; returns the limb carried out
+static limb_t mag_muladd(limb_t* a, size_t n, limb_t m, limb_t c)
+{
+  for (size_t i = 0; i < n; i++)
+    {
+      dlimb_t t = (dlimb_t)a[i] * m + c;
+      a[i]      = (limb_t)t;
+      c         = t >> 64;
+    }
+
+  return c;
+}
+
+// a = a / d in place; returns the remainder
+static limb_t mag_divsmall(limb_t* a, size_t n, limb_t d)
+{
+  dlimb_t rem = 0;
+
+  for (size_t i = n; i--;)
+    {
+      dlimb_t cur = rem << 64 | a[i];
+      a[i]        = (limb_t)(cur / d);
+      rem         = cur % d;
+    }
+
+  return (limb_t)rem;
+}
+
+// r = a * b, writing all na + nb limbs of r
+static void mag_mul_school(limb_t* r, const limb_t* a, size_t na, const limb_t* b, size_t nb)
+{
+  memset(r,0,(na + nb) * sizeof(limb_t));
+
+  for (size_t j = 0; j < nb; j++)
+    {
+      limb_t c = 0;
+
+      for (size_t i = 0; i < na; i++)
+	{
+	  dlimb_t t = (dlimb_t)a[i] * b[j] + r[i+j] + c;
+	  r[i+j]    = (limb_t)t;
+	  c         = t >> 64;
+	}
+
+      r[na+j] = c;
+    }
+}
+
+/*
+   r = a * b by Karatsuba's method, writing all na + nb limbs of r. With a = a1*B^m + a0 and
+   b = b1*B^m + b0, the middle product a0*b1 + a1*b0 is (a0 + a1)(b0 + b1) - a0*b0 - a1*b1, so
+   each level does three half-size products instead of four. Operands of very different
+   lengths are multiplied a slice of the longer one at a time.
+ */
+static void mag_mul(limb_t* r, const limb_t* a, size_t na, const limb_t* b, size_t nb)
+{
+  if (na < nb)
+    {
+      const limb_t* t = a; a = b; b = t;
+      size_t nt = na; na = nb; nb = nt;
+    }
+
+  if (nb < KARATSUBA_CUTOFF)
+    {
+      mag_mul_school(r,a,na,b,nb);
+      return;
+    }
+
+  if (2 * nb <= na)
+    {
+      limb_t* t = vm_cmalloc(2 * nb * sizeof(limb_t));
+      memset(r,0,(na + nb) * sizeof(limb_t));
+
+      for (size_t i = 0; i < na; i += nb)
+	{
+	  size_t k = min(nb, na - i);
+	  mag_mul(t,a+i,k,b,nb);
+	  mag_addto(r+i,na+nb-i,t,k+nb);
+	}
+
+      vm_cfree(t);
+      return;
+    }
+
+  size_t  m  = na / 2, n1 = na - m, n2 = nb - m;
+  size_t  ns = n1 + 1, nt = max(m,n2) + 1;
+  limb_t* sa = vm_cmalloc(2 * (ns + nt) * sizeof(limb_t));
+  limb_t* sb = sa + ns, *z1 = sb + nt;
+
+  memcpy(sa,a+m,n1 * sizeof(limb_t));
+  sa[n1] = 0;
+  mag_addto(sa,ns,a,m);
+
+  memset(sb,0,nt * sizeof(limb_t));
+  memcpy(sb,b,m * sizeof(limb_t));
+  mag_addto(sb,nt,b+m,n2);
+
+  // the outer products go straight into r
+  mag_mul(r,a,m,b,m);
+  mag_mul(r+2*m,a+m,n1,b+m,n2);
+  mag_mul(z1,sa,ns,sb,nt);
+
+  mag_subfrom(z1,ns+nt,r,2*m);
+  mag_subfrom(z1,ns+nt,r+2*m,n1+n2);
+  mag_addto(r+m,na+nb-m,z1,mag_len(z1,ns+nt));
+
+  vm_cfree(sa);
+}
+
+/*
+   q = a / b and r = a % b (Knuth's algorithm D). b has no leading zero limbs and na >= nb;
+   q gets na - nb + 1 limbs and r gets nb.
+ */
+static void mag_divmod(limb_t* q, limb_t* r, const limb_t* a, size_t na, const limb_t* b, size_t nb)
+{
+  if (nb == 1)
+    {
+      memcpy(q,a,na * sizeof(limb_t));
+      r[0] = mag_divsmall(q,na,b[0]);
+      return;
+    }
+
+  // shift both operands so that the top limb of the divisor has its high bit set
+  int32_t s  = __builtin_clzl(b[nb-1]);
+  limb_t* bn = vm_cmalloc((nb + na + 1) * sizeof(limb_t));
+  limb_t* an = bn + nb;
+
+  for (size_t i = nb; i--;)
+    bn[i] = b[i] << s | (s && i ? b[i-1] >> (64 - s) : 0);
+
+  an[na] = s ? a[na-1] >> (64 - s) : 0;
+
+  for (size_t i = na; i--;)
+    an[i] = a[i] << s | (s && i ? a[i-1] >> (64 - s) : 0);
+
+  for (size_t j = na - nb + 1; j--;)
+    {
+      dlimb_t num  = (dlimb_t)an[j+nb] << 64 | an[j+nb-1];
+      dlimb_t qhat = num / bn[nb-1];
+      dlimb_t rhat = num % bn[nb-1];
+
+      while (qhat >> 64 || qhat * bn[nb-2] > (rhat << 64 | an[j+nb-2]))
+	{
+	  qhat--;
+	  rhat += bn[nb-1];
+
+	  if (rhat >> 64)
+	    break;
+	}
+
+      // an[j..j+nb] -= qhat * bn
+      limb_t br = 0, c = 0;
+
+      for (size_t i = 0; i < nb; i++)
+	{
+	  dlimb_t p  = qhat * bn[i] + c;
+	  limb_t  lo = (limb_t)p, x = an[i+j];
+	  c          = p >> 64;
+	  an[i+j]    = x - lo - br;
+	  br         = x < lo || x - lo < br;
+	}
+
+      limb_t x  = an[j+nb];
+      an[j+nb]  = x - c - br;
+
+      // qhat was one too large; add the divisor back
+      if (x < c || x - c < br)
+	{
+	  qhat--;
+	  an[j+nb] += mag_addto(an+j,nb,bn,nb);
+	}
+
+      q[j] = (limb_t)qhat;
+    }
+
+  for (size_t i = 0; i < nb; i++)
+    r[i] = an[i] >> s | (s ? an[i+1] << (64 - s) : 0);
+
+  vm_cfree(bn);
+}
+
+/* integer arguments as a magnitude and a sign (a fixnum is widened into the view itself) */
+typedef struct
+{
+  const limb_t* limbs;
+  size_t        n;
+  bool          neg;
+  limb_t        small;
+} bn_view_t;
+
+static void bn_view(val_t x, bn_view_t* v)
+{
+  if (isfixnum(x))
+    {
+      rint_t i = ival(x);
+      v->neg   = i < 0;
+      v->small = v->neg ? -(limb_t)i : (limb_t)i;
+      v->limbs = &v->small;
+      v->n     = v->small != 0;
+    }
+
+  else
+    {
+      bignum_t* b = tobignum(x);
+      v->neg      = b->cmeta & BN_NEG;
+      v->limbs    = b->limbs;
+      v->n        = b->size;
+    }
+}
+
+// views are only good until the next allocation, so results are built in a scratch buffer first
+static val_t bn_result(limb_t* r, size_t n, bool neg)
+{
+  val_t out = mk_bignum(r,n,neg);
+  vm_cfree(r);
+  return out;
+}
+
+/* object constructors */
+// limbs must not point into the heap (the allocation may move it)
+val_t mk_bignum(const limb_t* limbs, size_t n, bool neg)
+{
+  n = mag_len(limbs,n);
+
+  if (!n)
+    return R_ZERO;
+
+  if (n == 1 && limbs[0] <= (limb_t)FIXNUM_MAX + neg)
+    return fixnum(neg ? -(rint_t)limbs[0] : (rint_t)limbs[0]);
+
+  bignum_t* b = vm_allocw(16,n);
+  b->type     = BIGNUM;
+  b->cmeta    = neg ? BN_NEG : 0;
+  b->size     = n;
+  memcpy(b->limbs,limbs,n * sizeof(limb_t));
+
+  return (val_t)b | CVALUE;
+}
+
+#define DEC_CHUNK     10000000000000000000ul   // 10^19, the largest power of ten in a limb
+#define DEC_CHUNK_LEN 19
+
+static inline uint32_t digit_val(chr_t c)
+{
+  return c >= '0' && c <= '9' ? (uint32_t)(c - '0') : UINT32_MAX;
+}
+
+/*
+   read a decimal integer literal of any length (the reader's syntax, like stoi). Digits are
+   consumed as many at a time as fit in a limb, so each pass over the magnitude takes 19 of
+   them rather than one.
+ */
+val_t bn_parse(const chr_t* s)
+{
+  bool neg = false;
+
+  if (*s == '-' || *s == '+')
+    neg = *s++ == '-';
+
+  size_t nd = strlen(s), chunk = DEC_CHUNK_LEN;
+
+  if (!nd)
+    return R_EOF;
+
+  size_t  n = nd / 16 + 2, used = 0;      // less than 4 bits per digit
+  limb_t* r = vm_cmalloc(n * sizeof(limb_t));
+  memset(r,0,n * sizeof(limb_t));
+
+  for (size_t i = 0, k = nd % chunk ? nd % chunk : chunk; i < nd; k = chunk)
+    {
+      limb_t d = 0, m = 1;
+
+      for (size_t end = i + k; i < end; i++)
+	{
+	  uint32_t dv = digit_val(s[i]);
+
+	  if (dv > 9)
+	    {
+	      vm_cfree(r);
+	      return R_EOF;
+	    }
+
+	  d  = d * 10 + dv;
+	  m *= 10;
+	}
+
+      limb_t c = mag_muladd(r,used,m,d);
+
+      if (c)
+	r[used++] = c;
+    }
+
+  return bn_result(r,n,neg);
+}
+
+/* arithmetic */
+static val_t bn_addsub(val_t x, val_t y, bool negy)
+{
+  bn_view_t a, b, *big = &a, *sml = &b;
+  bn_view(x,&a);
+  bn_view(y,&b);
+  b.neg ^= negy;
+
+  // the larger magnitude goes in the result first (and gives its sign whether or not the signs agree)
+  if (mag_cmp(a.limbs,a.n,b.limbs,b.n) < 0)
+    {
+      big = &b;
+      sml = &a;
+    }
+
+  // add the magnitudes if the signs agree, otherwise take the smaller from the larger
+  size_t  n = max(a.n,b.n) + 1;
+  limb_t* r = vm_cmalloc(n * sizeof(limb_t));
+
+  memset(r,0,n * sizeof(limb_t));
+  memcpy(r,big->limbs,big->n * sizeof(limb_t));
+
+  if (a.neg == b.neg)
+    mag_addto(r,n,sml->limbs,sml->n);
+
+  else
+    mag_subfrom(r,n,sml->limbs,sml->n);
+
+  return bn_result(r,n,big->neg);
+}
+
+inline val_t bn_add(val_t x, val_t y) { return bn_addsub(x,y,false); }
+inline val_t bn_sub(val_t x, val_t y) { return bn_addsub(x,y,true); }
+
+val_t bn_mul(val_t x, val_t y)
+{
+  bn_view_t a, b;
+  bn_view(x,&a);
+  bn_view(y,&b);
+
+  if (!a.n || !b.n)
+    return R_ZERO;
+
+  size_t  n = a.n + b.n;
+  limb_t* r = vm_cmalloc(n * sizeof(limb_t));
+  mag_mul(r,a.limbs,a.n,b.limbs,b.n);
+
+  return bn_result(r,n,a.neg != b.neg);
+}
+
+// truncating division; the remainder takes the sign of the dividend
+static val_t bn_divmod(val_t x, val_t y, bool rem)
+{
+  bn_view_t a, b;
+  bn_view(x,&a);
+  bn_view(y,&b);
+
+  assert(b.n,VALUE_ERR,"division by zero");
+
+  if (mag_cmp(a.limbs,a.n,b.limbs,b.n) < 0)
+    return rem ? x : R_ZERO;
+
+  size_t  nq = a.n - b.n + 1;
+  limb_t* q  = vm_cmalloc((nq + b.n) * sizeof(limb_t));
+  limb_t* r  = q + nq;
+  mag_divmod(q,r,a.limbs,a.n,b.limbs,b.n);
+
+  if (rem)
+    memmove(q,r,b.n * sizeof(limb_t));
+
+  return bn_result(q,rem ? b.n : nq,rem ? a.neg : a.neg != b.neg);
+}
+
+inline val_t bn_div(val_t x, val_t y) { return bn_divmod(x,y,false); }
+inline val_t bn_rem(val_t x, val_t y) { return bn_divmod(x,y,true); }
+
+val_t bn_neg(val_t x)
+{
+  bn_view_t a;
+  bn_view(x,&a);
+
+  limb_t* r = vm_cmalloc(max(a.n,1ul) * sizeof(limb_t));
+  memcpy(r,a.limbs,a.n * sizeof(limb_t));
+
+  return bn_result(r,a.n,!a.neg);
+}
+
+rflt_t bn_fval(val_t x)
+{
+  bn_view_t a;
+  bn_view(x,&a);
+
+  rflt_t out = 0;
+
+  for (size_t i = a.n; i--;)
+    out = out * 0x1p64 + (rflt_t)a.limbs[i];
+
+  return a.neg ? -out : out;
+}
+
+/* ordering, hashing and printing */
+int32_t bn_ord(val_t x, val_t y)
+{
+  bn_view_t a, b;
+  bn_view(x,&a);
+  bn_view(y,&b);
+
+  if (a.neg != b.neg)
+    return a.neg ? -1 : 1;
+
+  int32_t c = mag_cmp(a.limbs,a.n,b.limbs,b.n);
+  return a.neg ? -c : c;
+}
+
+hash_t bn_hash(val_t x, uint32_t r)
+{
+  bignum_t* b = tobignum(x);
+  return hash_bytes((uchr_t*)b->limbs, r + (b->cmeta & BN_NEG), b->size * sizeof(limb_t));
+}
+
+// nineteen digits per division of the magnitude (a limb holds at most twenty)
+void bn_prn(val_t x, riostrm_t* f)
+{
+  bignum_t* b = tobignum(x);
+  size_t    n = b->size, k = 0;
+  limb_t*   t = vm_cmalloc((n + n * 20 / DEC_CHUNK_LEN + 2) * sizeof(limb_t));
+  limb_t*   chunks = t + n;
+
+  memcpy(t,b->limbs,n * sizeof(limb_t));
+
+  if (b->cmeta & BN_NEG)
+    fputc('-',f);
+
+  while (n)
+    {
+      chunks[k++] = mag_divsmall(t,n,DEC_CHUNK);
+      n           = mag_len(t,n);
+    }
+
+  fprintf(f,"%" PRIu64,chunks[--k]);
+
+  while (k--)
+    fprintf(f,"%0*" PRIu64,DEC_CHUNK_LEN,chunks[k]);
+
+  vm_cfree(t);
+  return;
+}
+
+static uint8_t bn_isalloc(type_t* to, val_t x)
+{
+  (void)to; (void)x;
+  return true;
+}
+
+
+cvspec_t BIGNUM_CVSPEC =
+  {
+    .el_cnum = CNUM_UINT64,
+    .el_cptr = PTR_NONE,
+    .el_sz   = 8,
+  };
+
+capi_t BIGNUM_CAPI =
+  {
+    .prn         = bn_prn,
+    .call        = NULL,
+    .size        = cv_size,
+    .elcnt       = cv_elcnt,
+    .hash        = bn_hash,
+    .ord         = bn_ord,
+    .new         = NULL,
+    .builtin_new = NULL,
+    .init        = NULL,
+    .relocate    = cv_relocate,
+    .isalloc     = bn_isalloc,
+  };
+
+type_t BIGNUM_TYPE_OBJ =
+  {
+    .type              = DATATYPE,
+    .cmeta             = BIGNUM,
+    .tp_tpkey          = BIGNUM,
+    .tp_ltag           = CVALUE,
+    .tp_isalloc        = true,
+    .tp_sizing         = WIDE_LEN,
+    .tp_init_sz        = 16,
+    .tp_base_sz        = 16,
+    .tp_nfields        = 0,
+    .tp_cvtable        = &BIGNUM_CVSPEC,
+    .tp_capi           = &BIGNUM_CAPI,
+    .name              = "bignum",
+  };
@@ -8,12 +8,19 @@ inline uint32_t popcnt(uint32_t b)
 }
 
 
-bvec_t* mk_bvec(size_t sz, bool gl)
+// sz is in elements, width is the number of elements per entry
+bvec_t* mk_bvec(size_t sz, uint32_t width, bool gl)
 {
-  assert(sz <= 32, BOUNDS_ERR);
-  bvec_t* out = gl ? vm_cmalloc((1+sz)*8) : vm_allocw(8,sz);
-  out->type = BVECTOR;
-  out->bv_bmap = 0;
+  assert(sz <= BVEC_MAX, BOUNDS_ERR);
+  bvec_t* out = gl ? vm_cmalloc(BVEC_HDR_SZ+sz*8) : vm_allocw(BVEC_HDR_SZ,sz);
+  out->type     = BVECTOR;
+  out->bv_bmap  = 0;
+  out->bv_nmap  = 0;
+  out->bv_edit  = 0;
+  out->bv_cap   = sz;
+  out->bv_width = width;
+  out->bv_pad   = 0;
+  memset(out->bv_elements,0,sz*8);
 
   return out;
 }
@@ -22,12 +29,18 @@ bvec_t* mk_bvec(size_t sz, bool gl)
 size_t bvec_elcnt(val_t b)
 {
   bvec_t* bv = tobvec(b);
-  return popcnt(bv->bv_bmap);
+  return popcnt(bv->bv_bmap) + popcnt(bv->bv_nmap);
+}
+
+// elements in use
+inline size_t bvec_used(bvec_t* bv)
+{
+  return popcnt(bv->bv_bmap) * bv->bv_width + popcnt(bv->bv_nmap);
 }
 
 size_t bvec_sizeof(type_t* to, val_t b)
 {
-  return to->tp_base_sz + bvec_elcnt(b) * 8;
+  return to->tp_base_sz + ptr(bvec_t*,b)->bv_cap * 8;
 }
 
 inline uint32_t bmtoidx(uint32_t bmp)
@@ -38,16 +51,66 @@ inline uint32_t bmtoidx(uint32_t bmp)
 
 inline uint8_t idxtobm(uint32_t bmp, uint8_t idx)
 {
-  return popcnt(bmp & ((1 << idx) - 1));
+  return popcnt(bmp & ((1u << idx) - 1));
 }
 
 
+// the entry in slot idx
 val_t* bvec_ref(bvec_t* bv, uint8_t idx)
 {
-  assert(idx <= 32, BOUNDS_ERR);
-  if (bv->bv_bmap & (1 << idx))
-    return bv->bv_elements + idxtobm(bv->bv_bmap,idx);
+  assert(idx < 32, BOUNDS_ERR);
+  if (bv->bv_bmap & (1u << idx))
+    return bv->bv_elements + idxtobm(bv->bv_bmap,idx) * bv->bv_width;
+
+  else
+    return NULL;
+}
+
+// the subnode in slot idx
+val_t* bvec_child(bvec_t* bv, uint8_t idx)
+{
+  assert(idx < 32, BOUNDS_ERR);
+  if (bv->bv_nmap & (1u << idx))
+    return bv->bv_elements + popcnt(bv->bv_bmap) * bv->bv_width + idxtobm(bv->bv_nmap,idx);
 
   else
     return NULL;
 }
+
+// HAMT nodes are traced through every element, spare room included (it's kept zeroed)
+static uint8_t bvec_isalloc(type_t* to, val_t x)
+{
+  (void)to; (void)x;
+  return true;
+}
+
+capi_t BVEC_CAPI =
+  {
+    .prn         = NULL,
+    .call        = NULL,
+    .size        = bvec_sizeof,
+    .elcnt       = bvec_elcnt,
+    .hash        = NULL,
+    .ord         = NULL,
+    .new         = NULL,
+    .builtin_new = NULL,
+    .init        = NULL,
+    .relocate    = NULL,
+    .isalloc     = bvec_isalloc,
+  };
+
+type_t BVEC_TYPE_OBJ =
+  {
+    .type              = DATATYPE,
+    .cmeta             = BVECTOR,
+    .tp_tpkey          = BVECTOR,
+    .tp_ltag           = OBJECT,
+    .tp_isalloc        = true,
+    .tp_sizing         = VARIABLE,
+    .tp_init_sz        = BVEC_HDR_SZ,
+    .tp_base_sz        = BVEC_HDR_SZ,
+    .tp_nfields        = 0,
+    .tp_cvtable        = NULL,
+    .tp_capi           = &BVEC_CAPI,
+    .name              = "bvec",
+  };
@@ -1,4 +1,11 @@
 #include "../include/rsp_core.h"
+#include "../include/mem.h"
+#include "../include/describe.h"
+#include "../include/bignum.h"
+#include "../include/rstr.h"
+
+
+MK_TYPE_PREDICATE(CVALUE,FLOAT,boxed_float)
 
 
 val_t mk_bool(int32_t i)
@@ -12,7 +19,7 @@ val_t mk_bool(int32_t i)
 
 val_t cnvt_bool(val_t v)
 {
-  if (isbool(v))
+  if (istrue(v) || isfalse(v))
     return v;
 
   else if (isnil(v))
@@ -28,11 +35,32 @@ val_t mk_char(int32_t i)
     return R_EOF;
 
   else
-    return tag_v(i,CHAR);
+    return (val_t)i << 32 | CHAR | DIRECT;
+}
+
+// doubles outside the flonum range are boxed
+val_t mk_float(rflt_t f)
+{
+  if (likely(flonum_fits(f)))
+    return flonum(f);
+
+  cval_t* box = vm_alloc(sizeof(cval_t), 0, 8);
+  box->type   = FLOAT;
+  box->cmeta  = 0;
+  memcpy(box->c_data,&f,8);
+
+  return (val_t)box | CVALUE;
 }
 
-inline val_t mk_int(int32_t i) { return tag_v(i,INT);  }
+// integers that don't fit in a fixnum become bignums
+inline val_t mk_int(rint_t i)
+{
+  if (likely(fixnum_fits(i)))
+    return fixnum(i);
 
+  limb_t mag = i < 0 ? -(limb_t)i : (limb_t)i;
+  return mk_bignum(&mag,1,i < 0);
+}
 
 val_t stoi(chr_t* s)
 {
@@ -43,37 +71,34 @@ val_t stoi(chr_t* s)
 
   chr_t* end;
 
-  int64_t cnvt = strtol(s,&end,0);
+  // decimal only, so a leading zero doesn't make a literal octal
+  errno = 0;
+  int64_t cnvt = strtoll(s,&end,10);
 
-  if (*end != '\0')
+  if (end == s || *end != '\0')
     return out;
 
-  else
-    {
-      cnvt = min(cnvt,INT32_MAX);
-      out = (val_t)cnvt << 32 | INT;
-      return out;
-    }
+  if (errno == ERANGE)
+    return bn_parse(s);
+
+  return mk_int(cnvt);
 }
 
 val_t stof(chr_t* s)
 {
-  val_t out = R_NAN;
+  val_t out = R_EOF;
   if (iswspace(s[0]))
     return out;
 
   chr_t* end;
 
-  flt32_t fl = strtof(s,&end);
+  rflt_t fl = strtod(s,&end);
   if (*end != '\0')
-    return R_NAN;
+    return out;
 
-  else
-    return tag_v(fl,FLOAT);
+  return mk_float(fl);
 }
 
-inline val_t mk_float(flt32_t f) { return tag_v(f,FLOAT_TP); }
-
 val_t cnvt_float(val_t v)
 {
   switch (tpkey(v))
@@ -81,47 +106,68 @@ val_t cnvt_float(val_t v)
     case FLOAT:
       return v;
 
-    case INT:
+    case INTEGER:
       return val_itof(v);
 
-    case STRING: case ATOM:
-      return stof(strval(v));
+    case STRING:
+      {
+	chr_t buf[8];
+	return stof((chr_t*)rstr_chars(v,buf));
+      }
 
     default:
-      rsp_raise(TYPE_ERR);
-      return R_NAN;
+      assert(false,TYPE_ERR,"float",val_typename(v));
+      return R_EOF;
     }
 }
 
-hash32_t hash_small(val_t v)
+// direct values are hashed by their whole word (boxed floats by their value)
+hash_t hash_small(val_t v, uint32_t r)
 {
-  uchr_t buf[4]; uint32_t sbits = unpad(v);
-  memcpy(buf,&sbits,4);
-  return hash_bytes(buf,4);
+  if (isboxed_float(v))
+    return hash_float(fval(v),r);
+
+  return hash_bytes((uchr_t*)&v,r,8);
 }
 
-void prn_float(val_t fl, iostrm_t* f)
+// the shortest of %.15g, %.16g and %.17g that reads back as the same double
+void prn_float(val_t fl, riostrm_t* f)
 {
-  flt32_t fv = fval(fl);
-  fprintf(f,"%.2f",fv);
+  rflt_t fv = fval(fl);
+  chr_t buf[32];
+
+  for (int32_t prec = 15; prec <= 17; prec++)
+    {
+      snprintf(buf,sizeof(buf),"%.*g",prec,fv);
+
+      if (strtod(buf,NULL) == fv)
+	break;
+    }
+
+  fputs(buf,f);
+
+  // keep floats that happen to be integral from reading back as integers
+  if (isfinite(fv) && !strpbrk(buf,".en"))
+    fputs(".0",f);
+
   return;
 }
 
-void prn_char(val_t ch, iostrm_t* f)
+void prn_char(val_t ch, riostrm_t* f)
 {
-  ichr32_t chv = cval(ch);
+  rchr_t chv = cval(ch);
   fputwc(chv,f);
   return;
 }
 
-void prn_int(val_t i, iostrm_t* f)
+void prn_int(val_t i, riostrm_t* f)
 {
-  int32_t iv = ival(i);
-  fprintf(f,"%d",iv);
+  rint_t iv = ival(i);
+  fprintf(f,"%" PRId64,iv);
   return;
 }
 
-void prn_bool(val_t b, iostrm_t* f)
+void prn_bool(val_t b, riostrm_t* f)
 {
   if (b == R_TRUE)
     fputwc('t',f);
@@ -134,24 +180,74 @@ void prn_bool(val_t b, iostrm_t* f)
 
 int32_t ord_ival(val_t xi, val_t yi)
 {
-  int32_t xii = ival(xi), yii = ival(yi);
+  rint_t xii = ival(xi), yii = ival(yi);
   return compare(xii,yii);
 }
 
 int32_t ord_fval(val_t xf, val_t yf)
 {
-  flt32_t xff = fval(xf), yff = fval(yf);
+  rflt_t xff = fval(xf), yff = fval(yf);
   return compare(xff,yff);
 }
 
+// converting a double outside the range of rint_t is undefined, so NaNs and infinities are rejected here
 val_t val_ftoi(val_t f)
 {
-  flt32_t fl = ecall(tofloat,f);
-  return mk_int((int)fl);
+  rflt_t fl = fval(f);
+
+  assert(!isnan(fl),TYPE_ERR,"number","nan");
+  assert(fl >= -0x1p63 && fl < 0x1p63,BOUNDS_ERR,"float out of integer range");
+
+  return mk_int((rint_t)fl);
 }
 
 val_t val_itof(val_t i)
 {
-  int32_t iv = ecall(toint,i);
-  return mk_float((flt32_t)iv);
+  rint_t iv = ival(i);
+  return mk_float((rflt_t)iv);
 }
+
+uint8_t float_isalloc(type_t* to, val_t v)
+{
+  (void)to;
+  return ltag(v) == CVALUE;
+}
+
+/* boxed floats are plain 8-byte cvalues (flonums never reach these functions) */
+cvspec_t FLOAT_CVSPEC =
+  {
+    .el_cnum = CNUM_FLOAT64,
+    .el_cptr = PTR_NONE,
+    .el_sz   = 8,
+  };
+
+capi_t FLOAT_CAPI =
+  {
+    .prn         = prn_float,
+    .call        = NULL,
+    .size        = NULL,
+    .elcnt       = NULL,
+    .hash        = hash_small,
+    .ord         = ord_fval,
+    .new         = NULL,
+    .builtin_new = NULL,
+    .init        = NULL,
+    .relocate    = NULL,
+    .isalloc     = float_isalloc,
+  };
+
+type_t FLOAT_TYPE_OBJ =
+  {
+    .type              = DATATYPE,
+    .cmeta             = FLOAT,
+    .tp_tpkey          = FLOAT,
+    .tp_ltag           = CVALUE,                 // the tag of the boxed form
+    .tp_isalloc        = true,
+    .tp_sizing         = FIXED,
+    .tp_init_sz        = 8,
+    .tp_base_sz        = 16,
+    .tp_nfields        = 0,
+    .tp_cvtable        = &FLOAT_CVSPEC,
+    .tp_capi           = &FLOAT_CAPI,
+    .name              = "float",
+  };
@@ -0,0 +1,398 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "../include/mem.h"
+
+/*
+   parallel evacuation.
+
+   Every worker owns a private allocation chunk in the tospace and a Chase-Lev deque of grey
+   (copied but unscanned) objects. The tails of chunks are left unused, so gc_resize sizes the
+   tospace with gc_par_slack words to spare, and a claim that still runs past the committed
+   tospace commits more of its reservation. Idle workers steal from the top of other workers' deques.
+   An object is claimed by CAS-ing its first word from its original value to GC_BUSY; the
+   winner copies it, writes the forwarding address into the cdr and then publishes R_FPTR
+   in the car. Losers wait for R_FPTR and read the forwarding address.
+
+   Objects are copied shallowly and traced using the layout in their type (see gc_fields),
+   so the tp_capi->relocate callbacks (which recurse through gc_trace) are never called here.
+ */
+
+#define GC_LAB_SIZE    0x8000u           // bytes per private allocation chunk
+#define GC_DEQUE_SIZE  0x10000u          // must be a power of 2
+#define GC_DEQUE_MASK  (GC_DEQUE_SIZE - 1)
+#define GC_BUSY        (R_FPTR | 0x08u)  // never a valid first word
+
+size_t GC_NTHREADS = 1;
+
+typedef struct
+{
+  _Atomic(int64_t) top;
+  _Atomic(int64_t) bottom;
+  _Atomic(val_t)*  buf;
+} gc_deque_t;
+
+typedef struct
+{
+  pthread_t  thread;
+  size_t     id;
+  uchr_t    *lab, *lablim;   // private tospace chunk
+  gc_deque_t grey;
+  val_t*     ovf;            // unstealable overflow for a full deque
+  size_t     ovfcnt, ovfcap;
+  size_t     copied;         // bytes copied by this worker
+  size_t     objects[GC_STAT_NKEYS];
+} gc_worker_t;
+
+static gc_worker_t      GC_WORKERS[GC_MAX_THREADS];
+static size_t           GC_NWORKERS = 0;
+static _Atomic(uptr_t)  PFREE;
+static _Atomic(uptr_t)  PLIMIT;         // end of the committed tospace
+static uchr_t*          PBASE;          // start of the tospace
+static pthread_mutex_t  PGROW = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic(size_t)  GC_IDLE;
+
+/* work-stealing deque */
+static bool deque_push(gc_deque_t* d, val_t v)
+{
+  int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+  int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+
+  if (b - t >= (int64_t)GC_DEQUE_SIZE)
+    return false;
+
+  atomic_store_explicit(&d->buf[b & GC_DEQUE_MASK], v, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+  return true;
+}
+
+static bool deque_pop(gc_deque_t* d, val_t* out)
+{
+  int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+  atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  int64_t t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+  if (t > b)
+    {
+      atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+      return false;
+    }
+
+  *out = atomic_load_explicit(&d->buf[b & GC_DEQUE_MASK], memory_order_relaxed);
+
+  if (t == b) // last element, race against thieves for it
+    {
+      bool won = atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+							 memory_order_seq_cst,
+							 memory_order_relaxed);
+      atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+      return won;
+    }
+
+  return true;
+}
+
+static bool deque_steal(gc_deque_t* d, val_t* out)
+{
+  int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+  atomic_thread_fence(memory_order_seq_cst);
+  int64_t b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+
+  if (t >= b)
+    return false;
+
+  *out = atomic_load_explicit(&d->buf[t & GC_DEQUE_MASK], memory_order_relaxed);
+  return atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+						 memory_order_seq_cst,
+						 memory_order_relaxed);
+}
+
+static inline bool deque_isempty(gc_deque_t* d)
+{
+  return atomic_load_explicit(&d->top, memory_order_acquire)
+    >= atomic_load_explicit(&d->bottom, memory_order_acquire);
+}
+
+/* copying */
+// words the tospace needs past the live data to absorb the unused tails of the workers' chunks
+size_t gc_par_slack(void)
+{
+  if (GC_NTHREADS < 2 || GC_COLLECTOR != GC_SEMISPACE)
+    return 0;
+
+  return min(GC_NTHREADS, GC_MAX_THREADS) * GC_LAB_SIZE / 8;
+}
+
+// the slack was short (chunk tails wasted more than planned), so commit more of the reservation
+static void par_grow(uptr_t end)
+{
+  pthread_mutex_lock(&PGROW);
+
+  if (end > atomic_load_explicit(&PLIMIT, memory_order_relaxed))
+    {
+      size_t nwords = (end - (uptr_t)PBASE) / 8 + gc_par_slack();
+      heap_commit(PBASE,nwords);
+      atomic_store_explicit(&PLIMIT, (uptr_t)PBASE + nwords * 8, memory_order_release);
+    }
+
+  pthread_mutex_unlock(&PGROW);
+  return;
+}
+
+static uchr_t* par_claim(size_t nbytes)
+{
+  uptr_t out = atomic_fetch_add(&PFREE, nbytes);
+
+  if (out + nbytes > atomic_load_explicit(&PLIMIT, memory_order_acquire))
+    par_grow(out + nbytes);
+
+  return (uchr_t*)out;
+}
+
+static uchr_t* par_alloc(gc_worker_t* w, size_t asz)
+{
+  if (w->lab + asz <= w->lablim)
+    {
+      uchr_t* out = w->lab;
+      w->lab += asz;
+      return out;
+    }
+
+  if (asz > GC_LAB_SIZE / 4) // big objects get their own chunk, keep the current one
+    return par_claim(asz);
+
+  w->lab    = par_claim(GC_LAB_SIZE);
+  w->lablim = w->lab + GC_LAB_SIZE;
+  uchr_t* out = w->lab;
+  w->lab += asz;
+  return out;
+}
+
+static void par_push(gc_worker_t* w, val_t v)
+{
+  if (deque_push(&w->grey, v))
+    return;
+
+  if (w->ovfcnt == w->ovfcap)
+    {
+      w->ovfcap = w->ovfcap ? w->ovfcap * 2 : 1024;
+      w->ovf    = vm_crealloc(w->ovf, w->ovfcap * sizeof(val_t), false);
+    }
+
+  w->ovf[w->ovfcnt++] = v;
+  return;
+}
+
+// the type key of a fromspace object, computed from its tag and a saved first word
+static inline type_t* par_type(val_t v, val_t hd)
+{
+  tpkey_t lt = ltag(v);
+
+  if (lt >= OBJECT && lt <= FUNCTION)
+    return GLOBAL_TYPES[(uint32_t)hd];
+
+  return GLOBAL_TYPES[lt];
+}
+
+static val_t par_forward(gc_worker_t* w, val_t v)
+{
+  if (!gc_isheapref(v))
+    return v;
+
+  for (;;)
+    {
+      if (los_contains(ptr(void*,v))) // large objects are marked in place
+	{
+	  if (car_(v) == R_FPTR)
+	    {
+	      v = fwd_(v);
+	      continue;
+	    }
+
+	  if (los_mark(v))
+	    par_push(w,v);
+
+	  return v;
+	}
+
+      if (!gc_isfromspace(v))
+	return v;
+
+      _Atomic(val_t)* hdp = ptr(_Atomic(val_t)*,v);
+      val_t hd = atomic_load_explicit(hdp, memory_order_acquire);
+
+      if (hd == R_FPTR) // already copied, or moved by vm_realloc (then the target is still in the fromspace)
+	{
+	  v = fwd_(v);
+	  continue;
+	}
+
+      if (hd == GC_BUSY) // another worker is copying it
+	{
+	  sched_yield();
+	  continue;
+	}
+
+      type_t* to  = par_type(v,hd);
+      size_t  osz = val_sizeof(v,to);
+      size_t  asz = calc_mem_size(osz);
+
+      if (!atomic_compare_exchange_strong(hdp, &hd, GC_BUSY))
+	continue;
+
+      uchr_t* new = par_alloc(w,asz);
+      memcpy(new, ptr(uchr_t*,v), osz);
+      ((val_t*)new)[0] = hd;
+
+      val_t nv = (val_t)new | ltag(v);
+      cdr_(v) = nv;
+      atomic_store_explicit(hdp, R_FPTR, memory_order_release);
+
+      w->copied += asz;
+      w->objects[min(to->tp_tpkey,GC_STAT_NKEYS-1u)]++;
+      nv |= v & REF_BITS;
+      par_push(w,nv);
+      return nv;
+    }
+}
+
+static void par_scan(gc_worker_t* w, val_t v)
+{
+  size_t cnt;
+  type_t* to = par_type(v,car_(v));
+  val_t* fields = gc_fields(to,v,&cnt);
+
+  for (size_t i = 0; i < cnt; i++)
+    fields[i] = par_forward(w,fields[i]);
+
+  return;
+}
+
+static bool par_next(gc_worker_t* w, val_t* out)
+{
+  if (deque_pop(&w->grey,out))
+    return true;
+
+  if (w->ovfcnt)
+    {
+      *out = w->ovf[--w->ovfcnt];
+      return true;
+    }
+
+  // steal, starting from the next worker over
+  for (size_t i = 1; i < GC_NWORKERS; i++)
+    {
+      gc_worker_t* victim = &GC_WORKERS[(w->id + i) % GC_NWORKERS];
+
+      if (deque_steal(&victim->grey,out))
+	return true;
+    }
+
+  return false;
+}
+
+static bool par_work_left(void)
+{
+  for (size_t i = 0; i < GC_NWORKERS; i++)
+    if (!deque_isempty(&GC_WORKERS[i].grey))
+      return true;
+
+  return false;
+}
+
+static void* par_worker(void* arg)
+{
+  gc_worker_t* w = arg;
+  size_t nroots = gc_nroots();
+  val_t grey;
+
+  // roots are striped across the workers
+  for (size_t i = w->id; i < nroots; i += GC_NWORKERS)
+    {
+      val_t* r = gc_root(i);
+      *r = par_forward(w,*r);
+    }
+
+  for (;;)
+    {
+      while (par_next(w,&grey))
+	par_scan(w,grey);
+
+      atomic_fetch_add(&GC_IDLE,1);
+
+      for (;;)
+	{
+	  if (atomic_load(&GC_IDLE) == GC_NWORKERS)
+	    return NULL;
+
+	  if (par_work_left())
+	    {
+	      atomic_fetch_sub(&GC_IDLE,1);
+	      break;
+	    }
+
+	  sched_yield();
+	}
+    }
+}
+
+void gc_par_evacuate(void)
+{
+  GC_NWORKERS = min(GC_NTHREADS, GC_MAX_THREADS);
+  // minor collections promote into the old space, major ones copy into the other semispace
+  PBASE = GCMINOR ? RAM : EXTRA;
+  atomic_store(&PFREE, (uptr_t)FREE);
+  atomic_store(&PLIMIT, (uptr_t)PBASE + HEAPSIZE * 8);
+  atomic_store(&GC_IDLE, 0);
+
+  for (size_t i = 0; i < GC_NWORKERS; i++)
+    {
+      gc_worker_t* w = &GC_WORKERS[i];
+      w->id     = i;
+      w->lab    = w->lablim = NULL;
+      w->copied = 0;
+      w->ovfcnt = 0;
+      memset(w->objects,0,sizeof(w->objects));
+      atomic_store(&w->grey.top, 0);
+      atomic_store(&w->grey.bottom, 0);
+
+      if (!w->grey.buf)
+	w->grey.buf = vm_cmalloc(GC_DEQUE_SIZE * sizeof(val_t));
+    }
+
+  // the calling thread is worker 0
+  for (size_t i = 1; i < GC_NWORKERS; i++)
+    if (pthread_create(&GC_WORKERS[i].thread, NULL, par_worker, &GC_WORKERS[i]))
+      {
+	fprintf(stderr,"[%s:%d:%s] Exiting due to failure starting GC worker.\n",__FILE__,__LINE__,__func__);
+	exit(EXIT_FAILURE);
+      }
+
+  par_worker(&GC_WORKERS[0]);
+
+  for (size_t i = 1; i < GC_NWORKERS; i++)
+    pthread_join(GC_WORKERS[i].thread, NULL);
+
+  FREE = (uchr_t*)atomic_load(&PFREE);
+
+  // keep the rest of the collector in step with anything par_grow committed
+  size_t committed = (atomic_load(&PLIMIT) - (uptr_t)PBASE) / 8;
+
+  if (committed > HEAPSIZE)
+    {
+      HEAPSIZE     = committed;
+      HEAPCRITICAL = (HEAPSIZE * 3) / 4;
+    }
+
+  for (size_t i = 0; i < GC_NWORKERS; i++)
+    {
+      GC_STATS.copied += GC_WORKERS[i].copied;
+
+      for (size_t k = 0; k < GC_STAT_NKEYS; k++)
+	gc_count_copy(k,GC_WORKERS[i].objects[k]);
+    }
+
+  return;
+}
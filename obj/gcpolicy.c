@@ -0,0 +1,130 @@
+#include "../include/mem.h"
+
+/*
+   heap sizing policies.
+
+   gc_resize asks the current policy how large the semispaces should be before every major
+   collection, then clamps the answer between HEAPINIT and HEAPMAX (the heap only goes past
+   HEAPMAX when the data that may survive doesn't fit).
+
+   fixed    - the original behavior: double whenever the heap passes RAM_LOAD_FACTOR, never shrink.
+   adaptive - size the heap so that the time spent in major collections stays near
+              GC_TIME_TARGET of the total, given the measured allocation rate, survival ratio,
+              and copying cost. This can both grow and shrink the heap.
+ */
+
+val_t  HEAPINIT       = HEAP_INIT_SIZE;
+val_t  HEAPMAX        = 0;       // in words, 0 means only the reservation limits the heap
+double GC_TIME_TARGET = 0.05;
+
+#define EMA_WEIGHT 0.3           // weight of the newest sample in the moving averages
+
+/* fixed */
+static void fixed_observe(const gc_stats_t* st)
+{
+  (void)st;
+  return;
+}
+
+static size_t fixed_target(size_t live)
+{
+  size_t out = HEAPSIZE;
+
+  while (out * RAM_LOAD_FACTOR < live)
+    out *= 2;
+
+  return out;
+}
+
+/* adaptive */
+static struct
+{
+  double rate;         // bytes allocated per second of mutator time
+  double survival;     // fraction of the used heap that survives a major collection
+  double cost;         // seconds of major pause per surviving byte
+  double last_end;     // wall clock time at the end of the previous collection
+  double mutator;      // mutator seconds since the last major collection
+  size_t allocated;    // bytes allocated since the last major collection
+} ADAPTIVE = { 0, 1.0, 0, 0, 0, 0 };
+
+static inline double ema(double avg, double sample)
+{
+  return avg ? avg + EMA_WEIGHT * (sample - avg) : sample;
+}
+
+static void adaptive_observe(const gc_stats_t* st)
+{
+  if (ADAPTIVE.last_end)
+    ADAPTIVE.mutator += max(st->start - ADAPTIVE.last_end, 0.0);
+
+  ADAPTIVE.last_end   = st->start + st->pause;
+  ADAPTIVE.allocated += st->allocated;
+
+  if (st->minor)
+    return;
+
+  if (ADAPTIVE.mutator > 0)
+    ADAPTIVE.rate = ema(ADAPTIVE.rate, ADAPTIVE.allocated / ADAPTIVE.mutator);
+
+  if (st->used_before)
+    ADAPTIVE.survival = ema(ADAPTIVE.survival, (double)st->used_after / st->used_before);
+
+  if (st->copied)
+    ADAPTIVE.cost = ema(ADAPTIVE.cost, st->pause / st->copied);
+
+  ADAPTIVE.mutator   = 0;
+  ADAPTIVE.allocated = 0;
+  return;
+}
+
+static size_t adaptive_target(size_t live)
+{
+  if (!ADAPTIVE.rate || !ADAPTIVE.cost) // nothing measured yet
+    return fixed_target(live);
+
+  /*
+     with S surviving bytes a major collection pauses for about S * cost. If F bytes are free
+     afterwards the next one comes after F / rate seconds, so the fraction of time spent
+     collecting is pause / (pause + F / rate). Solve for the F that hits the target.
+   */
+  double survivors = live * 8.0 * ADAPTIVE.survival;
+  double pause     = survivors * ADAPTIVE.cost;
+  double headroom  = ADAPTIVE.rate * pause * (1 - GC_TIME_TARGET) / GC_TIME_TARGET;
+  size_t out       = ((survivors + headroom) / 8) * 4 / 3; // majors start at 3/4 of the heap
+
+  // don't bother shrinking by small amounts
+  if (out < HEAPSIZE && out > HEAPSIZE / 2)
+    out = HEAPSIZE;
+
+  return out;
+}
+
+gc_policy_t GC_FIXED_POLICY =
+  {
+    .name    = "fixed",
+    .observe = fixed_observe,
+    .target  = fixed_target,
+  };
+
+gc_policy_t GC_ADAPTIVE_POLICY =
+  {
+    .name    = "adaptive",
+    .observe = adaptive_observe,
+    .target  = adaptive_target,
+  };
+
+gc_policy_t* GC_POLICY = &GC_ADAPTIVE_POLICY;
+
+bool gc_set_policy(const chr_t* name)
+{
+  static gc_policy_t* policies[] = { &GC_FIXED_POLICY, &GC_ADAPTIVE_POLICY };
+
+  for (size_t i = 0; i < sizeof(policies) / sizeof(gc_policy_t*); i++)
+    if (!strcmp(policies[i]->name,name))
+      {
+	GC_POLICY = policies[i];
+	return true;
+      }
+
+  return false;
+}
@@ -1,25 +1,8 @@
 #include "../include/hamt.h"
 
 
-MK_TYPE_PREDICATE(BVECTOR,OBJECT,bvec)
-MK_TYPE_PREDICATE(TBSLEAF,OBJECT,sleaf)
-MK_TYPE_PREDICATE(TBDLEAF,OBJECT,dleaf)
+MK_TYPE_PREDICATE(OBJECT,BVECTOR,bvec)
 MK_SAFECAST_P(bvec_t*,bvec,addr)
-MK_SAFECAST_P(sleaf_t*,sleaf,addr)
-MK_SAFECAST_P(dleaf_t*,dleaf,addr)
-MK_SAFECAST_P(leaf_t*,leaf,addr)
-
-
-inline bool isleaf(val_t x)
-{
-  switch (tpkey(x))
-    {
-    case TBSLEAF: case TBDLEAF:
-      return true;
-    default:
-      return false;
-    }
-}
 
 
 inline uint32_t get_mask(hamt_lvl_t lvl)
@@ -31,392 +14,598 @@ inline uint32_t get_mask(hamt_lvl_t lvl)
       L7_MASK,
     };
 
-  return masks[lvl];
+  return masks[lvl - 1];
 }
 
+// the slot a hash falls in at level l (counting from 0)
+static inline uint8_t hamt_slot(hash_t h, uint8_t l)
+{
+  return (h & get_mask(l+1)) >> (l*5);
+}
+
+// the root has room for an entry in every slot
 bvec_t*  mk_hamt_nd(uint8_t lvl, size_t sz, uint16_t flags)
 {
   assert(sz <= 32, BOUNDS_ERR);
+  uint32_t w = hamt_width(flags);
   bvec_t* out;
 
   switch (lvl)
     {
     case 1:
-      out = mk_bvec(32,flags & GLOBAL);
+      out = mk_bvec(32*w,w,flags & GLOBAL);
       break;
 
     case 2 ... 6:
-      out = mk_bvec(sz,flags & GLOBAL);
+      out = mk_bvec(sz*w,w,flags & GLOBAL);
       break;
 
     case 7: default:
-      out = mk_bvec(4, flags & GLOBAL);
+      out = mk_bvec(4*w,w,flags & GLOBAL);
       break;
     }
 
   return out;
 }
 
-leaf_t* mk_leaf(hash_t h, val_t key, uint16_t flags)
+/*
+   transients. A transient is an edit token: the nodes it creates are stamped with the token
+   and given room to grow, and later inserts and removes under the same token change those
+   nodes in place instead of copying them. Nodes it doesn't own are copied as usual (and the
+   copy becomes its own). Tokens are never reused, so freezing a transient takes nothing more
+   than dropping its token - whatever it built is persistent from then on. The counter is 64
+   bits wide so that it can't wrap around to a token whose nodes are still reachable (or to 0,
+   the persistent token).
+ */
+static uint64_t HAMT_EDIT = 0;
+
+uint64_t hamt_transient(void)
 {
-  leaf_t* out;
+  return ++HAMT_EDIT;
+}
 
-  if (flags & BINDINGS)
-    {
-      dleaf_t* nw_dlf  = flags & GLOBAL ? vm_cmalloc(32) : vm_allocw(8,3);
-      nw_dlf->type   = TBDLEAF;
-      nw_dlf->value  = R_UNBOUND;
-      nw_dlf->next   = NULL;
-      out = (leaf_t*)nw_dlf;
-    }
+static inline bool nd_owned(bvec_t* nb, uint64_t edit)
+{
+  return edit && nb->bv_edit == edit;
+}
 
-  else
-    {
-      sleaf_t* nw_slf  = flags & GLOBAL ? vm_cmalloc(32): vm_allocw(8,3);
-      list_t* slf_keys = (list_t*)((void*)nw_slf + 16);
-      slf_keys->car    = key;
-      slf_keys->cdr    = NULL;
-      nw_slf->type     = TBSLEAF;
-      nw_slf->keys     = slf_keys;
-      out              = (leaf_t*)nw_slf;
-    }
-  out->hash = h;
+// a node with room for n elements (rounded up to a power of two for transients)
+static bvec_t* mk_node(size_t n, uint32_t w, uint16_t flags, uint64_t edit)
+{
+  size_t cap = n;
+
+  if (edit)
+    for (cap = 4; cap < n; cap <<= 1)
+      continue;
+
+  bvec_t* out = mk_bvec(min(cap,(size_t)BVEC_MAX),w,flags & GLOBAL);
+  out->bv_edit = edit;
   return out;
 }
 
+/*
+   node edits. An edit copies the elements of the node into a scratch buffer, opens or closes
+   gaps there, and commits the result back - into the same node if it may be changed in place
+   and has room, otherwise into a new node stored in *slot. The collector is held off by the
+   public functions, so the scratch copies stay valid.
+ */
+static inline size_t nd_load(bvec_t* nb, val_t* tmp)
+{
+  size_t n = bvec_used(nb);
+  memcpy(tmp,nb->bv_elements,n*8);
+  return n;
+}
 
-bvec_t*  cp_bvec(bvec_t* frm, int32_t grow)
+static inline void nd_open(val_t* tmp, size_t n, size_t at, size_t cnt)
 {
-  int32_t frmsz = popcnt(frm->bv_bmap);
-  bvec_t* out = vm_allocw(8, frmsz + grow);
-  memcpy((void*)out,(void*)frm,16+frmsz);
-  return out;
+  memmove(tmp+at+cnt,tmp+at,(n-at)*8);
 }
 
-static obj_t* leaf_search(leaf_t* lf, val_t k)
+static inline void nd_close(val_t* tmp, size_t n, size_t at, size_t cnt)
 {
-  if (lf->type == TBSLEAF)
-    {
-      list_t* skeys = ((sleaf_t*)lf)->keys;
-      
-      while (skeys)
-	{
-	  if (val_eql(skeys->car,k))
-	    return (obj_t*)skeys;
+  memmove(tmp+at,tmp+at+cnt,(n-at-cnt)*8);
+}
 
-	  skeys = skeys->cdr;
-	}
-    }
+static bvec_t* nd_commit(val_t* slot, val_t* tmp, size_t n, uint32_t bmap, uint32_t nmap, uint16_t flags, uint64_t edit, bool inplace)
+{
+  bvec_t* nb = ptr(bvec_t*,*slot);
+  size_t old = bvec_used(nb);
+
+  if (inplace && n <= nb->bv_cap)
+    for (size_t i = n; i < old; i++)
+      nb->bv_elements[i] = 0;
 
   else
     {
-      dleaf_t* dlf = (dleaf_t*)lf;
-      while (dlf)
-	{
-	  if (val_eql(k,(dlf)->key))
-	    return (obj_t*)dlf;
+      bvec_t* new = mk_node(n,nb->bv_width,flags,edit);
 
-	  dlf = (dlf)->next;
-	}
+      if (flags & GLOBAL)
+	vm_cfree(nb);
+
+      wbarrier(*slot,(val_t)new | OBJECT);
+      nb = new;
     }
 
-  return NULL;
+  // every element goes through the write barrier, since the remembered set records slots
+  for (size_t i = 0; i < n; i++)
+    if (nb->bv_elements[i] != tmp[i])
+      wbarrier(nb->bv_elements[i],tmp[i]);
+
+  nb->bv_bmap = bmap;
+  nb->bv_nmap = nmap;
+  return nb;
 }
 
+// a new entry for k (unbound in tables with bindings)
+static inline void nd_setentry(val_t* e, val_t k, uint32_t w)
+{
+  e[0] = k;
 
+  if (w == 2)
+    e[1] = R_UNBOUND;
+}
 
-static obj_t* sleaf_insert(sleaf_t* lf, val_t k, uint16_t flags, rcmp_t cmpf)
+/* lookup */
+static val_t* cl_search(bvec_t* nb, val_t k, rcmp_t cmpf)
 {
-  list_t** skeys = &(lf->keys);
+  uint32_t w = nb->bv_width, n = popcnt(nb->bv_bmap);
 
-  if (!cmpf)
-    cmpf = val_eql;
+  for (uint32_t i = 0; i < n; i++)
+    if (cmpf(k,nb->bv_elements[i*w]))
+      return nb->bv_elements + i*w;
+
+  return NULL;
+}
+
+// the entry for k (its key, followed by its value in tables with bindings)
+val_t* hamt_search(val_t n, val_t k)
+{
+  bvec_t* nb = tobvec(n);
+  hash_t h = val_hash(k);
 
-  while (*skeys)
+  for (uint8_t l = 0; l < HAMT_DEPTH; l++)
     {
-      if (cmpf(k,(*skeys)->car))
-	  return (obj_t*)(*skeys);
+      uint8_t lcl_idx = hamt_slot(h,l);
+      val_t* rslt = bvec_ref(nb,lcl_idx);
 
-      skeys = &(*skeys)->cdr;
-    }
+      if (rslt)
+	return val_eql(k,*rslt) ? rslt : NULL;
 
-  list_t* new = flags & GLOBAL ? vm_cmalloc(16) : vm_allocw(0,2);
-  new->car = k;
-  new->cdr = NULL;
-  *skeys = new;
+      rslt = bvec_child(nb,lcl_idx);
 
-  return (obj_t*)new;
-}
+      if (!rslt)
+	return NULL;
+
+      nb = ptr(bvec_t*,*rslt);
+    }
 
+  return cl_search(nb,k,val_eql);
+}
 
-static obj_t* dleaf_insert(dleaf_t* lf, hash_t h, val_t k, uint16_t flags, rcmp_t cmpf)
+/* insertion */
+// a subnode for the entry e (whose key hashes to he) and a new entry for k; *out is set to the new entry
+static val_t nd_split(val_t* e, hash_t he, val_t k, hash_t h, uint8_t l, uint32_t w, uint16_t flags, uint64_t edit, val_t** out)
 {
-  dleaf_t** curr = &lf;
+  bvec_t* nd;
 
-  if (!cmpf)
-    cmpf = val_eql;
+  if (l == HAMT_DEPTH) // the hashes are equal, so both go in a collision node
+    {
+      nd = mk_node(2*w,w,flags,edit);
+      nd->bv_bmap = 0x3u;
+      memcpy(nd->bv_elements,e,w*8);
+      *out = nd->bv_elements + w;
+    }
 
-  while (*curr)
+  else if (hamt_slot(he,l) == hamt_slot(h,l))
     {
-      if (cmpf(k,(*curr)->key))
-	{
-	  return (obj_t*)(*curr);
-	}
+      nd = mk_node(1,w,flags,edit);
+      nd->bv_nmap = 1u << hamt_slot(h,l);
+      wbarrier(nd->bv_elements[0],nd_split(e,he,k,h,l+1,w,flags,edit,out));
+    }
 
-      curr = &((*curr)->next);
+  else
+    {
+      uint32_t ei = hamt_slot(he,l) < hamt_slot(h,l) ? 0 : w;
+      nd = mk_node(2*w,w,flags,edit);
+      nd->bv_bmap = (1u << hamt_slot(he,l)) | (1u << hamt_slot(h,l));
+      memcpy(nd->bv_elements+ei,e,w*8);
+      *out = nd->bv_elements + (w - ei);
     }
 
-  leaf_t* new = mk_leaf(h,k,flags);
-  *curr = (dleaf_t*)new;
-  return (obj_t*)new;
+  nd_setentry(*out,k,w);
+  return (val_t)nd | OBJECT;
 }
 
-static inline val_t leaf_insert(leaf_t* lf, hash_t h, val_t k, uint16_t fl, rcmp_t cmpf)
+static val_t* cl_insert(val_t* slot, val_t k, uint16_t flags, uint64_t edit, rcmp_t cmpf, bool inplace)
 {
-  
-  if (lf->type == TBSLEAF)
-    return ((val_t)sleaf_insert((sleaf_t*)lf,k,fl,cmpf)) | LIST;
+  bvec_t* nb = ptr(bvec_t*,*slot);
+  val_t* out = cl_search(nb,k,cmpf);
 
-  else
-    return ((val_t)dleaf_insert((dleaf_t*)lf,h,k,fl,cmpf)) | OBJECT;
-}
+  if (out)
+    return out;
 
+  val_t tmp[BVEC_MAX];
+  uint32_t w = nb->bv_width, n = popcnt(nb->bv_bmap);
+  assert(n < 32,BOUNDS_ERR,"too many keys with the same hash");
 
-static obj_t* sleaf_delete(sleaf_t* lf, val_t k, uint16_t fl)
+  size_t used = nd_load(nb,tmp);
+  nd_setentry(tmp+used,k,w);
+  nb = nd_commit(slot,tmp,used+w,(nb->bv_bmap << 1) | 1,0,flags,edit,inplace);
+  return nb->bv_elements + used;
+}
+
+/*
+   n and the slots below it are interior pointers, so nothing may move until the insert is done.
+   edit is the transient doing the insert, or 0 (the root is always changed in place when it has
+   room). The result is the entry for k, which is only good until the next allocation.
+ */
+val_t* hamt_insert(val_t* n, val_t k, uint16_t flags, uint64_t edit, rcmp_t cmpf)
 {
-  list_t** curr = &(lf->keys);
+  gc_defer();
+  hash_t h = val_hash(k);
+  val_t* slot = n, *out, tmp[BVEC_MAX];
+  uint8_t l;
 
-  while (*curr)
+  if (!cmpf)
+    cmpf = val_eql;
+
+  for (l = 0; l < HAMT_DEPTH; l++)
     {
-      if (val_eql(k,(*curr)->car))
+      bvec_t* nb = tobvec(*slot);
+      uint8_t lcl_idx = hamt_slot(h,l);
+      uint32_t bit = 1u << lcl_idx, w = nb->bv_width;
+      bool inplace = !l || nd_owned(nb,edit);
+      val_t* rslt = bvec_child(nb,lcl_idx);
+
+      if (rslt)
 	{
-	  list_t* old = *curr;
-	  *curr = old->cdr;
-	  if (fl & GLOBAL)
-	    vm_cfree(old);
+	  slot = rslt;
+	  continue;
+	}
 
-	  break;
+      rslt = bvec_ref(nb,lcl_idx);
+
+      if (!rslt) // a free slot takes the entry
+	{
+	  size_t used = nd_load(nb,tmp), at = idxtobm(nb->bv_bmap,lcl_idx) * w;
+	  nd_open(tmp,used,at,w);
+	  nd_setentry(tmp+at,k,w);
+	  nb  = nd_commit(slot,tmp,used+w,nb->bv_bmap | bit,nb->bv_nmap,flags,edit,inplace);
+	  out = nb->bv_elements + at;
+	  goto end;
 	}
 
-      curr = &(*curr)->cdr;
+      if (cmpf(k,*rslt))
+	{
+	  out = rslt;
+	  goto end;
+	}
+
+      // the slot is taken by another key, so both move down into a new subnode
+      val_t sub = nd_split(rslt,val_hash(*rslt),k,h,l+1,w,flags,edit,&out);
+      size_t used = nd_load(nb,tmp), at = rslt - nb->bv_elements;
+      nd_close(tmp,used,at,w);
+      used -= w;
+
+      size_t nat = (popcnt(nb->bv_bmap) - 1) * w + idxtobm(nb->bv_nmap,lcl_idx);
+      nd_open(tmp,used,nat,1);
+      tmp[nat] = sub;
+      nd_commit(slot,tmp,used+1,nb->bv_bmap & ~bit,nb->bv_nmap | bit,flags,edit,inplace);
+      goto end;
     }
 
-  if (lf->keys)
-    return (obj_t*)lf;
+  out = cl_insert(slot,k,flags,edit,cmpf,nd_owned(ptr(bvec_t*,*slot),edit));
 
-  else
-    vm_cfree(lf);
+    end:
+      gc_allow();
+      return out;
+}
 
-  return NULL;
+
+val_t* hamt_put(val_t* bv, val_t k, val_t b, uint16_t flags, uint64_t edit, rcmp_t cmpf)
+{
+  assert(flags & BINDINGS,TYPE_ERR);
+  val_t* loc = hamt_insert(bv,k,flags,edit,cmpf);
+
+  wbarrier(loc[1],b);
+  return loc;
 }
 
-static obj_t* dleaf_delete(dleaf_t* lf, val_t k, uint16_t fl)
+/* removal */
+static int32_t nd_remove(val_t* slot, val_t k, hash_t h, uint8_t l, uint16_t flags, uint64_t edit)
 {
-  dleaf_t** curr = &lf;
+  bvec_t* nb = ptr(bvec_t*,*slot);
+  uint32_t w = nb->bv_width;
+  bool inplace = !l || nd_owned(nb,edit);
+  val_t tmp[BVEC_MAX], *rslt;
+  size_t used;
 
-  while (*curr)
+  if (l == HAMT_DEPTH)
     {
-      if (val_eql((*curr)->key,k))
-	{
-	  dleaf_t* old = *curr;
-	  *curr = old->next;
+      rslt = cl_search(nb,k,val_eql);
 
-	  if (fl & GLOBAL)
-	      vm_cfree(old);
-	}
+      if (!rslt)
+	return 0;
 
-      else
-	curr = &(*curr)->next;
+      used = nd_load(nb,tmp);
+      nd_close(tmp,used,rslt - nb->bv_elements,w);
+      nd_commit(slot,tmp,used-w,nb->bv_bmap >> 1,0,flags,edit,inplace);
+      return 1;
     }
 
-  if (lf->next)
-    return (obj_t*)lf;
+  uint8_t lcl_idx = hamt_slot(h,l);
+  uint32_t bit = 1u << lcl_idx;
+  rslt = bvec_ref(nb,lcl_idx);
 
-  else
-    vm_cfree(lf);
+  if (rslt)
+    {
+      if (!val_eql(k,*rslt))
+	return 0;
 
-  return NULL;
+      used = nd_load(nb,tmp);
+      nd_close(tmp,used,rslt - nb->bv_elements,w);
+      nd_commit(slot,tmp,used-w,nb->bv_bmap & ~bit,nb->bv_nmap,flags,edit,inplace);
+      return 1;
+    }
+
+  rslt = bvec_child(nb,lcl_idx);
+
+  if (!rslt || !nd_remove(rslt,k,h,l+1,flags,edit))
+    return 0;
+
+  // a subnode left with a single entry is folded back into this node
+  bvec_t* sub = ptr(bvec_t*,*rslt);
+
+  if (sub->bv_nmap || popcnt(sub->bv_bmap) != 1)
+    return 1;
+
+  used = nd_load(nb,tmp);
+  nd_close(tmp,used,rslt - nb->bv_elements,1);
+  used -= 1;
+
+  size_t at = idxtobm(nb->bv_bmap,lcl_idx) * w;
+  nd_open(tmp,used,at,w);
+  memcpy(tmp+at,sub->bv_elements,w*8);
+  nd_commit(slot,tmp,used+w,nb->bv_bmap | bit,nb->bv_nmap & ~bit,flags,edit,inplace);
+
+  if (flags & GLOBAL)
+    vm_cfree(sub);
+
+  return 1;
 }
 
-static inline obj_t* leaf_delete(leaf_t* lf, val_t k, uint16_t fl)
+
+int32_t hamt_remove(val_t* bv, val_t key, uint16_t flags, uint64_t edit)
 {
-  if (lf->type == TBDLEAF)
-    return dleaf_delete((dleaf_t*)lf,k,fl);
+  gc_defer();
+  int32_t out = nd_remove(bv,key,val_hash(key),0,flags,edit);
+  gc_allow();
+  return out;
+}
 
-  else
-    return sleaf_delete((sleaf_t*)lf,k,fl);
+/*
+   bulk loading. The keys are hashed once and radix sorted on their level slices (level 0 most
+   significant), which makes every subtree a contiguous run of the sorted entries, so each node
+   is built once at its final size. Equal hashes end up next to each other in their original
+   order, and a later binding of the same key replaces an earlier one.
+ */
+typedef struct
+{
+  hash_t   h;
+  uint32_t i;                 // the entry's index in the input
+} hb_entry_t;
+
+static void hb_sort(hb_entry_t* ents, size_t n)
+{
+  hb_entry_t* tmp = vm_cmalloc(n * sizeof(hb_entry_t)), *src = ents, *dst = tmp, *swp;
+
+  for (int32_t l = HAMT_DEPTH - 1; l >= 0; l--)
+    {
+      size_t cnt[33] = { 0 };
+
+      for (size_t i = 0; i < n; i++)
+	cnt[hamt_slot(src[i].h,l) + 1]++;
+
+      for (size_t d = 0; d < 32; d++)
+	cnt[d+1] += cnt[d];
+
+      for (size_t i = 0; i < n; i++)
+	dst[cnt[hamt_slot(src[i].h,l)]++] = src[i];
+
+      swp = src; src = dst; dst = swp;
+    }
+
+  if (src != ents)
+    memcpy(ents,src,n * sizeof(hb_entry_t));
+
+  vm_cfree(tmp);
+  return;
 }
 
-obj_t* hamt_search(val_t n, val_t k)
+// drop repeated keys from a run with one hash (the last binding of each wins)
+static size_t hb_unique(hb_entry_t* e, size_t n, const val_t* keys)
 {
-  bvec_t* nb = tobvec(n);
-  hash_t h = val_hash(k);
+  size_t m = 0;
 
-  for (uint8_t l = 0; l < 7 && n; l++)
+  for (size_t j = 0; j < n; j++)
     {
-      uint8_t lcl_idx = (h & get_mask(l+1)) >> (l*5);
-      val_t* rslt = bvec_ref(nb,lcl_idx);
+      size_t u = 0;
 
-      if (!rslt)
-	return (obj_t*)n;
+      while (u < m && !val_eql(keys[e[u].i],keys[e[j].i]))
+	u++;
 
-      else if (isleaf(*rslt))
-	return (obj_t*)leaf_search(ptr(leaf_t*,(*rslt)), k);
+      if (u == m)
+	e[m++] = e[j];
 
       else
-	nb = ptr(bvec_t*,*rslt);
+	e[u].i = e[j].i;
     }
 
-  return NULL;
+  return m;
 }
 
+static inline void hb_setentry(val_t* el, hb_entry_t* e, const val_t* keys, const val_t* vals)
+{
+  wbarrier(el[0],keys[e->i]);
+
+  if (vals)
+    wbarrier(el[1],vals[e->i]);
+}
 
-val_t hamt_insert(val_t* n, val_t k, uint16_t flags, rcmp_t cmpf)
+static val_t hb_node(hb_entry_t* e, size_t n, uint8_t l, const val_t* keys, const val_t* vals, uint16_t flags, size_t* nk)
 {
-  hash_t h = val_hash(k);
-  leaf_t* new_lf;
-  val_t  out;
-  bvec_t* nb = tobvec(*n);
-  val_t* bv_idx = n;
+  uint32_t w = hamt_width(flags), bmap = 0, nmap = 0;
+  bvec_t* nd;
 
-  for (uint8_t l = 0; l < 7; l++, nb=ptr(bvec_t*,(*bv_idx)))
+  if (l == HAMT_DEPTH)
     {
-      uint8_t lcl_idx = (h & get_mask(l+1)) >> (l*5);
-      val_t* rslt = bvec_ref(nb,lcl_idx);
+      n   = hb_unique(e,n,keys);
+      nd  = mk_bvec(n*w,w,flags & GLOBAL);
+      *nk += n;
+      assert(n <= 32,BOUNDS_ERR,"too many keys with the same hash");
+      nd->bv_bmap = (uint32_t)((1ul << n) - 1);
 
-      if (!rslt)
-	{
-	  bvec_t* new = cp_bvec(nb,1);
-	  new_lf = mk_leaf(h,k,flags);
-	  *(bvec_ref(new,lcl_idx)) = ((val_t)new_lf) | OBJECT;
-
-	  if (flags & GLOBAL)
-	    {
-	      bvec_t* old = ptr(bvec_t*,*bv_idx);
-	      vm_cfree(old);
-	    }
-
-	  *bv_idx = ((val_t)new) | OBJECT;
-	  out = ((val_t)new_lf) | OBJECT;
-	  goto end;
-	}
+      for (size_t j = 0; j < n; j++)
+	hb_setentry(nd->bv_elements + j*w,e+j,keys,vals);
 
-      else if (isleaf(*rslt))
+      return (val_t)nd | OBJECT;
+    }
+
+  // first pass: a run with a single key is an entry, anything else is a subnode
+  for (size_t j = 0, r; j < n; j = r)
+    {
+      uint8_t d = hamt_slot(e[j].h,l);
+
+      for (r = j + 1; r < n && hamt_slot(e[r].h,l) == d; r++)
+	continue;
+
+      if (e[j].h == e[r-1].h && hb_unique(e+j,r-j,keys) == 1)
+	bmap |= 1u << d;
+
+      else
+	nmap |= 1u << d;
+    }
+
+  nd = l ? mk_bvec(popcnt(bmap)*w + popcnt(nmap),w,flags & GLOBAL) : mk_hamt_nd(HLVL_ONE,32,flags);
+  nd->bv_bmap = bmap;
+  nd->bv_nmap = nmap;
+
+  for (size_t j = 0, r; j < n; j = r)
+    {
+      uint8_t d = hamt_slot(e[j].h,l);
+
+      for (r = j + 1; r < n && hamt_slot(e[r].h,l) == d; r++)
+	continue;
+
+      if (bmap & (1u << d))
 	{
-	  leaf_t* lf = ptr(leaf_t*,*rslt);
-	  if (lf->hash == h)
-	    {
-	      out = leaf_insert(lf,h,k,flags,cmpf);
-	      goto end;
-	    }
-
-	  else // create a split
-	    {
-	      new_lf = mk_leaf(h,k,flags);
-	      hash_t lh = lf->hash;
-	      bvec_t* new;
-	      val_t* root = rslt;
-	      for (uint8_t sl = l + 1;sl < 7; sl++)
-		{
-		  lcl_idx = (h & get_mask(sl + 1)) >> (sl*5);
-		  uint8_t h_lcl_idx = (lh & get_mask(sl+1)) >> (sl*5);
-
-		  if (lcl_idx == h_lcl_idx)
-		    {
-		      new = mk_bvec(sl,1,flags);
-		      *root = ((val_t)new) | OBJECT;
-		      new->bv_bmap = lcl_idx;
-		      root = new->bv_elements;
-		    }
-
-		  else
-		    {
-		      new = mk_bvec(sl,2,flags);
-		      *root = ((val_t)new) | OBJECT;
-		      if (lcl_idx > h_lcl_idx)
-			{
-			  new->bv_elements[0] = (val_t)lf     | OBJECT;
-			  new->bv_elements[1] = (val_t)new_lf | OBJECT;
-			}
-
-		      else
-			{
-			  new->bv_elements[0] = (val_t)new_lf | OBJECT;
-			  new->bv_elements[1] = (val_t)lf     | OBJECT;
-			}
-
-		      new->bv_bmap = (1 << lcl_idx) | (1 << h_lcl_idx);
-		      out = (val_t)new_lf | OBJECT;
-		      goto end;
-		    }
-		}
-	    }
+	  hb_setentry(bvec_ref(nd,d),e+j,keys,vals);
+	  (*nk)++;
 	}
 
       else
-	bv_idx = rslt;
+	wbarrier(*bvec_child(nd,d),hb_node(e+j,r-j,l+1,keys,vals,flags,nk));
     }
 
-    end:
-      return out;
+  return (val_t)nd | OBJECT;
 }
 
-
-val_t hamt_put(val_t* bv, val_t k, val_t b, uint16_t flags, rcmp_t cmpf)
+// a root holding keys (bound to vals unless that's NULL); *nk is set to the number of distinct keys
+val_t hamt_build(const val_t* keys, const val_t* vals, size_t n, uint16_t flags, size_t* nk)
 {
-  val_t loc = hamt_insert(bv,k,flags,cmpf);
-  assert(isdleaf(loc),TYPE_ERR);
+  if (vals)
+    flags |= BINDINGS;
 
-  ptr(dleaf_t*,loc)->value = b;
-  return loc;
+  hb_entry_t* ents = vm_cmalloc(n * sizeof(hb_entry_t));
+
+  for (size_t i = 0; i < n; i++)
+    ents[i] = (hb_entry_t){ val_hash(keys[i]), i };
+
+  hb_sort(ents,n);
+
+  // keys, vals and the nodes not yet linked into the tree are only held in C memory
+  gc_defer();
+  *nk = 0;
+  val_t out = hb_node(ents,n,0,keys,vals,flags,nk);
+  gc_allow();
+
+  vm_cfree(ents);
+  return out;
 }
 
+/* cursors */
+void hamt_cursor_init(hamt_cursor_t* c, val_t n)
+{
+  for (int32_t i = 0; i <= HAMT_DEPTH; i++)
+    c->stack[i] = (hamt_frame_t){ R_NIL, 0 };
 
-int32_t hamt_remove(val_t* bv, val_t key, uint16_t flags)
+  bvec_t* nb  = tobvec(n);
+  c->top      = 0;
+  c->stack[0] = (hamt_frame_t){ n, nb->bv_bmap | nb->bv_nmap };
+  return;
+}
+
+// register the frames with the current gc scope, for cursors that live across allocations
+void hamt_cursor_preserve(hamt_cursor_t* c)
 {
-  bvec_t* nb = tobvec(*bv);
-  hash_t h = val_hash(key);
+  for (int32_t i = 0; i <= HAMT_DEPTH; i++)
+    gc_preserve(c->stack[i].node);
 
-  for (uint8_t l = 0; l < 7 && nb; l++)
-    {
-      uint8_t lcl_idx = (h & get_mask(l+1)) >> (l*5);
-      val_t* rslt = bvec_ref(nb,lcl_idx);
+  return;
+}
 
-      if (!rslt)
-	return 0;
+// the next entry, or NULL once the table is exhausted
+val_t* hamt_cursor_next(hamt_cursor_t* c)
+{
+  while (c->top >= 0)
+    {
+      hamt_frame_t* fr = c->stack + c->top;
 
-      else if (isleaf(*rslt))
+      if (!fr->rest)
 	{
-	  obj_t* rm = leaf_delete(ptr(leaf_t*,*rslt),key,flags);
-
-	  if (rm == NULL && l) // don't resize the root table
-	    {
-	      val_t* prev = rslt, *next;
-	      uint32_t curridx = prev - nb->bv_elements;
-
-	      while (curridx < popcnt(nb->bv_bmap))
-		{
-		  next = prev + 1;
-		  *prev = *next;
-		  prev = next;
-		}
-
-	      nb->bv_bmap &= ~(1 << lcl_idx);
-	      bvec_t* old = nb;
-	      nb = cp_bvec(nb,-1);
-	      *bv = (val_t)nb | OBJECT;
-
-	      if (flags & GLOBAL)
-		vm_cfree(old);
-	    }
-
-	  return 1;
+	  fr->node = R_NIL;
+	  c->top--;
+	  continue;
 	}
 
-      else
-	bv = rslt;
-	nb = ptr(bvec_t*, *bv);
+      uint8_t idx = bmtoidx(fr->rest);
+      fr->rest   &= fr->rest - 1;
+      bvec_t* nb  = ptr(bvec_t*,fr->node);
+      val_t* e    = bvec_ref(nb,idx);
+
+      if (e)
+	return e;
+
+      bvec_t* sub        = ptr(bvec_t*,*bvec_child(nb,idx));
+      c->stack[++c->top] = (hamt_frame_t){ *bvec_child(nb,idx), sub->bv_bmap | sub->bv_nmap };
     }
 
-  return 0;
+  return NULL;
+}
+
+/* printing */
+// the entries of a table, separated by spaces (bindings print as the key, then the value)
+static bool nd_prn(bvec_t* nb, riostrm_t* f, bool first)
+{
+  uint32_t w = nb->bv_width, ne = popcnt(nb->bv_bmap), nn = popcnt(nb->bv_nmap);
+
+  for (uint32_t i = 0; i < ne; i++, first = false)
+    for (uint32_t j = 0; j < w; j++)
+      {
+	if (!first || j)
+	  fputc(' ',f);
+
+	val_prn(nb->bv_elements[i*w+j],f);
+      }
+
+  for (uint32_t i = 0; i < nn; i++)
+    first = nd_prn(ptr(bvec_t*,nb->bv_elements[ne*w+i]),f,first);
+
+  return first;
+}
+
+void hamt_prn(val_t n, riostrm_t* f)
+{
+  nd_prn(tobvec(n),f,true);
+  return;
 }
@@ -0,0 +1,600 @@
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../include/mem.h"
+#include "../include/symtab.h"
+
+/*
+   heap images.
+
+   image_save compacts the heap with a major collection, then writes the used part of RAM, every
+   large object, and the global constants past the standard streams. It also writes a relocation
+   bitmap with one bit per word of saved data, set for the words that point into saved data, so
+   that loading never has to look at types.
+
+   Symbols live in C memory, so they're written by name instead: every interned symbol (the whole
+   trie) and every uninterned symbol the heap refers to, with a second bitmap marking the words
+   that hold one. Loading interns the names again (or recreates the uninterned symbols) and points
+   the marked words at the symbols of the new process.
+
+   Values can also point at the executable's own code and static data (builtins, type objects).
+   A position independent executable is loaded somewhere else by every run, so these are marked
+   in a third bitmap and moved by the distance between the two load addresses. Pointers to other
+   C memory (ports) can't be carried over.
+
+   image_load maps the RAM part of the file privately (copy on write) at the address it was
+   written from when that address is free, and anywhere else otherwise. It reads the large
+   objects into fresh mappings and then adds the distance each segment moved to every word the
+   bitmap marks. The C side of the runtime (types, registers, standard streams) still has to be
+   set up by the caller, and images are only accepted by an executable of the same size as the
+   one that wrote them.
+
+   Images are only written and read by the semispace collector.
+ */
+
+#define IMAGE_MAGIC   0x52535049u  // "IPSR"
+#define IMAGE_VERSION 3u
+
+// the executable's code and static data, as laid out by the linker
+extern chr_t __executable_start[], _end[];
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t pagesize;
+  uint64_t text;          // where the executable was loaded in the process that wrote the image
+  uint64_t textsize;      // and its size (code and static data)
+  uint64_t base;          // RAM in that process
+  uint64_t nbytes;        // bytes of RAM in use, stored at file offset pagesize
+  uint64_t heapsize;      // HEAPSIZE in words
+  uint64_t nlos;          // large objects
+  uint64_t los_off;       // file offset of the large object table, followed by their data
+  uint64_t reloc_off;     // file offset of the relocation bitmap, then the symbol and text bitmaps
+  uint64_t nwords;        // words of saved data (RAM first, then each large object)
+  uint64_t nsyms;         // symbols
+  uint64_t sym_off;       // file offset of the symbols
+  val_t    constants[16];
+} image_hdr_t;
+
+typedef struct
+{
+  uint64_t base;          // address in the writing process
+  uint64_t size;          // bytes
+} image_los_t;
+
+// followed by the name (size bytes, including the terminator)
+typedef struct
+{
+  uint64_t base;          // address in the writing process
+  uint32_t flags;
+  uint32_t size;
+} image_sym_t;
+
+// a run of saved data and where it lives now
+typedef struct
+{
+  uptr_t old, new;
+  size_t size;
+  size_t word;            // index of its first word in the relocation bitmap
+} image_seg_t;
+
+static image_seg_t*  SEGS   = NULL;
+static size_t        NSEGS  = 0, SEGCAP = 0;
+static image_seg_t** BYADDR = NULL;   // SEGS sorted by old address
+
+static void seg_add(uptr_t old, uptr_t new, size_t size)
+{
+  if (NSEGS == SEGCAP)
+    {
+      SEGCAP = SEGCAP ? SEGCAP * 2 : 16;
+      SEGS   = vm_crealloc(SEGS, SEGCAP * sizeof(image_seg_t), false);
+    }
+
+  size_t word = NSEGS ? SEGS[NSEGS-1].word + SEGS[NSEGS-1].size / 8 : 0;
+  SEGS[NSEGS++] = (image_seg_t){ .old = old, .new = new, .size = size, .word = word };
+  return;
+}
+
+static int seg_cmp(const void* x, const void* y)
+{
+  uptr_t a = (*(image_seg_t**)x)->old, b = (*(image_seg_t**)y)->old;
+  return a < b ? -1 : a > b;
+}
+
+static void seg_index(void)
+{
+  BYADDR = vm_crealloc(BYADDR, max(NSEGS,1ul) * sizeof(image_seg_t*), false);
+
+  for (size_t i = 0; i < NSEGS; i++)
+    BYADDR[i] = &SEGS[i];
+
+  qsort(BYADDR, NSEGS, sizeof(image_seg_t*), seg_cmp);
+  return;
+}
+
+// the segment holding an address from the writing process
+static image_seg_t* seg_find(uptr_t a)
+{
+  size_t lo = 0, hi = NSEGS;
+
+  while (lo < hi)
+    {
+      size_t mid = (lo + hi) / 2;
+      image_seg_t* s = BYADDR[mid];
+
+      if (a < s->old)
+	hi = mid;
+
+      else if (a >= s->old + s->size)
+	lo = mid + 1;
+
+      else
+	return s;
+    }
+
+  return NULL;
+}
+
+static void seg_reset(void)
+{
+  NSEGS = 0;
+  return;
+}
+
+static inline bool image_isptr(val_t v)
+{
+  return ltag(v) != DIRECT && ltag(v) != SYMBOL && addr(v) && seg_find(addr(v));
+}
+
+static inline bool image_issym(val_t v)
+{
+  return ltag(v) == SYMBOL && addr(v);
+}
+
+static inline bool image_istext(val_t v)
+{
+  return ltag(v) != DIRECT && addr(v) >= (uptr_t)__executable_start && addr(v) < (uptr_t)_end;
+}
+
+/*
+   symbols, by their address in the writing process. Saving collects them here (sorted and
+   without repeats once they're all in); loading pairs each with its symbol in this process.
+ */
+typedef struct
+{
+  uptr_t    old;
+  symbol_t* new;
+} image_symref_t;
+
+static image_symref_t* SYMS   = NULL;
+static size_t          NSYMS  = 0, SYMCAP = 0;
+
+static void sym_add(symbol_t* old, symbol_t* new)
+{
+  if (NSYMS == SYMCAP)
+    {
+      SYMCAP = SYMCAP ? SYMCAP * 2 : 256;
+      SYMS   = vm_crealloc(SYMS, SYMCAP * sizeof(image_symref_t), false);
+    }
+
+  SYMS[NSYMS++] = (image_symref_t){ .old = (uptr_t)old, .new = new };
+  return;
+}
+
+static void sym_save(symbol_t* s)
+{
+  sym_add(s,s);
+  return;
+}
+
+static int sym_cmp(const void* x, const void* y)
+{
+  uptr_t a = ((image_symref_t*)x)->old, b = ((image_symref_t*)y)->old;
+  return a < b ? -1 : a > b;
+}
+
+static void sym_index(void)
+{
+  qsort(SYMS, NSYMS, sizeof(image_symref_t), sym_cmp);
+  size_t n = 0;
+
+  for (size_t i = 0; i < NSYMS; i++)
+    if (!n || SYMS[i].old != SYMS[n-1].old)
+      SYMS[n++] = SYMS[i];
+
+  NSYMS = n;
+  return;
+}
+
+static symbol_t* sym_find(uptr_t a)
+{
+  size_t lo = 0, hi = NSYMS;
+
+  while (lo < hi)
+    {
+      size_t mid = (lo + hi) / 2;
+
+      if (a < SYMS[mid].old)
+	hi = mid;
+
+      else if (a > SYMS[mid].old)
+	lo = mid + 1;
+
+      else
+	return SYMS[mid].new;
+    }
+
+  return NULL;
+}
+
+/* saving */
+static uint64_t* RELOC  = NULL;   // relocation bitmap
+static uint64_t* SYMREL = NULL;   // words holding symbols
+static uint64_t* TEXTREL = NULL;  // words pointing into the executable
+static uint64_t* MARKED = NULL;   // objects already traversed, by their first word
+static val_t*    IMGWORK = NULL;
+static size_t    IMGWORKCNT = 0, IMGWORKCAP = 0;
+
+static inline size_t image_word(const void* p)
+{
+  image_seg_t* s = seg_find((uptr_t)p);
+  return s->word + ((uptr_t)p - s->old) / 8;
+}
+
+static void image_push(val_t v)
+{
+  size_t w = image_word(ptr(void*,v));
+
+  if (MARKED[w / 64] & (1ul << (w % 64)))
+    return;
+
+  MARKED[w / 64] |= 1ul << (w % 64);
+
+  if (IMGWORKCNT == IMGWORKCAP)
+    {
+      IMGWORKCAP = IMGWORKCAP ? IMGWORKCAP * 2 : 1024;
+      IMGWORK = vm_crealloc(IMGWORK, IMGWORKCAP * sizeof(val_t), false);
+    }
+
+  IMGWORK[IMGWORKCNT++] = v;
+  return;
+}
+
+static void image_relocs(void)
+{
+  for (size_t i = GC_CONST_BASE; i < 16; i++)
+    {
+      if (image_isptr(R_GLOBAL_CONSTANTS[i]))
+	image_push(R_GLOBAL_CONSTANTS[i]);
+
+      else if (image_issym(R_GLOBAL_CONSTANTS[i]))
+	sym_save(ptr(symbol_t*,R_GLOBAL_CONSTANTS[i]));
+    }
+
+  while (IMGWORKCNT)
+    {
+      val_t v = IMGWORK[--IMGWORKCNT];
+      size_t cnt;
+      val_t* fields = gc_fields(val_type(v),v,&cnt);
+
+      for (size_t i = 0; i < cnt; i++)
+	{
+	  if (image_isptr(fields[i]))
+	    {
+	      size_t w = image_word(&fields[i]);
+	      RELOC[w / 64] |= 1ul << (w % 64);
+	      image_push(fields[i]);
+	    }
+
+	  else if (image_issym(fields[i]))
+	    {
+	      size_t w = image_word(&fields[i]);
+	      SYMREL[w / 64] |= 1ul << (w % 64);
+	      sym_save(ptr(symbol_t*,fields[i]));
+	    }
+
+	  else if (image_istext(fields[i]))
+	    {
+	      size_t w = image_word(&fields[i]);
+	      TEXTREL[w / 64] |= 1ul << (w % 64);
+	    }
+	}
+    }
+
+  return;
+}
+
+static void image_addlos(void* obj, size_t size)
+{
+  seg_add((uptr_t)obj, (uptr_t)obj, size);
+  return;
+}
+
+static bool image_write(int fd, const void* buf, size_t nbytes, off_t off)
+{
+  const uchr_t* p = buf;
+
+  while (nbytes)
+    {
+      ssize_t n = pwrite(fd, p, nbytes, off);
+
+      if (n <= 0)
+	return false;
+
+      p      += n;
+      off    += n;
+      nbytes -= n;
+    }
+
+  return true;
+}
+
+static bool image_read(int fd, void* buf, size_t nbytes, off_t off)
+{
+  uchr_t* p = buf;
+
+  while (nbytes)
+    {
+      ssize_t n = pread(fd, p, nbytes, off);
+
+      if (n <= 0)
+	return false;
+
+      p      += n;
+      off    += n;
+      nbytes -= n;
+    }
+
+  return true;
+}
+
+bool image_save(const chr_t* path)
+{
+  if (GC_COLLECTOR != GC_SEMISPACE)
+    {
+      fprintf(stderr,"Heap images need the semispace collector.\n");
+      return false;
+    }
+
+  // afterwards everything reachable is in RAM or the large object space
+  gc_major();
+
+  size_t page = sysconf(_SC_PAGESIZE);
+  seg_reset();
+  seg_add((uptr_t)RAM, (uptr_t)RAM, FREE - RAM);
+  los_each(image_addlos);
+  seg_index();
+
+  size_t nwords = SEGS[NSEGS-1].word + SEGS[NSEGS-1].size / 8;
+  size_t nmap   = (nwords + 63) / 64;
+  RELOC  = vm_cmalloc(nmap * 8);
+  SYMREL = vm_cmalloc(nmap * 8);
+  TEXTREL = vm_cmalloc(nmap * 8);
+  MARKED = vm_cmalloc(nmap * 8);
+  NSYMS  = 0;
+  image_relocs();
+  symtab_each(sym_save);
+  sym_index();
+
+  image_hdr_t hdr =
+    {
+      .magic     = IMAGE_MAGIC,
+      .version   = IMAGE_VERSION,
+      .pagesize  = page,
+      .text      = (uptr_t)__executable_start,
+      .textsize  = _end - __executable_start,
+      .base      = (uptr_t)RAM,
+      .nbytes    = FREE - RAM,
+      .heapsize  = HEAPSIZE,
+      .nlos      = NSEGS - 1,
+      .los_off   = page + ((FREE - RAM + page - 1) & ~(page - 1)),
+      .nwords    = nwords,
+      .nsyms     = NSYMS,
+    };
+
+  memcpy(hdr.constants, R_GLOBAL_CONSTANTS, sizeof(hdr.constants));
+  hdr.reloc_off = hdr.los_off + hdr.nlos * sizeof(image_los_t);
+
+  for (size_t i = 1; i < NSEGS; i++)
+    hdr.reloc_off += SEGS[i].size;
+
+  hdr.sym_off = hdr.reloc_off + 3 * nmap * 8;
+
+  int  fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  bool ok = fd >= 0
+    && image_write(fd, &hdr, sizeof(hdr), 0)
+    && image_write(fd, RAM, hdr.nbytes, page);
+
+  off_t off = hdr.los_off + hdr.nlos * sizeof(image_los_t);
+
+  for (size_t i = 1; ok && i < NSEGS; i++)
+    {
+      image_los_t lo = { .base = SEGS[i].old, .size = SEGS[i].size };
+      ok  = image_write(fd, &lo, sizeof(lo), hdr.los_off + (i - 1) * sizeof(lo))
+	&& image_write(fd, (void*)SEGS[i].old, SEGS[i].size, off);
+      off += SEGS[i].size;
+    }
+
+  ok = ok
+    && image_write(fd, RELOC, nmap * 8, hdr.reloc_off)
+    && image_write(fd, SYMREL, nmap * 8, hdr.reloc_off + nmap * 8)
+    && image_write(fd, TEXTREL, nmap * 8, hdr.reloc_off + 2 * nmap * 8);
+
+  off = hdr.sym_off;
+
+  for (size_t i = 0; ok && i < NSYMS; i++)
+    {
+      symbol_t*   s  = SYMS[i].new;
+      image_sym_t sm = { .base = SYMS[i].old, .flags = s->flags, .size = strlen(s->name) + 1 };
+      ok   = image_write(fd, &sm, sizeof(sm), off)
+	&& image_write(fd, s->name, sm.size, off + sizeof(sm));
+      off += sizeof(sm) + sm.size;
+    }
+
+  if (fd >= 0)
+    close(fd);
+
+  if (!ok)
+    fprintf(stderr,"Couldn't write the heap image %s: %s.\n",path,strerror(errno));
+
+  vm_cfree(RELOC);
+  vm_cfree(SYMREL);
+  vm_cfree(TEXTREL);
+  vm_cfree(MARKED);
+  RELOC = SYMREL = TEXTREL = MARKED = NULL;
+  return ok;
+}
+
+/* loading */
+static uptr_t TEXTOLD = 0, TEXTSIZE = 0;   // the executable in the writing process
+
+static inline val_t image_relocate(val_t v)
+{
+  if (ltag(v) == DIRECT || !addr(v))
+    return v;
+
+  if (ltag(v) == SYMBOL)
+    {
+      symbol_t* s = sym_find(addr(v));
+      return s ? (val_t)s | SYMBOL : v;
+    }
+
+  image_seg_t* s = seg_find(addr(v));
+
+  if (s)
+    return v - s->old + s->new;
+
+  if (addr(v) >= TEXTOLD && addr(v) < TEXTOLD + TEXTSIZE)
+    return v - TEXTOLD + (uptr_t)__executable_start;
+
+  return v;
+}
+
+// false if the image can't be used, before anything has been touched
+bool image_load(const chr_t* path)
+{
+  image_hdr_t hdr;
+  int fd = open(path, O_RDONLY);
+
+  if (fd < 0)
+    return false;
+
+  if (!image_read(fd, &hdr, sizeof(hdr), 0)
+      || hdr.magic != IMAGE_MAGIC
+      || hdr.version != IMAGE_VERSION
+      || hdr.pagesize != (uint64_t)sysconf(_SC_PAGESIZE)
+      || hdr.textsize != (uint64_t)(_end - __executable_start)
+      || GC_COLLECTOR != GC_SEMISPACE)
+    {
+      fprintf(stderr,"Ignoring heap image %s (written by a different build).\n",path);
+      close(fd);
+      return false;
+    }
+
+  TEXTOLD  = hdr.text;
+  TEXTSIZE = hdr.textsize;
+  HEAPINIT = max(HEAPINIT, hdr.heapsize);
+  init_heap();
+
+  // try for the address the image was written from, so RAM needs no relocation
+  munmap(RAM, HEAP_RESERVE);
+  RAM = heap_reserve((void*)hdr.base);
+
+  if (hdr.nbytes
+      && mmap(RAM, hdr.nbytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, hdr.pagesize) == MAP_FAILED)
+    {
+      fprintf(stdout,"[%s:%d:%s] Exiting due to failure mapping heap image.\n",__FILE__,__LINE__,__func__);
+      exit(EXIT_FAILURE);
+    }
+
+  heap_commit(RAM,HEAPSIZE);
+  FREE = RAM + hdr.nbytes;
+
+  seg_reset();
+  seg_add(hdr.base, (uptr_t)RAM, hdr.nbytes);
+  off_t off = hdr.los_off + hdr.nlos * sizeof(image_los_t);
+  bool ok = true;
+
+  for (size_t i = 0; ok && i < hdr.nlos; i++)
+    {
+      image_los_t lo;
+      ok = image_read(fd, &lo, sizeof(lo), hdr.los_off + i * sizeof(lo));
+
+      if (ok)
+	{
+	  void* obj = los_alloc(lo.size);
+	  ok   = image_read(fd, obj, lo.size, off);
+	  off += lo.size;
+	  seg_add(lo.base, (uptr_t)obj, lo.size);
+	}
+    }
+
+  size_t    nmap  = (hdr.nwords + 63) / 64;
+  uint64_t* reloc = vm_cmalloc(3 * nmap * 8), *symrel = reloc + nmap, *textrel = symrel + nmap;
+  ok  = ok && image_read(fd, reloc, 3 * nmap * 8, hdr.reloc_off);
+  off = hdr.sym_off;
+  NSYMS = 0;
+
+  // interned symbols are looked up again (the runtime may have made some already)
+  for (size_t i = 0; ok && i < hdr.nsyms; i++)
+    {
+      image_sym_t sm;
+
+      if (!(ok = image_read(fd, &sm, sizeof(sm), off) && sm.size))
+	break;
+
+      chr_t name[sm.size];
+
+      if (!(ok = image_read(fd, name, sm.size, off + sizeof(sm)) && !name[sm.size - 1]))
+	break;
+
+      // uninterned symbols (gensyms included) are made again under their saved names
+      symbol_t* s = sm.flags & SM_INTERNED
+	? symtab_intern(name,sm.flags)
+	: mk_symbol(name,sm.flags & ~SM_GENSYM);
+
+      s->flags = sm.flags;
+      sym_add((symbol_t*)sm.base,s);
+      off += sizeof(sm) + sm.size;
+    }
+
+  close(fd);
+
+  if (!ok)
+    {
+      fprintf(stdout,"[%s:%d:%s] Exiting due to truncated heap image %s.\n",__FILE__,__LINE__,__func__,path);
+      exit(EXIT_FAILURE);
+    }
+
+  seg_index();
+
+  // heap references only change if a segment (or the executable) moved, symbol references always do
+  bool moved = false, tmoved = TEXTOLD != (uptr_t)__executable_start;
+
+  for (size_t i = 0; i < NSEGS && !moved; i++)
+    moved = SEGS[i].old != SEGS[i].new;
+
+  for (size_t i = 0; (moved || tmoved || NSYMS) && i < NSEGS; i++)
+    {
+      image_seg_t* s = &SEGS[i];
+      val_t* words = (val_t*)s->new;
+
+      for (size_t w = 0; w < s->size / 8; w++)
+	{
+	  size_t   bit  = s->word + w;
+	  uint64_t mask = 1ul << (bit % 64);
+
+	  if ((moved && (reloc[bit / 64] & mask))
+	      || (tmoved && (textrel[bit / 64] & mask))
+	      || (symrel[bit / 64] & mask))
+	    words[w] = image_relocate(words[w]);
+	}
+    }
+
+  for (size_t i = GC_CONST_BASE; i < 16; i++)
+    R_GLOBAL_CONSTANTS[i] = image_relocate(hdr.constants[i]);
+
+  vm_cfree(reloc);
+  return true;
+}
@@ -0,0 +1,396 @@
+#include "../include/mem.h"
+
+/*
+   mark-region old space (Immix).
+
+   When GC_COLLECTOR is GC_IMMIX the old space is a sequence of IMMIX_BLOCK_SIZE blocks carved
+   out of the RAM reservation, each divided into IMMIX_LINE_SIZE lines. Promoted objects are
+   bump allocated into runs of lines that were free at the last sweep (holes), so the old space
+   needs one region of address space instead of two semispaces.
+
+   A major collection marks live objects in place and marks every line they touch. Object marks
+   live in a side bitmap (one bit per 16 byte grain) because pairs have no header to put them in.
+   Blocks that were badly fragmented at the last sweep are chosen as evacuation candidates, and
+   objects found in them are copied out instead of marked. The sweep then classifies each block
+   as free, recyclable (it has holes) or full from its line marks.
+
+   Objects are scanned using the layout in their type (see gc_fields), like the evacuators in
+   mem.c and gcpar.c.
+ */
+
+#define IMMIX_BLOCK_SIZE   0x8000u
+#define IMMIX_LINE_SIZE    0x80u
+#define IMMIX_NLINES       (IMMIX_BLOCK_SIZE / IMMIX_LINE_SIZE)
+#define IMMIX_GRAIN        16u
+#define IMMIX_NGRAINS      (IMMIX_BLOCK_SIZE / IMMIX_GRAIN)
+#define IMMIX_EVAC_LINES   (IMMIX_NLINES / 2)  // only blocks with at least this many free lines are evacuated
+#define IMMIX_EVAC_SHARE   8                   // and at most 1 block in IMMIX_EVAC_SHARE per collection
+
+gc_collector_t GC_COLLECTOR = GC_SEMISPACE;
+
+typedef enum
+  {
+    BLOCK_FREE,
+    BLOCK_RECYCLABLE,
+    BLOCK_FULL,
+  } block_state_t;
+
+typedef struct
+{
+  uint8_t  live[IMMIX_NLINES];            // line marks as of the last sweep (what the allocator sees)
+  uint8_t  marks[IMMIX_NLINES];           // line marks for the collection in progress
+  uint64_t objects[IMMIX_NGRAINS / 64];   // object marks
+  uint16_t free_lines;                    // as of the last sweep
+  uint8_t  state;
+  bool     evacuate;
+} immix_block_t;
+
+static immix_block_t* BLOCKS   = NULL;
+static size_t         NBLOCKS  = 0, BLOCKCAP = 0;
+static size_t         USED     = 0;     // bytes in marked lines at the last sweep, plus what was allocated since
+
+// the allocator only moves forward between sweeps, so it never hands out a line twice
+static size_t         CURBLK   = 0;     // block holding the current hole
+static size_t         HOLELINE = 0;     // where to look for the next hole in CURBLK
+static uchr_t        *CURSOR   = NULL, *LIMIT  = NULL;
+static uchr_t        *OCURSOR  = NULL, *OLIMIT = NULL;  // overflow block for medium objects
+
+// grey objects during a major collection
+static val_t*         MSTACK   = NULL;
+static size_t         MSCNT    = 0, MSCAP = 0;
+
+static inline uchr_t* block_base(size_t b)
+{
+  return RAM + b * IMMIX_BLOCK_SIZE;
+}
+
+static inline size_t block_index(const void* p)
+{
+  return ((uchr_t*)p - RAM) / IMMIX_BLOCK_SIZE;
+}
+
+bool immix_contains(const void* p)
+{
+  return GC_COLLECTOR == GC_IMMIX
+    && (uchr_t*)p >= RAM
+    && (uchr_t*)p < block_base(NBLOCKS);
+}
+
+size_t immix_nwords(void)
+{
+  return USED / 8;
+}
+
+/* allocation */
+static size_t block_new(void)
+{
+  assert((NBLOCKS + 1) * IMMIX_BLOCK_SIZE <= HEAP_RESERVE, BOUNDS_ERR, "heap reservation exhausted");
+
+  if (NBLOCKS == BLOCKCAP)
+    {
+      BLOCKCAP = BLOCKCAP ? BLOCKCAP * 2 : 64;
+      BLOCKS   = vm_crealloc(BLOCKS, BLOCKCAP * sizeof(immix_block_t), false);
+    }
+
+  // committed from the base of RAM, so that hugetlb pages stay 2MB aligned
+  heap_commit(RAM, (NBLOCKS + 1) * IMMIX_BLOCK_SIZE / 8);
+  memset(&BLOCKS[NBLOCKS],0,sizeof(immix_block_t));
+  BLOCKS[NBLOCKS].free_lines = IMMIX_NLINES;
+  BLOCKS[NBLOCKS].state      = BLOCK_FREE;
+
+  return NBLOCKS++;
+}
+
+static void next_hole(void)
+{
+  for (;; CURBLK++, HOLELINE = 0)
+    {
+      if (CURBLK == NBLOCKS)
+	block_new();
+
+      immix_block_t* b = &BLOCKS[CURBLK];
+
+      if (b->state == BLOCK_FULL || b->evacuate)
+	continue;
+
+      size_t start = HOLELINE;
+
+      while (start < IMMIX_NLINES && b->live[start])
+	start++;
+
+      size_t end = start;
+
+      while (end < IMMIX_NLINES && !b->live[end])
+	end++;
+
+      if (start < end)
+	{
+	  HOLELINE = end;
+	  CURSOR   = block_base(CURBLK) + start * IMMIX_LINE_SIZE;
+	  LIMIT    = block_base(CURBLK) + end * IMMIX_LINE_SIZE;
+	  return;
+	}
+    }
+}
+
+// objects bigger than a line that don't fit in the current hole go to a free block instead of skipping it
+static uchr_t* overflow_alloc(size_t asz)
+{
+  if (!OCURSOR || OCURSOR + asz > OLIMIT)
+    {
+      size_t b = CURBLK + 1;
+
+      while (b < NBLOCKS && (BLOCKS[b].state != BLOCK_FREE || BLOCKS[b].evacuate))
+	b++;
+
+      if (b == NBLOCKS)
+	block_new();
+
+      BLOCKS[b].state = BLOCK_FULL; // keep next_hole out of it
+      OCURSOR = block_base(b);
+      OLIMIT  = OCURSOR + IMMIX_BLOCK_SIZE;
+    }
+
+  uchr_t* out = OCURSOR;
+  OCURSOR += asz;
+  return out;
+}
+
+void* immix_alloc(size_t asz)
+{
+  assert(asz <= IMMIX_BLOCK_SIZE, VALUE_ERR, "%zu bytes is too big for an immix block", asz);
+  uchr_t* out;
+
+  if (CURSOR && CURSOR + asz <= LIMIT)
+    out = CURSOR;
+
+  else if (asz > IMMIX_LINE_SIZE)
+    {
+      USED += asz;
+      return overflow_alloc(asz);
+    }
+
+  else
+    {
+      next_hole();
+      out = CURSOR;
+    }
+
+  CURSOR += asz;
+  USED   += asz;
+  return out;
+}
+
+/* marking */
+static inline bool immix_ismarked(const void* p)
+{
+  immix_block_t* b = &BLOCKS[block_index(p)];
+  size_t g = ((uchr_t*)p - block_base(block_index(p))) / IMMIX_GRAIN;
+  return (b->objects[g / 64] >> (g % 64)) & 1;
+}
+
+static void immix_mark(const void* p, size_t asz)
+{
+  size_t bi = block_index(p);
+  immix_block_t* b = &BLOCKS[bi];
+  size_t off = (uchr_t*)p - block_base(bi);
+  size_t g = off / IMMIX_GRAIN;
+
+  b->objects[g / 64] |= 1ul << (g % 64);
+
+  for (size_t l = off / IMMIX_LINE_SIZE; l <= (off + asz - 1) / IMMIX_LINE_SIZE; l++)
+    b->marks[l] = 1;
+
+  return;
+}
+
+static void immix_push(val_t v)
+{
+  if (MSCNT == MSCAP)
+    {
+      MSCAP  = MSCAP ? MSCAP * 2 : 1024;
+      MSTACK = vm_crealloc(MSTACK, MSCAP * sizeof(val_t), false);
+    }
+
+  MSTACK[MSCNT++] = v;
+  return;
+}
+
+// shallow copy into a hole; the copy is marked and scanned later
+static val_t immix_move(type_t* to, val_t v)
+{
+  size_t osz = val_sizeof(v,to);
+  size_t asz = calc_mem_size(osz);
+  uchr_t* new = immix_alloc(asz);
+
+  memcpy(new, ptr(uchr_t*,v), osz);
+  val_t nv = (val_t)new | ltag(v);
+  car_(v) = R_FPTR;
+  cdr_(v) = nv;
+
+  immix_mark(new,asz);
+  nv |= v & REF_BITS;
+  immix_push(nv);
+  GC_STATS.copied += asz;
+  gc_count_copy(to->tp_tpkey,1);
+  return nv;
+}
+
+// forwarding is followed before the type is read, as in gc_trace
+static val_t immix_trace(val_t v)
+{
+  for (;;)
+    {
+      if (!gc_isheapref(v))
+	return v;
+
+      if (isfptr(car_(v))) // evacuated, promoted, or moved by vm_realloc
+	{
+	  v = fwd_(v);
+	  continue;
+	}
+
+      if (!isallocated(v, NULL))
+	return v;
+
+      void* p = ptr(void*,v);
+
+      if (los_contains(p))
+	{
+	  if (los_mark(v))
+	    immix_push(v);
+
+	  return v;
+	}
+
+      bool young = in_nursery(p);
+
+      if (!young && !immix_contains(p))
+	return v;
+
+      type_t* to = val_type(v);
+
+      if (young || BLOCKS[block_index(p)].evacuate)
+	return immix_move(to,v);
+
+      if (!immix_ismarked(p))
+	{
+	  immix_mark(p,val_asizeof(v,to));
+	  immix_push(v);
+	}
+
+      return v;
+    }
+}
+
+static void immix_scan(val_t v)
+{
+  size_t cnt;
+  val_t* fields = gc_fields(val_type(v),v,&cnt);
+
+  for (size_t i = 0; i < cnt; i++)
+    fields[i] = immix_trace(fields[i]);
+
+  return;
+}
+
+/* collection */
+// pick the most fragmented recyclable blocks, up to NBLOCKS / IMMIX_EVAC_SHARE of them
+static void immix_select(void)
+{
+  size_t hist[IMMIX_NLINES + 1] = { 0 };
+
+  for (size_t i = 0; i < NBLOCKS; i++)
+    if (BLOCKS[i].state == BLOCK_RECYCLABLE && i != CURBLK)
+      hist[BLOCKS[i].free_lines]++;
+
+  size_t budget = NBLOCKS / IMMIX_EVAC_SHARE, cnt = 0, threshold = IMMIX_NLINES + 1;
+
+  while (threshold > IMMIX_EVAC_LINES && cnt + hist[threshold-1] <= budget)
+    cnt += hist[--threshold];
+
+  for (size_t i = 0; i < NBLOCKS; i++)
+    BLOCKS[i].evacuate = BLOCKS[i].state == BLOCK_RECYCLABLE
+      && i != CURBLK
+      && BLOCKS[i].free_lines >= threshold;
+
+  return;
+}
+
+static void immix_sweep(void)
+{
+  size_t freerun = 0; // start of the current run of free blocks, released together
+  USED = 0;
+
+  for (size_t i = 0; i <= NBLOCKS; i++)
+    {
+      if (i == NBLOCKS)
+	{
+	  if (freerun < i)
+	    heap_release(block_base(freerun), (i - freerun) * IMMIX_BLOCK_SIZE);
+
+	  break;
+	}
+
+      immix_block_t* b = &BLOCKS[i];
+      size_t nmarked = 0;
+
+      for (size_t l = 0; l < IMMIX_NLINES; l++)
+	nmarked += b->marks[l];
+
+      memcpy(b->live, b->marks, IMMIX_NLINES);
+      memset(b->marks, 0, IMMIX_NLINES);
+      memset(b->objects, 0, sizeof(b->objects));
+
+      b->free_lines = IMMIX_NLINES - nmarked;
+      b->evacuate   = false;
+      b->state      = !nmarked ? BLOCK_FREE : nmarked == IMMIX_NLINES ? BLOCK_FULL : BLOCK_RECYCLABLE;
+      USED         += nmarked * IMMIX_LINE_SIZE;
+
+      if (b->state != BLOCK_FREE)
+	{
+	  if (freerun < i)
+	    heap_release(block_base(freerun), (i - freerun) * IMMIX_BLOCK_SIZE);
+
+	  freerun = i + 1;
+	}
+    }
+
+  CURBLK   = HOLELINE = 0;
+  CURSOR   = LIMIT  = NULL;
+  OCURSOR  = OLIMIT = NULL;
+  return;
+}
+
+// mark the old space in place, evacuating the nursery and the candidate blocks
+void immix_collect(void)
+{
+  immix_select();
+  size_t nroots = gc_nroots();
+
+  for (size_t i = 0; i < nroots; i++)
+    {
+      val_t* r = gc_root(i);
+      *r = immix_trace(*r);
+    }
+
+  while (MSCNT)
+    immix_scan(MSTACK[--MSCNT]);
+
+  immix_sweep();
+  return;
+}
+
+bool gc_set_collector(const chr_t* name)
+{
+  if (!strcmp(name,"semispace"))
+    GC_COLLECTOR = GC_SEMISPACE;
+
+  else if (!strcmp(name,"immix"))
+    GC_COLLECTOR = GC_IMMIX;
+
+  else
+    return false;
+
+  return true;
+}
@@ -0,0 +1,231 @@
+#include <sys/mman.h>
+#include <unistd.h>
+#include "../include/mem.h"
+
+/*
+   large object space.
+
+   Objects of at least LOS_THRESHOLD bytes that carry an object header are mapped out of line,
+   each with its own los_hdr_t in front of it. They are never copied: major collections mark
+   them and los_sweep unmaps the ones that weren't reached. Objects allocated since the last
+   minor collection are kept on a separate list so that their fields can be added to the
+   remembered set (their initializing stores don't go through the write barrier). Every mapping
+   is also kept in an index sorted by address, so that the write barrier can tell a field in the
+   middle of a large object from a C address.
+ */
+
+#define LOS_MAGIC 0x4c4f5321u
+
+typedef struct los_hdr_t
+{
+  struct los_hdr_t* next;
+  size_t            size;      // size of the mapping in bytes
+  uint32_t          magic;
+  uint32_t          marked;
+  uint64_t          _pad;      // keep the object 16-byte aligned
+} los_hdr_t;
+
+static los_hdr_t*  LOS_OLD   = NULL;
+static los_hdr_t*  LOS_YOUNG = NULL;
+static los_hdr_t** LOS_INDEX = NULL;
+static size_t      LOS_NINDEX = 0, LOS_INDEXCAP = 0;
+static size_t      LOS_PAGE  = 0;
+size_t             LOS_BYTES = 0;
+
+static inline los_hdr_t* los_head(const void* p)
+{
+  return ((los_hdr_t*)p) - 1;
+}
+
+// the position of the first mapping at or above h
+static size_t los_index_find(const void* h)
+{
+  size_t lo = 0, hi = LOS_NINDEX;
+
+  while (lo < hi)
+    {
+      size_t mid = (lo + hi) / 2;
+
+      if ((uptr_t)LOS_INDEX[mid] < (uptr_t)h)
+	lo = mid + 1;
+
+      else
+	hi = mid;
+    }
+
+  return lo;
+}
+
+static void los_index_add(los_hdr_t* h)
+{
+  if (LOS_NINDEX == LOS_INDEXCAP)
+    {
+      LOS_INDEXCAP = LOS_INDEXCAP ? LOS_INDEXCAP * 2 : 64;
+      LOS_INDEX    = vm_crealloc(LOS_INDEX, LOS_INDEXCAP * sizeof(los_hdr_t*), false);
+    }
+
+  size_t at = los_index_find(h);
+  memmove(LOS_INDEX + at + 1, LOS_INDEX + at, (LOS_NINDEX - at) * sizeof(los_hdr_t*));
+  LOS_INDEX[at] = h;
+  LOS_NINDEX++;
+  return;
+}
+
+static int los_index_cmp(const void* x, const void* y)
+{
+  uptr_t a = (uptr_t)*(los_hdr_t**)x, b = (uptr_t)*(los_hdr_t**)y;
+  return a < b ? -1 : a > b;
+}
+
+void* los_alloc(size_t nbytes)
+{
+  if (!LOS_PAGE)
+    LOS_PAGE = sysconf(_SC_PAGESIZE);
+
+  size_t mapsz = (nbytes + sizeof(los_hdr_t) + LOS_PAGE - 1) & ~(LOS_PAGE - 1);
+  los_hdr_t* h = mmap(NULL, mapsz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (h == MAP_FAILED)
+    {
+      fprintf(stdout,"[%s:%d:%s] Exiting due to machine allocation failure.\n",__FILE__,__LINE__,__func__);
+      exit(EXIT_FAILURE);
+    }
+
+  h->size    = mapsz;
+  h->magic   = LOS_MAGIC;
+  h->marked  = 0;
+  h->next    = LOS_YOUNG;
+  LOS_YOUNG  = h;
+  LOS_BYTES += mapsz;
+  los_index_add(h);
+
+  return h + 1;
+}
+
+bool los_contains(const void* p)
+{
+  uptr_t a = (uptr_t)p;
+
+  if (!LOS_PAGE || (a & (LOS_PAGE - 1)) != sizeof(los_hdr_t))
+    return false;
+
+  if (in_nursery(p) || p_in_heap((void*)p,RAM,HEAP_RESERVE/8) || (EXTRA && p_in_heap((void*)p,EXTRA,HEAP_RESERVE/8)))
+    return false;
+
+  return los_head(p)->magic == LOS_MAGIC;
+}
+
+// is p anywhere inside a large object (a field, rather than the object's start)?
+bool los_holds(const void* p)
+{
+  size_t at = los_index_find(p);
+
+  // the mapping that could hold p is the last one starting at or below it
+  if (at < LOS_NINDEX && LOS_INDEX[at] == p)
+    return false;
+
+  if (!at)
+    return false;
+
+  los_hdr_t* h = LOS_INDEX[at-1];
+  return (uptr_t)p >= (uptr_t)(h + 1) && (uptr_t)p < (uptr_t)h + h->size;
+}
+
+// true the first time a large object is reached during a major collection
+bool los_mark(val_t v)
+{
+  if (GCMINOR)
+    return false;
+
+  return !__atomic_exchange_n(&los_head(ptr(void*,v))->marked, 1, __ATOMIC_ACQ_REL);
+}
+
+// the tagged value for the object that follows a header
+static val_t los_value(los_hdr_t* h)
+{
+  obj_t* o = (obj_t*)(h + 1);
+  return (val_t)o | GLOBAL_TYPES[o->type]->tp_ltag;
+}
+
+static void los_age(void)
+{
+  while (LOS_YOUNG)
+    {
+      los_hdr_t* h = LOS_YOUNG;
+      LOS_YOUNG    = h->next;
+      h->next      = LOS_OLD;
+      LOS_OLD      = h;
+    }
+
+  return;
+}
+
+// called at the start of a minor collection
+void los_remember_young(void)
+{
+  for (los_hdr_t* h = LOS_YOUNG; h; h = h->next)
+    {
+      val_t v = los_value(h);
+
+      if (isfptr(car_(v))) // moved by vm_realloc, the barrier already saw the cdr
+	continue;
+
+      size_t cnt;
+      val_t* fields = gc_fields(val_type(v),v,&cnt);
+
+      for (size_t i = 0; i < cnt; i++)
+	if (v_in_young(fields[i]))
+	  gc_remember(&fields[i]);
+    }
+
+  los_age();
+  return;
+}
+
+// every large object with its size, for heap images
+void los_each(void (*fn)(void*,size_t))
+{
+  for (los_hdr_t* h = LOS_OLD; h; h = h->next)
+    fn(h + 1, h->size - sizeof(los_hdr_t));
+
+  for (los_hdr_t* h = LOS_YOUNG; h; h = h->next)
+    fn(h + 1, h->size - sizeof(los_hdr_t));
+
+  return;
+}
+
+// called at the end of a major collection
+void los_sweep(void)
+{
+  los_age();
+  los_hdr_t** curr = &LOS_OLD;
+
+  while (*curr)
+    {
+      los_hdr_t* h = *curr;
+
+      if (h->marked)
+	{
+	  h->marked = 0;
+	  curr      = &h->next;
+	}
+
+      else
+	{
+	  *curr      = h->next;
+	  LOS_BYTES -= h->size;
+	  munmap(h, h->size);
+	}
+    }
+
+  // everything left is old now
+  LOS_NINDEX = 0;
+
+  for (los_hdr_t* h = LOS_OLD; h; h = h->next)
+    LOS_INDEX[LOS_NINDEX++] = h;
+
+  if (LOS_NINDEX)
+    qsort(LOS_INDEX, LOS_NINDEX, sizeof(los_hdr_t*), los_index_cmp);
+
+  return;
+}
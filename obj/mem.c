@@ -1,42 +1,162 @@
+#include <sys/mman.h>
 #include "../include/mem.h"
 
 // stack manipulation
+/*
+   the stack and the dump are directories of fixed size segments that are never moved, so a
+   pointer to a slot stays good for as long as the slot is in use. Growing adds a segment;
+   shrinking happens at collections (stack_trim), keeping one spare segment above the top so
+   that code bouncing across a boundary doesn't allocate.
+ */
+val_t** STACKSEGS = NULL;
+val_t** DUMPSEGS  = NULL;
+static size_t NSTACKSEGS = 0, NDUMPSEGS = 0;   // segments allocated
+static size_t STACKDIRSZ = 0, DUMPDIRSZ = 0;   // directory capacities
+
+// with huge pages on, segments are carved in order out of one reservation per directory
+static uchr_t* STACKARENA = NULL;
+static uchr_t* DUMPARENA  = NULL;
+
+static void seg_grow(val_t*** dir, size_t* nsegs, size_t* dirsz, uchr_t* arena)
+{
+  if (*nsegs == *dirsz)
+    {
+      *dirsz = *dirsz ? *dirsz * 2 : 8;
+      *dir   = vm_crealloc(*dir, *dirsz * sizeof(val_t*), false);
+    }
+
+  if (arena)
+    {
+      size_t used = (*nsegs + 1) * STACK_SEG_SIZE;
+      assert(used * 8 <= STACK_RESERVE, BOUNDS_ERR, "stack reservation exhausted");
+      vm_commit(arena, used, STACK_RESERVE);
+      (*dir)[*nsegs] = (val_t*)arena + *nsegs * STACK_SEG_SIZE;
+      (*nsegs)++;
+    }
+
+  else
+    (*dir)[(*nsegs)++] = vm_cmalloc(STACK_SEG_SIZE * sizeof(val_t));
+
+  return;
+}
+
+/*
+   segments are freed from the top down, so an arena gives a huge page back once the segment
+   at its start goes (handing back less would split the page).
+ */
+static void seg_free(val_t* seg, uchr_t* arena)
+{
+  if (arena)
+    {
+      if (!((uptr_t)seg & (HUGE_PAGE_SIZE - 1)))
+	heap_release((uchr_t*)seg, HUGE_PAGE_SIZE);
+    }
+
+  else
+    vm_cfree(seg);
+
+  return;
+}
+
+void init_stack(void)
+{
+  if (HEAP_HUGEPAGES)
+    {
+      STACKARENA = vm_reserve(NULL, STACK_RESERVE);
+      DUMPARENA  = vm_reserve(NULL, STACK_RESERVE);
+    }
+
+  seg_grow(&STACKSEGS,&NSTACKSEGS,&STACKDIRSZ,STACKARENA);
+  seg_grow(&DUMPSEGS,&NDUMPSEGS,&DUMPDIRSZ,DUMPARENA);
+
+  // the registers and SP live at the base of the first segment
+  STACK     = STACKSEGS[0];
+  DUMP      = DUMPSEGS[0];
+  STACKSIZE = DUMPSIZE = STACK_SEG_SIZE;
+  SP        = SP_MIN - 1;
+  DP        = 0;
+  return;
+}
+
 inline void grow_stack()
 {
-  STACK = vm_crealloc(STACK,STACKSIZE*2,false);
-  STACKSIZE *= 2;
+  seg_grow(&STACKSEGS,&NSTACKSEGS,&STACKDIRSZ,STACKARENA);
+  STACKSIZE += STACK_SEG_SIZE;
   return;
 }
 
 inline void grow_dump()
 {
-  DUMP = vm_crealloc(DUMP,DUMPSIZE*2,false);
-  DUMPSIZE *= 2;
+  seg_grow(&DUMPSEGS,&NDUMPSEGS,&DUMPDIRSZ,DUMPARENA);
+  DUMPSIZE += STACK_SEG_SIZE;
+  return;
+}
+
+// free the segments more than one past the tops of the stack and the dump
+void stack_trim(void)
+{
+  size_t keep = (SP >> STACK_SEG_SHIFT) + 2;
+
+  while (NSTACKSEGS > keep)
+    {
+      seg_free(STACKSEGS[--NSTACKSEGS],STACKARENA);
+      STACKSIZE -= STACK_SEG_SIZE;
+    }
+
+  keep = (DP >> STACK_SEG_SHIFT) + 2;
+
+  while (NDUMPSEGS > keep)
+    {
+      seg_free(DUMPSEGS[--NDUMPSEGS],DUMPARENA);
+      DUMPSIZE -= STACK_SEG_SIZE;
+    }
+
   return;
 }
 
 inline val_t pop()
 {
   assert(SP, BOUNDS_ERR);
-  return STACK[SP--];
+  val_t out = *stack_ref(SP);
+  SP--;
+  return out;
 }
 
 inline val_t push(val_t v)
 {
-  if (SP >= STACKSIZE)
+  if (unlikely(SP + 1 >= STACKSIZE))
     grow_stack();
 
-  STACK[++SP] = v;
+  SP++;
+  *stack_ref(SP) = v;
   return SP-1;
 }
 
-
+/*
+   reserve n contiguous slots (a frame) at the top of the stack, returning the index below the
+   first one. A frame never straddles two segments: if it doesn't fit in the current one the
+   rest of the segment is filled with nil and the frame starts on the next.
+ */
 val_t pushn(size_t n)
 {
-  val_t out = SP;
+  assert(n <= STACK_SEG_SIZE, BOUNDS_ERR, "frame of %zu slots is bigger than a stack segment", n);
+
+  if (n && ((SP + 1) >> STACK_SEG_SHIFT) != ((SP + n) >> STACK_SEG_SHIFT))
+    {
+      if (SP + STACK_SEG_SIZE >= STACKSIZE)
+	grow_stack();
+
+      while ((SP + 1) & STACK_SEG_MASK)
+	{
+	  SP++;
+	  *stack_ref(SP) = R_NIL;
+	}
+    }
+
   if (SP + n >= STACKSIZE)
     grow_stack();
 
+  val_t out = SP;
   SP += n;
   return out;
 }
@@ -62,7 +182,8 @@ void save(uint32_t bmp)
       shift = __builtin_ctz(bmp);
       rx_idx += shift;
       bmp >>= shift + 1;
-      DUMP[DP++] = REGISTERS[rx_idx];
+      *dump_ref(DP) = REGISTERS[rx_idx];
+      DP++;
     }
 
   return;
@@ -80,7 +201,7 @@ void restore(uint32_t bmp)
       shift = __builtin_ctz(bmp);
       rx_idx += shift;
       bmp >>= shift + 1;
-      REGISTERS[rx_idx] = DUMP[DP-nelem];
+      REGISTERS[rx_idx] = *dump_ref(DP-nelem);
     }
 
   DP -= nelem;
@@ -97,7 +218,7 @@ void fsave(uint32_t bmp)
       shift = __builtin_ctz(bmp);
       rx_idx += shift;
       bmp >>= shift + 1;
-      DUMP[DP-nelem] = REGISTERS[rx_idx];
+      *dump_ref(DP-nelem) = REGISTERS[rx_idx];
     }
 
   return;
@@ -113,7 +234,7 @@ void frestore(uint32_t bmp)
       shift = __builtin_ctz(bmp);
       rx_idx += shift;
       bmp >>= shift + 1;
-      REGISTERS[rx_idx] = DUMP[DP-nelem];
+      REGISTERS[rx_idx] = *dump_ref(DP-nelem);
     }
 
   return;
@@ -121,6 +242,44 @@ void frestore(uint32_t bmp)
 
 
 /* memory management and bounds checking */
+// young generation and remembered set
+uchr_t *NURSERY = NULL, *NFREE = NULL;
+val_t   NURSERYSIZE = 0, NURSERYCRITICAL = 0;
+val_t** REMSET = NULL;
+val_t   REMSETSIZE = 0, REMSETCNT = 0;
+
+// overflow blocks for the nursery (opened when the nursery fills up between collections)
+typedef struct
+{
+  uchr_t* base;
+  size_t  size;           // in bytes
+} nspill_t;
+
+static nspill_t* NSPILL    = NULL;
+static size_t    NSPILLCNT = 0, NSPILLCAP = 0;
+static uchr_t   *NSPFREE   = NULL, *NSPLIM = NULL;
+bool             GCMINOR   = false;
+static uchr_t*   FROMLIM   = NULL;      // the end of the used fromspace while a major collection runs
+
+// handle scopes
+typedef struct
+{
+  val_t* slot;
+  val_t  tag;             // GC_TAGGED, or the tag to trace an untagged pointer with
+} gc_handle_t;
+
+static gc_handle_t* HANDLES    = NULL;
+static size_t       HANDLECNT  = 0, HANDLECAP = 0;
+static bool         GC_RUNNING = false;
+bool                GC_AUTO    = true;
+size_t              GC_DEFER   = 0;
+
+// telemetry
+gc_stats_t GC_STATS        = { 0 };
+double     GC_TOTAL_PAUSE  = 0;
+size_t     GC_TOTAL_COPIED = 0;
+bool       GC_LOG          = false;
+
 size_t calc_mem_size(size_t nbytes) {
   size_t basesz = max(nbytes, 16u);
   while (basesz % 16)
@@ -134,10 +293,29 @@ inline size_t val_asizeof(val_t v, type_t* to)
   return calc_mem_size(val_sizeof(v,to));
 }
 
-inline bool gc_check(void)
+static size_t young_nwords(void)
+{
+  size_t out = (val_t*)NFREE - (val_t*)NURSERY;
+
+  for (size_t i = 0; i < NSPILLCNT; i++)
+    out += NSPILL[i].size / 8;
+
+  return out;
+}
+
+static inline size_t old_nwords(void)
 {
+  if (GC_COLLECTOR == GC_IMMIX)
+    return immix_nwords();
+
+  return (val_t*)FREE - (val_t*)RAM;
+}
 
-  return FREE > (RAM + HEAPCRITICAL);
+inline bool gc_check(void)
+{
+  return NSPILLCNT
+    || (val_t)((val_t*)NFREE - (val_t*)NURSERY) > NURSERYCRITICAL
+    || old_nwords() > HEAPCRITICAL;
 }
 
 bool v_in_heap(val_t v, void* base, uint64_t heapsz)
@@ -152,16 +330,53 @@ bool p_in_heap(void* p, void* base, uint64_t heapsz)
   return a >= b && a <= c;
 }
 
+bool in_nursery(const void* p)
+{
+  uptr_t a = (uptr_t)p;
+
+  if (a >= (uptr_t)NURSERY && a < (uptr_t)(NURSERY + NURSERYSIZE * 8))
+    return true;
+
+  for (size_t i = 0; i < NSPILLCNT; i++)
+    if (a >= (uptr_t)NSPILL[i].base && a < (uptr_t)(NSPILL[i].base + NSPILL[i].size))
+      return true;
+
+  return false;
+}
+
+inline bool v_in_young(val_t v)
+{
+  return ltag(v) != DIRECT && addr(v) && in_nursery(ptr(void*,v));
+}
+
+// is v a reference into memory the collector owns (C pointers like streams and symbols are left alone)?
+bool gc_isheapref(val_t v)
+{
+  if (!(v & PTR_MASK) || ltag(v) == DIRECT || ltag(v) == IOSTRM || ltag(v) == SYMBOL)
+    return false;
+
+  void* p = ptr(void*,v);
+
+  if (in_nursery(p))
+    return true;
+
+  if (GC_COLLECTOR == GC_IMMIX ? immix_contains(p)
+      : p_in_heap(p,RAM,HEAP_RESERVE/8) || (EXTRA && p_in_heap(p,EXTRA,HEAP_RESERVE/8)))
+    return true;
+
+  return los_contains(p);
+}
+
 void* vm_cmalloc(uint64_t nbytes)
 {
-  void* out = malloc(nbytes);
+  // calloc gets fresh pages pre-zeroed from the kernel instead of scrubbing them
+  void* out = calloc(1,nbytes);
   if (!out)
     {
       fprintf(stdout,"[%s:%d:%s] Exiting due to machine allocation failure.\n",__FILE__,__LINE__,__func__);
       exit(EXIT_FAILURE);
     }
 
-  memset(out,0,nbytes);
   return out;
 }
 
@@ -184,11 +399,232 @@ void* vm_crealloc(void* m, uint64_t size, bool scrub)
   return new;
 }
 
+/*
+   the semispaces are reserved up front (HEAP_RESERVE bytes of address space each) and committed
+   as the heap grows, so growing never moves or scrubs them. After a flip the pages used by the
+   fromspace are handed back to the kernel, which zeroes them lazily when they're touched again.
+   The immix collector only reserves RAM and commits it a block at a time.
+
+   With HEAP_HUGEPAGES the reservations (and the stack and dump arenas) are backed by 2MB pages:
+   explicit hugetlb pages when the kernel has enough of them set aside for the whole reservation,
+   otherwise a 2MB aligned reservation advised for transparent huge pages. Commits are rounded up
+   to whole huge pages so that the kernel can fault them in as such.
+ */
+bool HEAP_HUGEPAGES = false;
+
+#define huge_round(n) (((n) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1))
+
+// heap sizes (in words) grow a whole huge page at a time
+static inline size_t gc_hugealign(size_t nwords)
+{
+  return HEAP_HUGEPAGES ? huge_round(nwords * 8) / 8 : nwords;
+}
+
+static uchr_t* vm_reserve_huge(void* hint, size_t nbytes)
+{
+  int   flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+  void* out   = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+  /*
+     without MAP_NORESERVE this only succeeds if the hugetlb pool can back every page. A hint
+     means a heap image is about to be mapped over the front of the reservation, which hugetlb
+     mappings don't allow at less than 2MB granularity.
+   */
+  int hflags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_HUGE_2MB
+  hflags |= MAP_HUGE_2MB;
+#endif
+
+  if (!hint)
+    out = mmap(NULL, nbytes, PROT_NONE, hflags, -1, 0);
+
+  if (out != MAP_FAILED)
+    return out;
+#endif
+
+  if (hint)
+    out = mmap(hint, nbytes, PROT_NONE, flags | MAP_FIXED_NOREPLACE, -1, 0);
+
+  if (out == MAP_FAILED)
+    {
+      // over-reserve by a huge page and trim both ends to a 2MB boundary
+      uchr_t* raw = mmap(NULL, nbytes + HUGE_PAGE_SIZE, PROT_NONE, flags, -1, 0);
+
+      if (raw == MAP_FAILED)
+	return NULL;
+
+      uchr_t* start = (uchr_t*)huge_round((uptr_t)raw);
+      uchr_t* end   = raw + nbytes + HUGE_PAGE_SIZE;
+
+      if (start > raw)
+	munmap(raw, start - raw);
+
+      if (end > start + nbytes)
+	munmap(start + nbytes, end - (start + nbytes));
+
+      out = start;
+    }
+
+#ifdef MADV_HUGEPAGE
+  madvise(out, nbytes, MADV_HUGEPAGE);
+#endif
+
+  return out;
+}
+
+uchr_t* vm_reserve(void* hint, size_t nbytes)
+{
+  int   flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+  void* out   = MAP_FAILED;
+
+  if (HEAP_HUGEPAGES)
+    {
+      uchr_t* huge = vm_reserve_huge(hint, nbytes);
+
+      if (huge)
+	return huge;
+    }
+
+  // a heap image maps best at the address it was written from
+  else if (hint)
+    out = mmap(hint, nbytes, PROT_NONE, flags | MAP_FIXED_NOREPLACE, -1, 0);
+
+  if (out == MAP_FAILED)
+    out = mmap(NULL, nbytes, PROT_NONE, flags, -1, 0);
+
+  if (out == MAP_FAILED)
+    {
+      fprintf(stdout,"[%s:%d:%s] Exiting due to machine allocation failure.\n",__FILE__,__LINE__,__func__);
+      exit(EXIT_FAILURE);
+    }
+
+  return out;
+}
+
+void vm_commit(uchr_t* base, size_t nwords, size_t limit)
+{
+  size_t nbytes = nwords * 8;
+  assert(nbytes <= limit, BOUNDS_ERR, "heap reservation exhausted");
+
+  if (HEAP_HUGEPAGES)
+    nbytes = min(huge_round(nbytes), limit);
+
+  if (mprotect(base, nbytes, PROT_READ | PROT_WRITE))
+    {
+      fprintf(stdout,"[%s:%d:%s] Exiting due to machine allocation failure.\n",__FILE__,__LINE__,__func__);
+      exit(EXIT_FAILURE);
+    }
+
+  return;
+}
+
+uchr_t* heap_reserve(void* hint)
+{
+  return vm_reserve(hint, HEAP_RESERVE);
+}
+
+void heap_commit(uchr_t* base, size_t nwords)
+{
+  vm_commit(base, nwords, HEAP_RESERVE);
+  return;
+}
+
+// a partial huge page is split by this (or, for hugetlb pages, kept)
+void heap_release(uchr_t* base, size_t nbytes)
+{
+  if (nbytes)
+    madvise(base, nbytes, MADV_DONTNEED);
+
+  return;
+}
+
+void init_heap(void)
+{
+  HEAPSIZE        = gc_hugealign(HEAPINIT);
+  HEAPCRITICAL    = (HEAPSIZE * 3) / 4;
+  RAM             = heap_reserve(NULL);
+  FREE            = RAM;
+
+  if (GC_COLLECTOR == GC_SEMISPACE)
+    {
+      EXTRA = heap_reserve(NULL);
+      heap_commit(RAM,HEAPSIZE);
+      heap_commit(EXTRA,HEAPSIZE);
+    }
+
+  NURSERYSIZE     = NURSERY_INIT_SIZE;
+  NURSERYCRITICAL = (NURSERYSIZE * 3) / 4;
+  NURSERY         = vm_cmalloc(NURSERYSIZE * 8);
+  NFREE           = NURSERY;
+
+  GC_LOG          = getenv("RSP_GC_LOG") != NULL;
+  return;
+}
+
+// called when a request doesn't fit in the nursery; the object is still young
+static void* nursery_spill(size_t nbytes)
+{
+  if (!NSPFREE || NSPFREE + nbytes > NSPLIM)
+    {
+      size_t blksz = max(nbytes, NURSERYSIZE * 8);
+
+      if (NSPILLCNT == NSPILLCAP)
+	{
+	  NSPILLCAP = NSPILLCAP ? NSPILLCAP * 2 : 8;
+	  NSPILL    = vm_crealloc(NSPILL, NSPILLCAP * sizeof(nspill_t), false);
+	}
+
+      uchr_t* blk = vm_cmalloc(blksz);
+      NSPILL[NSPILLCNT++] = (nspill_t){ .base = blk, .size = blksz };
+      NSPFREE = blk;
+      NSPLIM  = blk + blksz;
+    }
+
+  void* out = NSPFREE;
+  NSPFREE += nbytes;
+  return out;
+}
+
+// the nursery is full: collect unless the C code on the stack can't be moved under, otherwise spill
+static void* vm_alloc_slow(size_t nbytes)
+{
+  if (GC_AUTO && !GC_DEFER && !GC_RUNNING)
+    {
+      gc_run();
+
+      if (NFREE + nbytes <= NURSERY + NURSERYSIZE * 8)
+	{
+	  void* out = NFREE;
+	  NFREE += nbytes;
+	  return out;
+	}
+    }
+
+  return nursery_spill(nbytes);
+}
+
 void* vm_alloc(size_t bs, size_t elct, size_t elsz)
 {
   size_t allc_sz = calc_mem_size(bs + elct * elsz);
-  void* out = FREE;
-  FREE += allc_sz;
+  void* out;
+
+  // headerless requests (list cells) can't be identified in the large object space
+  if (unlikely(allc_sz >= LOS_THRESHOLD) && bs)
+    out = los_alloc(allc_sz);
+
+  else if (likely(NFREE + allc_sz <= NURSERY + NURSERYSIZE * 8))
+    {
+      out = NFREE;
+      NFREE += allc_sz;
+    }
+
+  else
+    out = vm_alloc_slow(allc_sz);
+
+  if (unlikely(PROF_INTERVAL) && (PROF_COUNTDOWN -= allc_sz) <= 0)
+    prof_sample(out,allc_sz,bs != 0);
+
   return out;
 }
 
@@ -202,99 +638,547 @@ void* vm_realloc(val_t v, size_t elct, size_t elsz)
   if (curr_sz >= allc_sz)
     return ptr(void*,v);
 
-  ltag_t  lt = v & LTAG_MASK;
-  uchr_t* new = FREE;
+  // the allocation can start a collection, which moves v
+  gc_scope_t s = gc_scope_open();
+  gc_preserve(v);
+
+  val_t   lt = v & LTAG_MASK;
+  uchr_t* new = allc_sz >= LOS_THRESHOLD ? los_alloc(allc_sz) : vm_allocb(0,allc_sz);
   uchr_t* old = ptr(uchr_t*,v);
-  FREE += allc_sz;
+
+  gc_scope_close(s);
 
   memcpy(new,old,curr_sz);
+
+  if (unlikely(PROF_INTERVAL))
+    prof_settype(new,to->tp_tpkey);
+
   val_t new_v = (val_t)new | lt;
 
+  /*
+     the old copy is forwarded so that references the caller can't reach are redirected by the
+     next collection. Until then its header reads R_FPTR, which tpkey doesn't follow, so the caller
+     has to replace every reference it dispatches on with the result.
+   */
   car_(old) = R_FPTR;
-  cdr_(old) = new_v;
+  wbarrier(cdr_(old),new_v);
 
   return new;
 }
 
+/* handle scopes */
+inline gc_scope_t gc_scope_open(void)
+{
+  return HANDLECNT;
+}
+
+inline void gc_scope_close(gc_scope_t s)
+{
+  HANDLECNT = s;
+  return;
+}
+
+void gc_handle(val_t* slot, val_t tag)
+{
+  if (HANDLECNT == HANDLECAP)
+    {
+      HANDLECAP = HANDLECAP ? HANDLECAP * 2 : 64;
+      HANDLES   = vm_crealloc(HANDLES, HANDLECAP * sizeof(gc_handle_t), false);
+    }
 
+  HANDLES[HANDLECNT++] = (gc_handle_t){ .slot = slot, .tag = tag };
+  return;
+}
 
-void gc_resize(void)
+inline void gc_defer(void)
+{
+  GC_DEFER++;
+  return;
+}
+
+inline void gc_allow(void)
+{
+  GC_DEFER--;
+  return;
+}
+
+// untagged pointers are tagged for the length of a collection, so that they trace like any root
+static void gc_handles_tag(void)
+{
+  for (size_t i = 0; i < HANDLECNT; i++)
+    if (HANDLES[i].tag != GC_TAGGED && *HANDLES[i].slot)
+      *HANDLES[i].slot |= HANDLES[i].tag;
+
+  return;
+}
+
+static void gc_handles_untag(void)
 {
-  if (GROWHEAP)
+  for (size_t i = 0; i < HANDLECNT; i++)
+    if (HANDLES[i].tag != GC_TAGGED)
+      *HANDLES[i].slot &= PTR_MASK;
+
+  return;
+}
+
+/* generational support */
+void gc_remember(val_t* slot)
+{
+  if (REMSETCNT == REMSETSIZE)
     {
-       HEAPSIZE *= 2;
-       EXTRA = vm_crealloc(EXTRA,HEAPSIZE*8,true);
-       GREWHEAP = true;
-       HEAPCRITICAL = (HEAPSIZE * 3) / 4;
+      REMSETSIZE = REMSETSIZE ? REMSETSIZE * 2 : 256;
+      REMSET     = vm_crealloc(REMSET, REMSETSIZE * sizeof(val_t*), false);
     }
 
-  else if (GREWHEAP)
+  REMSET[REMSETCNT++] = slot;
+  return;
+}
+
+// is slot a field of an old object (anywhere in it - a large object's fields aren't at its start)?
+static inline bool gc_isheapslot(val_t* slot)
+{
+  if (GC_COLLECTOR == GC_IMMIX ? immix_contains(slot)
+      : p_in_heap(slot,RAM,HEAP_RESERVE/8) || (EXTRA && p_in_heap(slot,EXTRA,HEAP_RESERVE/8)))
+    return true;
+
+  return los_holds(slot);
+}
+
+// slots outside the heap (C locals, the stack) are roots or dead by the next collection
+inline void gc_wbarrier(val_t* slot, val_t v)
+{
+  *slot = v;
+
+  if (v_in_young(v) && !in_nursery(slot) && gc_isheapslot(slot))
+    gc_remember(slot);
+
+  return;
+}
+
+static void gc_reset_nursery(void)
+{
+  for (size_t i = 0; i < NSPILLCNT; i++)
+    vm_cfree(NSPILL[i].base);
+
+  NSPILLCNT = 0;
+  NSPFREE   = NSPLIM = NULL;
+  NFREE     = NURSERY;
+  REMSETCNT = 0;
+  return;
+}
+
+// objects that have to be evacuated by the current collection
+inline bool gc_isfromspace(val_t v)
+{
+  if (in_nursery(ptr(void*,v)))
+    return true;
+
+  if (GCMINOR || los_contains(ptr(void*,v)))
+    return false;
+
+  // only what was allocated in the old RAM - symbols and other C memory are never moved
+  uchr_t* p = ptr(uchr_t*,v);
+  return p >= RAM && p < FROMLIM;
+}
+
+/*
+   root slots, in order: the global constants past the standard streams (the main namespace,
+   the symbol table, the special forms...), the live part of the stack (STACK[0] is the stack
+   pointer, so the registers start at 1), the handles and, during minor collections, the
+   remembered set.
+ */
+#define GC_NCONST (16 - GC_CONST_BASE)
+
+size_t gc_nroots(void)
+{
+  return GC_NCONST + SP + HANDLECNT + (GCMINOR ? REMSETCNT : 0);
+}
+
+val_t* gc_root(size_t n)
+{
+  if (n < GC_NCONST)
+    return &R_GLOBAL_CONSTANTS[GC_CONST_BASE + n];
+
+  n -= GC_NCONST;
+
+  if (n < SP)
+    return stack_ref(n + 1);
+
+  n -= SP;
+
+  if (n < HANDLECNT)
+    return HANDLES[n].slot;
+
+  return REMSET[n - HANDLECNT];
+}
+
+// the words of an object that hold rascal values (C data is never traced)
+val_t* gc_fields(type_t* to, val_t v, size_t* cnt)
+{
+  // a run of cdr-coded cells: the cars, then the cdr of the last cell
+  if (cdr_coded(v))
     {
-       EXTRA = vm_crealloc(EXTRA,HEAPSIZE*8,true);
-       GREWHEAP = false;
+      *cnt = ptr(obj_t*,v)->cmeta + 1;
+      return ptr(val_t*,v) + 1;
     }
-  
+
+  if (to->tp_cvtable)
+    *cnt = to->tp_nfields;
+
+  else
+    *cnt = (val_sizeof(v,to) - to->tp_init_sz) / 8;
+
+  return (val_t*)(ptr(uchr_t*,v) + to->tp_init_sz);
+}
+
+static void gc_drain(void);
+
+// the parallel evacuator allocates from FREE, so immix promotes serially
+static void gc_evacuate(void)
+{
+  if (GC_NTHREADS > 1 && GC_COLLECTOR == GC_SEMISPACE)
+    {
+      gc_par_evacuate();
+      return;
+    }
+
+  size_t nroots = gc_nroots();
+
+  // drained after each root, so that everything reachable from it is copied together
+  for (size_t i = 0; i < nroots; i++)
+    {
+      val_t* r = gc_root(i);
+      *r = gc_trace(*r);
+      gc_drain();
+    }
+
   return;
 }
 
-void gc_run(void) {
-  gc_resize();
-  FREE = EXTRA;
+void gc_resize(void)
+{
+  // the tospace has to be able to absorb the old space and the whole nursery
+  size_t live = old_nwords() + young_nwords();
+  size_t want = max(GC_POLICY->target(live), HEAPINIT);
 
-  // trace the top level environment
-  R_SYMTAB = gc_trace(R_SYMTAB);
-  R_MAIN = gc_trace(R_MAIN);
-  for (size_t i = 0; i < 4; i++)
-    REGISTERS[i] = gc_trace(REGISTERS[i]);
+  if (HEAPMAX && want > HEAPMAX)
+    want = HEAPMAX;
 
-  for (size_t i = SP; i > 0; i--)
-    STACK[i] = gc_trace(STACK[i]);
+  // parallel copies can leave part of each worker's last chunk unused
+  live    += gc_par_slack();
+  HEAPSIZE = gc_hugealign(max(want, live));
+  HEAPCRITICAL = (HEAPSIZE * 3) / 4;
+
+  if (GC_COLLECTOR == GC_SEMISPACE)
+    heap_commit(EXTRA,HEAPSIZE);
+
+  return;
+}
+
+/* telemetry */
+static double gc_clock(clockid_t clk)
+{
+  struct timespec ts;
+  clock_gettime(clk,&ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+inline void gc_count_copy(tpkey_t tk, size_t n)
+{
+  GC_STATS.objects[min(tk,GC_STAT_NKEYS-1u)] += n;
+  return;
+}
+
+static void gc_stats_begin(bool minor)
+{
+  uint64_t cycle = GC_STATS.cycle + 1;
+  memset(&GC_STATS,0,sizeof(gc_stats_t));
+
+  GC_STATS.cycle       = cycle;
+  GC_STATS.minor       = minor;
+  GC_STATS.start       = gc_clock(CLOCK_REALTIME);
+  GC_STATS.pause       = gc_clock(CLOCK_MONOTONIC);
+  GC_STATS.used_before = (old_nwords() + young_nwords()) * 8;
+  GC_STATS.allocated   = young_nwords() * 8;
+  GC_STATS.heap_before = HEAPSIZE * 8;
+  GC_STATS.los_before  = LOS_BYTES;
+  return;
+}
+
+static void gc_stats_end(void)
+{
+  size_t copied       = GC_STATS.copied;
+  GC_STATS.pause      = gc_clock(CLOCK_MONOTONIC) - GC_STATS.pause;
+  GC_STATS.used_after = old_nwords() * 8;
+  GC_STATS.heap_after = HEAPSIZE * 8;
+  GC_STATS.grew       = GC_STATS.heap_after > GC_STATS.heap_before;
+  GC_STATS.los_after  = LOS_BYTES;
+
+  GC_TOTAL_PAUSE  += GC_STATS.pause;
+  GC_TOTAL_COPIED += copied;
+  GC_POLICY->observe(&GC_STATS);
+
+  if (GC_LOG)
+    fprintf(stderr,
+	    "[gc] #%lu %s start=%.6f pause=%.6fs copied=%zu survival=%.3f used=%zu->%zu heap=%zu->%zu los=%zu->%zu%s\n",
+	    GC_STATS.cycle, GC_STATS.minor ? "minor" : "major",
+	    GC_STATS.start, GC_STATS.pause, GC_STATS.copied,
+	    GC_STATS.used_before ? (double)copied / GC_STATS.used_before : 0.0,
+	    GC_STATS.used_before, GC_STATS.used_after,
+	    GC_STATS.heap_before, GC_STATS.heap_after,
+	    GC_STATS.los_before, GC_STATS.los_after,
+	    GC_STATS.grew ? " grew" : "");
+
+  return;
+}
+
+// promote surviving nursery objects into the old space
+void gc_minor(void)
+{
+  gc_stats_begin(true);
+
+  GCMINOR = true;
+  los_remember_young();
+  gc_evacuate();
+  gc_reset_nursery();
+  GCMINOR = false;
+
+  gc_stats_end();
+  return;
+}
+
+// copy the old space and the nursery into the tospace (or mark them in place with immix)
+void gc_major(void)
+{
+  gc_stats_begin(false);
+
+  if (GC_COLLECTOR == GC_IMMIX)
+    {
+      gc_resize();
+      immix_collect();
+      gc_reset_nursery();
+      los_sweep();
+      gc_stats_end();
+      return;
+    }
+
+  size_t fromsz = FREE - RAM;
+  FROMLIM = FREE;
+  gc_resize();
+  FREE = EXTRA;
+  gc_evacuate();
+  FROMLIM = NULL;
 
   // swap the fromspace & the tospace
   uchr_t* TMPHEAP = RAM;
   RAM = EXTRA;
   EXTRA = TMPHEAP;
 
-  GROWHEAP = ((val_t*)FREE - (val_t*)RAM) > (HEAPSIZE * RAM_LOAD_FACTOR);
+  heap_release(EXTRA,fromsz);
+  gc_reset_nursery();
+  los_sweep();
 
+  gc_stats_end();
   return;
 }
 
-val_t gc_copy(type_t* tp, val_t v)
+void gc_run(void)
 {
-  val_t new; uchr_t* frm = ptr(uchr_t*,v);
-  
-  if (tp->tp_relocate)
-      new = tp->tp_relocate(tp,v,&FREE);
+  GC_RUNNING = true;
+  gc_handles_tag();
+
+  // sampled objects have to be typed before they move
+  if (PROF_INTERVAL)
+    prof_resolve();
+
+  // a minor collection is only safe if every young object could be promoted (immix can always grow)
+  if (GC_COLLECTOR == GC_SEMISPACE && old_nwords() + young_nwords() + gc_par_slack() > HEAPSIZE)
+    gc_major();
 
   else
     {
-      size_t asz = val_asizeof(v, tp);
-      size_t osz = val_sizeof(v, tp);
+      gc_minor();
+
+      if (old_nwords() > HEAPCRITICAL)
+	gc_major();
+    }
+
+  if (PROF_CENSUS)
+    prof_census();
+
+  gc_handles_untag();
+  stack_trim();
+  GC_RUNNING = false;
+  return;
+}
+
+// space for a copy in the tospace, or in the immix old space during a minor collection
+static inline uchr_t* gc_tospace_alloc(size_t asz)
+{
+  if (GC_COLLECTOR == GC_IMMIX)
+    return immix_alloc(asz);
+
+  uchr_t* out = FREE;
+  FREE += asz;
+  return out;
+}
+
+/*
+   serial evacuation.
+
+   Objects are copied shallowly and pushed on a grey stack, which gc_drain scans depth first
+   with the first child on top, so children are copied right after their parents (HAMT nodes
+   stay next to their subnodes) instead of in whatever order the root scan visits them. Lists of
+   ordinary pairs copy their whole cdr chain before any of the cars, so a list that was consed
+   up in order is still in order after the collection (cdr-coded runs move as one object). The
+   next grey object is prefetched while the current one is scanned, and the next pair in the
+   fromspace while a spine is copied.
+
+   Like the parallel evacuator this uses the layout in each type (gc_fields) rather than the
+   tp_capi->relocate callbacks.
+ */
+static val_t* GREY    = NULL;
+static size_t GREYCNT = 0, GREYCAP = 0;
+
+static inline void gc_grey(val_t v)
+{
+  if (GREYCNT == GREYCAP)
+    {
+      GREYCAP = GREYCAP ? GREYCAP * 2 : 1024;
+      GREY    = vm_crealloc(GREY, GREYCAP * sizeof(val_t), false);
+    }
 
-      memcpy(FREE,frm,osz);
-      new = tag(FREE,tp);
+  GREY[GREYCNT++] = v;
+  return;
+}
+
+// put the objects greyed since mark in the order they were copied, first on top
+static inline void gc_grey_reverse(size_t mark)
+{
+  if (GREYCNT - mark < 2)
+    return;
 
-      FREE += asz;
+  for (size_t i = mark, j = GREYCNT - 1; i < j; i++, j--)
+    {
+      val_t tmp = GREY[i];
+      GREY[i]   = GREY[j];
+      GREY[j]   = tmp;
     }
 
-  car_(frm) = R_FPTR;
-  cdr_(frm) = new;
-  
+  return;
+}
+
+val_t gc_copy(type_t* tp, val_t v)
+{
+  size_t osz = val_sizeof(v, tp);
+  size_t asz = val_asizeof(v, tp);
+  uchr_t* dst = gc_tospace_alloc(asz);
+  val_t new = (val_t)dst | ltag(v);
+
+  memcpy(dst, ptr(uchr_t*,v), osz);
+  car_(v) = R_FPTR;
+  cdr_(v) = new;
+  GC_STATS.copied += asz;
+  gc_count_copy(tp->tp_tpkey,1);
+
+  new |= v & REF_BITS;
+  gc_grey(new);
   return new;
 }
 
-val_t gc_trace(val_t v)
+static void gc_scan(val_t v)
 {
-  if (!isallocated(v, NULL) || in_heap(v,EXTRA,HEAPSIZE))
-    return v;
+  size_t cnt, mark = GREYCNT;
+  val_t* fields = gc_fields(val_type(v),v,&cnt);
 
-  else if (isfptr(car_(v)))
-      return trace_fptr(v);
+  for (size_t i = 0; i < cnt; i++)
+    fields[i] = gc_trace(fields[i]);
 
-  else
+  gc_grey_reverse(mark);
+  return;
+}
+
+static void gc_scan_list(val_t v)
+{
+  val_t p = v;
+  size_t n = 1, mark;
+
+  // each cdr copied here lands right after its predecessor, and is scanned here as well
+  for (;;)
     {
-      type_t* to = val_type(v);
-      return gc_copy(to,v);
+      mark = GREYCNT;
+      cdr_(p) = gc_trace(cdr_(p));
+
+      if (GREYCNT == mark || cdr_coded(cdr_(p)) || !(ispair(cdr_(p)) || islist(cdr_(p))))
+	break;
+
+      GREYCNT--;
+      p = cdr_(p);
+      prefetch(ptr(void*,cdr_(p)));
+      n++;
+    }
+
+  mark = GREYCNT;
+
+  for (p = v; n--; p = cdr_(p))
+    car_(p) = gc_trace(car_(p));
+
+  gc_grey_reverse(mark);
+  return;
+}
+
+static void gc_drain(void)
+{
+  while (GREYCNT)
+    {
+      val_t v = GREY[--GREYCNT];
+
+      if (GREYCNT)
+	prefetch(ptr(void*,GREY[GREYCNT-1]));
+
+      // a cdr-coded run is laid out in order already
+      if ((ispair(v) || islist(v)) && !cdr_coded(v))
+	gc_scan_list(v);
+
+      else
+	gc_scan(v);
+    }
+
+  return;
+}
+
+/*
+   the new location of v, copying it (and greying the copy) if it hasn't moved yet. The header of
+   a forwarded object is R_FPTR rather than a type key, so forwarding is followed before the type
+   is looked at.
+ */
+val_t gc_trace(val_t v)
+{
+  for (;;)
+    {
+      if (!gc_isheapref(v))
+	return v;
+
+      if (isfptr(car_(v)))
+	{
+	  v = fwd_(v);
+	  continue;
+	}
+
+      if (!isallocated(v, NULL))
+	return v;
+
+      if (los_contains(ptr(void*,v)))
+	{
+	  if (los_mark(v))
+	    gc_grey(v);
+
+	  return v;
+	}
+
+      if (!gc_isfromspace(v))
+	return v;
+
+      return gc_copy(val_type(v),v);
     }
 }
@@ -0,0 +1,603 @@
+#include "../include/nvec.h"
+#include "../include/rstr.h"
+#include "../include/bignum.h"
+
+
+MK_TYPE_PREDICATE(CVALUE,NVECTOR,nvec)
+MK_SAFECAST_P(nvec_t*,nvec,addr)
+
+/* element types (the last column says whether the kernels treat them as integers or floats) */
+#define NV_TYPES(X)                                  \
+  X(i8,  int8_t,   CNUM_INT8,    mk_int,    I)      \
+  X(u8,  uint8_t,  CNUM_UINT8,   mk_int,    I)      \
+  X(i16, int16_t,  CNUM_INT16,   mk_int,    I)      \
+  X(u16, uint16_t, CNUM_UINT16,  mk_int,    I)      \
+  X(i32, int32_t,  CNUM_INT32,   mk_int,    I)      \
+  X(u32, uint32_t, CNUM_UINT32,  mk_int,    I)      \
+  X(i64, int64_t,  CNUM_INT64,   mk_int,    I)      \
+  X(u64, uint64_t, CNUM_UINT64,  mk_uint64, I)      \
+  X(f32, flt32_t,  CNUM_FLOAT32, mk_float,  F)      \
+  X(f64, flt64_t,  CNUM_FLOAT64, mk_float,  F)
+
+static val_t mk_uint64(uint64_t u)
+{
+  if (u <= INT64_MAX)
+    return mk_int((rint_t)u);
+
+  return mk_bignum(&u,1,false);
+}
+
+/*
+   kernels. Each works a vector register at a time using GCC's vector extensions, then finishes
+   the tail with scalar code; the target clones give every kernel an AVX2 (256-bit) and a
+   baseline (SSE2, two 128-bit halves) body, and the loader binds the one this CPU supports.
+   Loads and stores go through memcpy, which compiles to unaligned vector moves.
+ */
+#define NV_VBYTES 32
+
+#if defined(__x86_64__)
+#define NV_CLONES __attribute__((target_clones("avx2","default")))
+#else
+#define NV_CLONES
+#endif
+
+#define NV_LOAD(v,p)   memcpy(&(v),(p),sizeof(v))
+#define NV_STORE(p,v)  memcpy((p),&(v),sizeof(v))
+
+typedef int64_t i64x4_t __attribute__((vector_size(32)));
+
+typedef void (*nv_binop_t)(void*,const void*,const void*,size_t);
+typedef void (*nv_cmpop_t)(uint8_t*,const void*,const void*,size_t);
+
+// r = x op y elementwise
+#define NV_BINOP(tn,ct,nm,op)                                                    \
+  NV_CLONES static void nv_##nm##_##tn(void* rp, const void* xp, const void* yp, size_t n) \
+  {                                                                             \
+    ct* r = rp; const ct* x = xp, *y = yp;                                      \
+    size_t i = 0, w = NV_VBYTES / sizeof(ct);                                   \
+    for (; i + w <= n; i += w)                                                  \
+      {                                                                         \
+	tn##_v a, b;                                                            \
+	NV_LOAD(a,x+i);                                                         \
+	NV_LOAD(b,y+i);                                                         \
+	a = a op b;                                                             \
+	NV_STORE(r+i,a);                                                        \
+      }                                                                         \
+    for (; i < n; i++)                                                          \
+      r[i] = x[i] op y[i];                                                      \
+  }
+
+// floats have no % operator
+#define NV_REM_I(tn,ct) NV_BINOP(tn,ct,rem,%)
+#define NV_REM_F(tn,ct)                                                         \
+  static void nv_rem_##tn(void* rp, const void* xp, const void* yp, size_t n)   \
+  {                                                                             \
+    ct* r = rp; const ct* x = xp, *y = yp;                                      \
+    for (size_t i = 0; i < n; i++)                                              \
+      r[i] = fmod(x[i],y[i]);                                                   \
+  }
+
+// r[i] = x[i] op y[i] as a 0 or 1 byte
+#define NV_CMPOP(tn,ct,nm,op)                                                    \
+  NV_CLONES static void nv_##nm##_##tn(uint8_t* r, const void* xp, const void* yp, size_t n) \
+  {                                                                             \
+    const ct* x = xp, *y = yp;                                                  \
+    size_t i = 0, w = NV_VBYTES / sizeof(ct);                                   \
+    for (; i + w <= n; i += w)                                                  \
+      {                                                                         \
+	tn##_v a, b;                                                            \
+	NV_LOAD(a,x+i);                                                         \
+	NV_LOAD(b,y+i);                                                         \
+	__typeof__(a op b) m = a op b;                                          \
+	for (size_t k = 0; k < w; k++)                                          \
+	  r[i+k] = m[k] & 1;                                                    \
+      }                                                                         \
+    for (; i < n; i++)                                                          \
+      r[i] = x[i] op y[i];                                                      \
+  }
+
+// the least (op is <) or greatest (op is >) of n > 0 elements
+#define NV_SELECT(tn,ct,nm,op)                                                   \
+  NV_CLONES static ct nv_##nm##_##tn(const void* xp, size_t n)                  \
+  {                                                                             \
+    const ct* x = xp;                                                           \
+    size_t i = 0, w = NV_VBYTES / sizeof(ct);                                   \
+    ct out = x[0];                                                              \
+    if (n >= w)                                                                 \
+      {                                                                         \
+	tn##_v acc, a;                                                          \
+	NV_LOAD(acc,x);                                                         \
+	for (i = w; i + w <= n; i += w)                                         \
+	  {                                                                     \
+	    NV_LOAD(a,x+i);                                                     \
+	    for (size_t k = 0; k < w; k++)                                      \
+	      acc[k] = a[k] op acc[k] ? a[k] : acc[k];                          \
+	  }                                                                     \
+	for (size_t k = 0; k < w; k++)                                          \
+	  out = acc[k] op out ? acc[k] : out;                                   \
+      }                                                                         \
+    for (; i < n; i++)                                                          \
+      out = x[i] op out ? x[i] : out;                                           \
+    return out;                                                                 \
+  }
+
+// integer sums and dot products are taken in 64-bit lanes (and wrap like int64_t)
+#define NV_SUM_I(tn,ct)                                                          \
+  NV_CLONES static val_t nv_sum_##tn(const void* xp, size_t n)                  \
+  {                                                                             \
+    const ct* x = xp;                                                           \
+    i64x4_t acc = { 0 };                                                        \
+    size_t i = 0;                                                               \
+    for (; i + 4 <= n; i += 4)                                                  \
+      {                                                                         \
+	tn##_v4 a;                                                              \
+	NV_LOAD(a,x+i);                                                         \
+	acc += __builtin_convertvector(a,i64x4_t);                              \
+      }                                                                         \
+    int64_t out = acc[0] + acc[1] + acc[2] + acc[3];                            \
+    for (; i < n; i++)                                                          \
+      out += x[i];                                                              \
+    return mk_int(out);                                                         \
+  }                                                                             \
+                                                                                \
+  NV_CLONES static val_t nv_dot_##tn(const void* xp, const void* yp, size_t n)  \
+  {                                                                             \
+    const ct* x = xp, *y = yp;                                                  \
+    i64x4_t acc = { 0 };                                                        \
+    size_t i = 0;                                                               \
+    for (; i + 4 <= n; i += 4)                                                  \
+      {                                                                         \
+	tn##_v4 a, b;                                                           \
+	NV_LOAD(a,x+i);                                                         \
+	NV_LOAD(b,y+i);                                                         \
+	acc += __builtin_convertvector(a,i64x4_t) * __builtin_convertvector(b,i64x4_t); \
+      }                                                                         \
+    int64_t out = acc[0] + acc[1] + acc[2] + acc[3];                            \
+    for (; i < n; i++)                                                          \
+      out += (int64_t)x[i] * (int64_t)y[i];                                     \
+    return mk_int(out);                                                         \
+  }
+
+// float sums and dot products keep one partial sum per lane
+#define NV_SUM_F(tn,ct)                                                          \
+  NV_CLONES static val_t nv_sum_##tn(const void* xp, size_t n)                  \
+  {                                                                             \
+    const ct* x = xp;                                                           \
+    tn##_v acc = { 0 }, a;                                                      \
+    size_t i = 0, w = NV_VBYTES / sizeof(ct);                                   \
+    for (; i + w <= n; i += w)                                                  \
+      {                                                                         \
+	NV_LOAD(a,x+i);                                                         \
+	acc += a;                                                               \
+      }                                                                         \
+    flt64_t out = 0;                                                            \
+    for (size_t k = 0; k < w; k++)                                              \
+      out += acc[k];                                                            \
+    for (; i < n; i++)                                                          \
+      out += x[i];                                                              \
+    return mk_float(out);                                                       \
+  }                                                                             \
+                                                                                \
+  NV_CLONES static val_t nv_dot_##tn(const void* xp, const void* yp, size_t n)  \
+  {                                                                             \
+    const ct* x = xp, *y = yp;                                                  \
+    tn##_v acc = { 0 }, a, b;                                                   \
+    size_t i = 0, w = NV_VBYTES / sizeof(ct);                                   \
+    for (; i + w <= n; i += w)                                                  \
+      {                                                                         \
+	NV_LOAD(a,x+i);                                                         \
+	NV_LOAD(b,y+i);                                                         \
+	acc += a * b;                                                           \
+      }                                                                         \
+    flt64_t out = 0;                                                            \
+    for (size_t k = 0; k < w; k++)                                              \
+      out += acc[k];                                                            \
+    for (; i < n; i++)                                                          \
+      out += (flt64_t)x[i] * y[i];                                              \
+    return mk_float(out);                                                       \
+  }
+
+#define NV_KERNELS(tn,ct,cn,box,kind)                                           \
+  typedef ct tn##_v  __attribute__((vector_size(NV_VBYTES)));                   \
+  typedef ct tn##_v4 __attribute__((vector_size(4 * sizeof(ct))));             \
+  NV_BINOP(tn,ct,add,+)                                                         \
+  NV_BINOP(tn,ct,sub,-)                                                         \
+  NV_BINOP(tn,ct,mul,*)                                                         \
+  NV_BINOP(tn,ct,div,/)                                                         \
+  NV_REM_##kind(tn,ct)                                                          \
+  NV_CMPOP(tn,ct,eq,==)                                                         \
+  NV_CMPOP(tn,ct,lt,<)                                                          \
+  NV_CMPOP(tn,ct,le,<=)                                                         \
+  NV_CMPOP(tn,ct,gt,>)                                                          \
+  NV_CMPOP(tn,ct,ge,>=)                                                         \
+  NV_SELECT(tn,ct,min,<)                                                        \
+  NV_SELECT(tn,ct,max,>)                                                        \
+  NV_SUM_##kind(tn,ct)                                                          \
+                                                                                \
+  static val_t nv_rmin_##tn(const void* x, size_t n) { return box(nv_min_##tn(x,n)); } \
+  static val_t nv_rmax_##tn(const void* x, size_t n) { return box(nv_max_##tn(x,n)); } \
+  static val_t nv_get_##tn(const void* x, size_t i)  { return box(((const ct*)x)[i]); } \
+                                                                                \
+  static void nv_set_##tn(void* x, size_t i, val_t v)                           \
+  {                                                                             \
+    ((ct*)x)[i] = isfixnum(v) ? (ct)ival(v) : (ct)fval(v);                      \
+  }                                                                             \
+                                                                                \
+  static bool nv_haszero_##tn(const void* xp, size_t n)                         \
+  {                                                                             \
+    const ct* x = xp;                                                           \
+    for (size_t i = 0; i < n; i++)                                              \
+      if (!x[i])                                                                \
+	return true;                                                            \
+    return false;                                                               \
+  }                                                                             \
+                                                                                \
+  NV_CLONES static void nv_cvt_##tn(void* rp, const void* x, uint32_t from, size_t n) \
+  {                                                                             \
+    ct* r = rp;                                                                 \
+    switch (from)                                                               \
+      {                                                                         \
+	NV_CVT_CASES(ct)                                                        \
+      }                                                                         \
+  }
+
+/*
+   conversions into each element type from each of the others (the source list repeats
+   NV_TYPES, which can't be expanded inside its own expansion). Plain loops, which the
+   compiler vectorizes.
+ */
+#define NV_CVT_CASE(ct,fcode,fct)                                                \
+  case fcode:                                                                   \
+    for (size_t i = 0; i < n; i++)                                              \
+      r[i] = (ct)((const fct*)x)[i];                                            \
+    break;
+
+#define NV_CVT_CASES(ct)                                                         \
+  NV_CVT_CASE(ct,CNUM_INT8,int8_t)                                              \
+  NV_CVT_CASE(ct,CNUM_UINT8,uint8_t)                                            \
+  NV_CVT_CASE(ct,CNUM_INT16,int16_t)                                            \
+  NV_CVT_CASE(ct,CNUM_UINT16,uint16_t)                                          \
+  NV_CVT_CASE(ct,CNUM_INT32,int32_t)                                            \
+  NV_CVT_CASE(ct,CNUM_UINT32,uint32_t)                                          \
+  NV_CVT_CASE(ct,CNUM_INT64,int64_t)                                            \
+  NV_CVT_CASE(ct,CNUM_UINT64,uint64_t)                                          \
+  NV_CVT_CASE(ct,CNUM_FLOAT32,flt32_t)                                          \
+  NV_CVT_CASE(ct,CNUM_FLOAT64,flt64_t)
+
+NV_TYPES(NV_KERNELS)
+
+/* the element type table */
+typedef struct
+{
+  c_num_t      code;
+  uint16_t     size;
+  bool         isint;
+  const chr_t* name;
+  nv_binop_t   binop[NV_EQ];
+  nv_cmpop_t   cmpop[NV_GE - NV_EQ + 1];
+  val_t      (*sum)(const void*,size_t);
+  val_t      (*dot)(const void*,const void*,size_t);
+  val_t      (*least)(const void*,size_t);
+  val_t      (*greatest)(const void*,size_t);
+  val_t      (*get)(const void*,size_t);
+  void       (*set)(void*,size_t,val_t);
+  bool       (*haszero)(const void*,size_t);
+  void       (*convert)(void*,const void*,uint32_t,size_t);
+} nv_eltype_t;
+
+#define NV_ELTYPE(tn,ct,cn,box,kind)                                           \
+  {                                                                             \
+    .code    = cn,                                                              \
+    .size    = sizeof(ct),                                                      \
+    .isint   = #kind[0] == 'I',                                                 \
+    .name    = #tn,                                                             \
+    .binop   = { nv_add_##tn, nv_sub_##tn, nv_mul_##tn, nv_div_##tn, nv_rem_##tn }, \
+    .cmpop   = { nv_eq_##tn, nv_lt_##tn, nv_le_##tn, nv_gt_##tn, nv_ge_##tn },   \
+    .sum     = nv_sum_##tn,                                                     \
+    .dot     = nv_dot_##tn,                                                     \
+    .least   = nv_rmin_##tn,                                                    \
+    .greatest = nv_rmax_##tn,                                                   \
+    .get     = nv_get_##tn,                                                     \
+    .set     = nv_set_##tn,                                                     \
+    .haszero = nv_haszero_##tn,                                                 \
+    .convert = nv_cvt_##tn,                                                     \
+  },
+
+static const nv_eltype_t NV_ELTYPES[] = { NV_TYPES(NV_ELTYPE) };
+
+#define NV_NELTYPES (sizeof(NV_ELTYPES) / sizeof(nv_eltype_t))
+
+/*
+   lookup by code. The common element type of two vectors is the OR of their codes (see
+   rtypes.h), so NV_COMMON maps every OR of two element codes to an entry in NV_ELTYPES. The
+   only results that aren't element types themselves are INT128 (a u64 with a signed type) and
+   FLOAT128 (a u64 with a float), which have no lossless element type and are done as f64.
+   Entries are offset by one so that 0 means none.
+ */
+#define NV_INDEX(tn,ct,cn,box,kind)  NV_IX_##tn,
+#define NV_BYCODE(tn,ct,cn,box,kind) [cn] = NV_IX_##tn + 1,
+
+enum { NV_TYPES(NV_INDEX) };
+
+static const uint8_t NV_CODES[256] = { NV_TYPES(NV_BYCODE) };
+
+static const uint8_t NV_COMMON[256] =
+  {
+    NV_TYPES(NV_BYCODE)
+    [CNUM_INT128]   = NV_IX_f64 + 1,
+    [CNUM_FLOAT128] = NV_IX_f64 + 1,
+  };
+
+static inline const nv_eltype_t* nv_eltype(uint32_t code)
+{
+  return NV_CODES[code & 0xff] ? &NV_ELTYPES[NV_CODES[code & 0xff] - 1] : NULL;
+}
+
+static inline const nv_eltype_t* nv_common(uint32_t x, uint32_t y)
+{
+  return &NV_ELTYPES[NV_COMMON[(x | y) & 0xff] - 1];
+}
+
+// v's elements as et, converting them into *scratch if v has another element type
+static const void* nv_operand(nvec_t* v, const nv_eltype_t* et, void** scratch)
+{
+  if (v->cmeta == et->code)
+    return v->data;
+
+  *scratch = vm_cmalloc(v->size * et->size);
+  et->convert(*scratch,v->data,v->cmeta,v->size);
+  return *scratch;
+}
+
+static const nv_eltype_t* nv_eltype_named(const chr_t* name)
+{
+  for (size_t i = 0; i < NV_NELTYPES; i++)
+    if (!strcmp(NV_ELTYPES[i].name,name))
+      return &NV_ELTYPES[i];
+
+  return NULL;
+}
+
+/* object constructors */
+// the elements are left uninitialized
+nvec_t* mk_nvec(c_num_t code, size_t n)
+{
+  const nv_eltype_t* et = nv_eltype(code);
+  assert(et,VALUE_ERR,"not a numeric element type");
+
+  nvec_t* out = vm_allocb(16,n * et->size);
+  out->type   = NVECTOR;
+  out->cmeta  = code;
+  out->size   = n;
+
+  return out;
+}
+
+// (nvec "f64" 1 2 3) - the element type name, then the elements
+val_t nvec_new(type_t* to, val_t args, size_t argc)
+{
+  (void)to;
+  val_t* stk = (val_t*)args;
+  assert(argc >= 1,ARITY_ERR,1,(int32_t)argc);
+  assert(isstr(stk[0]),TYPE_ERR,"str",val_typename(stk[0]));
+
+  chr_t buf[SSTR_MAX+1];
+  const nv_eltype_t* et = nv_eltype_named(rstr_chars(stk[0],buf));
+  assert(et,VALUE_ERR,"unknown element type");
+
+  for (size_t i = 1; i < argc; i++)
+    assert(isfixnum(stk[i]) || isfloat(stk[i]),TYPE_ERR,"number",val_typename(stk[i]));
+
+  // the arguments live on the stack, so the allocation can't lose them
+  nvec_t* out = mk_nvec(et->code,argc - 1);
+
+  for (size_t i = 1; i < argc; i++)
+    et->set(out->data,i - 1,stk[i]);
+
+  return (val_t)out | CVALUE;
+}
+
+/* accessors */
+size_t nvec_sizeof(type_t* to, val_t x)
+{
+  nvec_t* v = ptr(nvec_t*,x);
+  return to->tp_base_sz + v->size * nv_eltype(v->cmeta)->size;
+}
+
+inline size_t nvec_elcnt(val_t x)
+{
+  return tonvec(x)->size;
+}
+
+val_t nvec_assocn(val_t x, size_t i)
+{
+  nvec_t* v = tonvec(x);
+  assert(i < v->size,BOUNDS_ERR,"index out of range");
+
+  return nv_eltype(v->cmeta)->get(v->data,i);
+}
+
+val_t nvec_rplcn(val_t x, size_t i, val_t n)
+{
+  nvec_t* v = tonvec(x);
+  assert(i < v->size,BOUNDS_ERR,"index out of range");
+  assert(isfixnum(n) || isfloat(n),TYPE_ERR,"number",val_typename(n));
+
+  nv_eltype(v->cmeta)->set(v->data,i,n);
+  return x;
+}
+
+/* elementwise operations and reductions */
+// x and y must have the same length; mixed element types are promoted to their common type
+val_t nvec_binop(val_t x, val_t y, nv_op_t op)
+{
+  nvec_t* a = tonvec(x), *b = tonvec(y);
+  const nv_eltype_t* et = nv_common(a->cmeta,b->cmeta);
+
+  assert(a->size == b->size,BOUNDS_ERR,"vector lengths differ");
+
+  size_t n = a->size;
+
+  gc_scope_t s = gc_scope_open();
+  gc_preserve(x);
+  gc_preserve(y);
+
+  nvec_t* r = mk_nvec(op < NV_EQ ? et->code : CNUM_UINT8,n);
+  gc_scope_close(s);
+
+  // the operands are converted outside the heap, after the last allocation
+  void* xs = NULL, *ys = NULL;
+  const void* xd = nv_operand(ptr(nvec_t*,x),et,&xs);
+  const void* yd = nv_operand(ptr(nvec_t*,y),et,&ys);
+
+  if (et->isint && (op == NV_DIV || op == NV_REM))
+    assert(!et->haszero(yd,n),VALUE_ERR,"division by zero");
+
+  if (op < NV_EQ)
+    et->binop[op](r->data,xd,yd,n);
+
+  else
+    et->cmpop[op - NV_EQ](r->data,xd,yd,n);
+
+  if (xs)
+    vm_cfree(xs);
+
+  if (ys)
+    vm_cfree(ys);
+
+  return (val_t)r | CVALUE;
+}
+
+inline val_t nvec_sum(val_t x)
+{
+  nvec_t* v = tonvec(x);
+  return nv_eltype(v->cmeta)->sum(v->data,v->size);
+}
+
+val_t nvec_min(val_t x)
+{
+  nvec_t* v = tonvec(x);
+  assert(v->size,BOUNDS_ERR,"empty vector");
+
+  return nv_eltype(v->cmeta)->least(v->data,v->size);
+}
+
+val_t nvec_max(val_t x)
+{
+  nvec_t* v = tonvec(x);
+  assert(v->size,BOUNDS_ERR,"empty vector");
+
+  return nv_eltype(v->cmeta)->greatest(v->data,v->size);
+}
+
+val_t nvec_dot(val_t x, val_t y)
+{
+  nvec_t* a = tonvec(x), *b = tonvec(y);
+  const nv_eltype_t* et = nv_common(a->cmeta,b->cmeta);
+
+  assert(a->size == b->size,BOUNDS_ERR,"vector lengths differ");
+
+  void* xs = NULL, *ys = NULL;
+  const void* xd = nv_operand(a,et,&xs);
+  const void* yd = nv_operand(b,et,&ys);
+
+  // boxing the result can allocate, but nothing here is on the heap
+  val_t out = et->dot(xd,yd,a->size);
+
+  if (xs)
+    vm_cfree(xs);
+
+  if (ys)
+    vm_cfree(ys);
+
+  return out;
+}
+
+/* hashing, ordering and printing */
+hash_t nvec_hash(val_t x, uint32_t r)
+{
+  nvec_t* v = ptr(nvec_t*,x);
+  return hash_bytes(v->data, r + v->cmeta, v->size * nv_eltype(v->cmeta)->size);
+}
+
+// by element type, then length, then contents
+int32_t nvec_ord(val_t x, val_t y)
+{
+  nvec_t* a = ptr(nvec_t*,x), *b = ptr(nvec_t*,y);
+
+  if (a->cmeta != b->cmeta)
+    return compare(a->cmeta,b->cmeta);
+
+  if (a->size != b->size)
+    return compare(a->size,b->size);
+
+  int32_t rslt = memcmp(a->data,b->data,a->size * nv_eltype(a->cmeta)->size);
+  return compare(rslt,0);
+}
+
+void nvec_prn(val_t x, riostrm_t* f)
+{
+  nvec_t* v = ptr(nvec_t*,x);
+  const nv_eltype_t* et = nv_eltype(v->cmeta);
+
+  fprintf(f,"#%s[",et->name);
+
+  for (size_t i = 0; i < v->size; i++)
+    {
+      if (i)
+	fputc(' ',f);
+
+      // printing a boxed element can't allocate, except for a u64 past INT64_MAX
+      val_t el = et->get(v->data,i);
+      val_prn(el,f);
+      v = ptr(nvec_t*,x);
+    }
+
+  fputc(']',f);
+  return;
+}
+
+
+static uint8_t nvec_isalloc(type_t* to, val_t x)
+{
+  (void)to; (void)x;
+  return true;
+}
+
+cvspec_t NVEC_CVSPEC =
+  {
+    .el_cnum = CNUM_UINT8,  // the real element type is in the header
+    .el_cptr = PTR_NONE,
+    .el_sz   = 1,
+  };
+
+capi_t NVEC_CAPI =
+  {
+    .prn         = nvec_prn,
+    .call        = NULL,
+    .size        = nvec_sizeof,
+    .elcnt       = nvec_elcnt,
+    .hash        = nvec_hash,
+    .ord         = nvec_ord,
+    .new         = nvec_new,
+    .builtin_new = NULL,
+    .init        = NULL,
+    .relocate    = cv_relocate,
+    .isalloc     = nvec_isalloc,
+  };
+
+type_t NVEC_TYPE_OBJ =
+  {
+    .type              = DATATYPE,
+    .cmeta             = NVECTOR,
+    .tp_tpkey          = NVECTOR,
+    .tp_ltag           = CVALUE,
+    .tp_isalloc        = true,
+    .tp_sizing         = WIDE_LEN,
+    .tp_init_sz        = 16,
+    .tp_base_sz        = 16,
+    .tp_nfields        = 0,
+    .tp_cvtable        = &NVEC_CVSPEC,
+    .tp_capi           = &NVEC_CAPI,
+    .name              = "nvec",
+  };
@@ -4,7 +4,12 @@ MK_SAFECAST_P(pair_t*,pair,addr)
 
 pair_t* mk_pair(val_t ca, val_t cd)
 {
+  gc_scope_t s = gc_scope_open();
+  gc_preserve(ca);
+  gc_preserve(cd);
+
   pair_t* hd = vm_allocc(1);
+  gc_scope_close(s);
 
   car_(hd) = ca;
   cdr_(hd) = cd;
@@ -14,27 +19,85 @@ return (pair_t*)hd;
 
 
 /* object constructors */
-list_t* mk_list(val_t* args, size_t argc)
+/*
+   a list of argc cells as cdr-coded runs; the runs are built back to front so that each can point
+   at the next. A run of one cell would take a header and a tail word to save nothing, so a single
+   cell left over at the front is an ordinary pair.
+ */
+val_t mk_list(val_t* args, size_t argc)
 {
   if (argc == 0)
-    return NULL;
+    return R_NIL;
 
-  else
-    {
-      list_t* out = vm_allocc(argc);
-      list_t* curr = out;
-      size_t i = 1;
-      for (; i < argc - 1; i++, curr++)
+  gc_scope_t s = gc_scope_open();
+  val_t out = R_NIL;
+
+  for (size_t j = 0; j < argc; j++)
+    gc_preserve(args[j]);
+
+  gc_preserve(out);
+
+  for (size_t end = argc; end;)
     {
-      head(curr) = args[i];
-      tail(curr) = (curr + 1);
-    }
+      size_t n = min(end, (size_t)CDR_RUN_MAX), start = end - n;
 
-  head(curr) = args[i];
-  tail(curr) = 0;
+      if (n == 1)
+	{
+	  out = (val_t)mk_pair(args[start],out);
+	  break;
+	}
 
+      cdr_run_t* run = vm_alloc(sizeof(cdr_run_t), n + 1, 8);
+
+      run->type  = LIST;
+      run->cmeta = n;
+      memcpy(run->cells, args + start, n * sizeof(val_t));
+      run->cells[n] = out;
+
+      out = (val_t)run | CDR_CODED | LIST;
+      end = start;
+    }
+
+  gc_scope_close(s);
   return out;
-  }
+}
+
+/*
+   the same from the top n stack slots (the first pushed is the car), ending in tl instead of
+   nil, and popping them. Each value stays on the stack until its run has been allocated, so
+   callers can build a list of any length without holding its elements in C locals.
+ */
+val_t mk_stack_list(size_t n, val_t tl)
+{
+  gc_scope_t s = gc_scope_open();
+  gc_preserve(tl);
+
+  for (size_t end = n; end;)
+    {
+      size_t k = min(end, (size_t)CDR_RUN_MAX);
+
+      if (k == 1)
+	{
+	  tl = (val_t)mk_pair(*stack_ref(SP),tl);
+	  pop();
+	  break;
+	}
+
+      cdr_run_t* run = vm_alloc(sizeof(cdr_run_t), k + 1, 8);
+
+      run->type  = LIST;
+      run->cmeta = k;
+      run->cells[k] = tl;
+
+      for (size_t i = k; i--;)
+	run->cells[i] = pop();
+
+      tl  = (val_t)run | CDR_CODED | LIST;
+      end -= k;
+    }
+
+  gc_scope_close(s);
+  return tl;
 }
 
 inline val_t rsp_cons(val_t args, size_t argc)
@@ -44,36 +107,124 @@ inline val_t rsp_cons(val_t args, size_t argc)
   return (val_t)mk_pair(stk[0],stk[1]);
 }
 
+// the slot holding the car of a cell
+inline val_t* car_loc(val_t c)
+{
+  return cdr_coded(c) ? &cdr_cell(c) : &car_(c);
+}
+
+// copy the cells from c to the end of its run into ordinary pairs
+static val_t cdr_unpack(val_t c)
+{
+  size_t n = cdr_run(c)->cmeta - cdr_index(c);
+  pair_t* out = vm_allocc(n);
+
+  for (size_t i = 0; i < n; i++, c = cdr_succ(c))
+    {
+      out[i].car = cdr_cell(c);
+      out[i].cdr = i + 1 < n ? (val_t)&out[i+1] : cdr_tail(c);
+    }
+
+  return (val_t)out;
+}
+
+/*
+   the slot holding the cdr of the cell in *loc. A cell inside a cdr-coded run has no cdr of its
+   own, so the rest of its run is first copied out into ordinary pairs and *loc pointed at the
+   copy (other references into the run keep the original cells). loc may be inside a heap object,
+   so nothing is collected while the copy is made.
+ */
+val_t* cdr_loc(val_t* loc)
+{
+  val_t c = *loc;
+
+  if (!cdr_coded(c))
+    return &cdr_(c);
+
+  if (cdr_last(c))
+    return &cdr_tail(c);
+
+  gc_defer();
+  c = cdr_unpack(c);
+  gc_allow();
+
+  wbarrier(*loc,c);
+  return &cdr_(c);
+}
+
+// unchecked car and cdr for code that already knows it has a cell
+static inline val_t cell_car(val_t c)
+{
+  return *car_loc(c);
+}
+
+static inline val_t cell_cdr(val_t c)
+{
+  if (!cdr_coded(c))
+    return cdr_(c);
+
+  return cdr_last(c) ? cdr_tail(c) : cdr_succ(c);
+}
+
+static inline bool iscell(val_t v)
+{
+  return v != R_NIL && (ispair(v) || islist(v));
+}
+
 inline val_t car(val_t ca)
 {
+  if (islist(ca))
+    {
+      assert(ca != R_NIL,TYPE_ERR);
+      return cell_car(update_fptr(ca));
+    }
+
   return topair(ca)->car;
 }
 
 inline val_t cdr(val_t cd)
 {
+  if (islist(cd))
+    {
+      assert(cd != R_NIL,TYPE_ERR);
+      return cell_cdr(update_fptr(cd));
+    }
+
   return topair(cd)->cdr;
 }
 
 /* gc functions */
+size_t pair_sizeof(type_t* to, val_t v)
+{
+  if (cdr_coded(v))
+    return sizeof(cdr_run_t) + (cdr_run(v)->cmeta + 1) * sizeof(val_t);
+
+  return to->tp_base_sz;
+}
+
 val_t relocate_pair(type_t* to, val_t v, uchr_t** tos)
 {
   uchr_t* frm = ptr(uchr_t*,v);
+  size_t osz = pair_sizeof(to,v);
+
+  memcpy(*tos,frm,osz);
 
-  memcpy(*tos,frm,16);
+  val_t new = (val_t)(*tos) | (v & (LTAG_MASK | REF_BITS));
+  *tos += calc_mem_size(osz);
 
-  pair_t* new = (pair_t*)(*tos);
-  *tos += 16;
+  size_t cnt;
+  val_t* fields = gc_fields(to,new,&cnt);
 
-  head(new) = gc_trace(head(new));
-  tail(new) = gc_trace(tail(new));
+  for (size_t i = 0; i < cnt; i++)
+    fields[i] = gc_trace(fields[i]);
 
-  return tag((val_t)new, to);
+  return new;
 }
 
 
 hash_t hash_pair(val_t v, uint32_t r)
 {
-  val_t ca = ptr(pair_t*,v)->car, cd = ptr(pair_t*,v)->cdr;
+  val_t ca = cell_car(v), cd = cell_cdr(v);
   hash_t hashes[2];
   hashes[0] = val_hash(ca);
   hashes[1] = val_hash(cd);
@@ -83,87 +234,100 @@ hash_t hash_pair(val_t v, uint32_t r)
 
 size_t pair_elcnt(val_t p)
 {
-  pair_t* px = topair(p);
   size_t out = 0;
 
-  for (;px;px=(pair_t*)cdr_(px))
+  while (p)
     {
-      assert(ispair(p),TYPE_ERR);
-      out++;
+      assert(ispair(p) || islist(p),TYPE_ERR);
+      update_fptr(p);
+
+      // the rest of a run at once
+      if (cdr_coded(p))
+	{
+	  out += cdr_run(p)->cmeta - cdr_index(p);
+	  p    = cdr_tail(p);
+	}
+
+      else
+	{
+	  out++;
+	  p = cdr_(p);
+	}
     }
 
   return out;
 }
 
-val_t pair_assocn(pair_t* p, int32_t i)
+val_t pair_assocn(val_t p, int32_t i)
 {
-  while (i--)
-    {
-      assert(p, BOUNDS_ERR);
-      assert(ispair(tail(p)),TYPE_ERR);
-      p = (pair_t*)tail(p);
-    }
+  for (; i--; p = cell_cdr(p))
+    assert(iscell(p),BOUNDS_ERR);
 
-  return head(p);
+  assert(iscell(p),BOUNDS_ERR);
+  return cell_car(p);
 }
 
-int32_t pair_assocv(pair_t* p, val_t v)
+int32_t pair_assocv(val_t p, val_t v)
 {
-  size_t idx = 0;
-  while (1)
+  for (int32_t idx = 0; p; idx++, p = cell_cdr(p))
     {
-      if (!p)
-	return -1;
+      assert(iscell(p),TYPE_ERR);
 
-      if (head(p) == v)
+      if (cell_car(p) == v)
 	return idx;
-
-      assert(ispair(tail(p)),TYPE_ERR);
-      p = (pair_t*)tail(p);
     }
-}
 
+  return -1;
+}
 
-pair_t* pair_rplcn(pair_t* p, int32_t i, val_t x)
+val_t pair_rplcn(val_t p, int32_t i, val_t x)
 {
-  
-  while (i--)
-    {
-      assert(p,BOUNDS_ERR);
-      assert(ispair(tail(p)),TYPE_ERR);
-      p = (pair_t*)tail(p);
-    }
+  for (; i--; p = cell_cdr(p))
+    assert(iscell(p),BOUNDS_ERR);
 
-  head(p) = x;
+  assert(iscell(p),BOUNDS_ERR);
+  wbarrier(*car_loc(p),x);
   return p;
 }
 
-pair_t* pair_append(pair_t** ls, val_t v)
+/*
+   the new cell goes in the cdr of the last one. That cell is an ordinary pair or the end of a run,
+   so its cdr has a slot of its own and the runs before it are left whole.
+ */
+val_t pair_append(val_t* ls, val_t v)
 {
-    pair_t* new = mk_pair(v,R_NIL);
+  val_t new = (val_t)mk_pair(v,R_NIL);
 
-    while (*ls)
-      ls = (pair_t**)(&tail(*ls));
+  if (!*ls)
+    {
+      wbarrier(*ls,new);
+      return new;
+    }
 
-    *ls = new;
+  val_t last = *ls;
 
-    return *ls;
+  for (; cell_cdr(last); last = cell_cdr(last))
+    assert(iscell(last),TYPE_ERR);
+
+  wbarrier(*cdr_loc(&last),new);
+  return new;
 }
 
 val_t pop_list(size_t n, val_t* loc)
 {
-  list_t* ls = tolist(*loc);
+  assert(islist(*loc),TYPE_ERR);
+  val_t ls = update_fptr(*loc);
 
   while (n--)
-    ls = tail(ls);
+    ls = cell_cdr(ls);
 
-  *loc = tag(ls,LIST);
-  return head(ls);
+  *loc = ls;
+  return cell_car(ls);
 }
 
 inline bool last_expression(val_t x)
 {
-  return tolist(x)->cdr == NULL;
+  return cell_cdr(update_fptr(x)) == R_NIL;
 }
 
 /* printing */
@@ -173,14 +337,14 @@ void prn_pair(val_t p, riostrm_t* f) {
    if (p)
      for (;;)
        {
-	 val_t pc = cdr_(p);
-	 val_prn(car_(p),f);
+	 val_t pc = cell_cdr(p);
+	 val_prn(cell_car(p),f);
 
 	 if (!pc)
 	   break;
 
 	 fputwc(' ', f);
-	 if (!ispair(pc))
+	 if (!(ispair(pc) || islist(pc)))
 	   {
 	     fputs(". ", f);
 	     val_prn(pc,f);
@@ -195,11 +359,17 @@ void prn_pair(val_t p, riostrm_t* f) {
 }
 
 
-cfunc_api_t PAIR_API =
+static uint8_t pair_isalloc(type_t* to, val_t v)
+{
+  (void)to;
+  return v != R_NIL;
+}
+
+capi_t PAIR_API =
   {
     .prn             = prn_pair,
     .call            = NULL,
-    .size            = fobj_sizeof,
+    .size            = pair_sizeof,
     .elcnt           = pair_elcnt,
     .hash            = hash_pair,
     .ord             = NULL,
@@ -207,7 +377,7 @@ cfunc_api_t PAIR_API =
     .builtin_new     = rsp_cons,
     .init            = NULL,
     .relocate        = relocate_pair,
-    .isalloc         = NULL,
+    .isalloc         = pair_isalloc,
   };
 
 const type_t PAIR_TYPE_OBJ =
@@ -216,6 +386,7 @@ const type_t PAIR_TYPE_OBJ =
     .cmeta              = OBJECT,
     .tp_tpkey           = PAIR,
     .tp_ltag            = PAIR,
+    .tp_isalloc         = true,
     .tp_sizing          = FIXED,
     .tp_init_sz         = 0,
     .tp_base_sz         = 16,
@@ -224,3 +395,19 @@ const type_t PAIR_TYPE_OBJ =
     .tp_capi            = &PAIR_API,
     .name = "pair",
 };
+
+const type_t LIST_TYPE_OBJ =
+  {
+    .type               = DATATYPE,
+    .cmeta              = OBJECT,
+    .tp_tpkey           = LIST,
+    .tp_ltag            = LIST,
+    .tp_isalloc         = true,
+    .tp_sizing          = FIXED,
+    .tp_init_sz         = 0,
+    .tp_base_sz         = 16,
+    .tp_nfields         = 2,
+    .tp_cvtable         = NULL,
+    .tp_capi            = &PAIR_API,
+    .name = "list",
+};
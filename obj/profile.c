@@ -0,0 +1,447 @@
+#include "../include/mem.h"
+
+/*
+   allocation profiling.
+
+   When PROF_INTERVAL is nonzero vm_alloc takes a sample roughly every PROF_INTERVAL bytes,
+   charging the bytes since the previous sample to the allocating site: the type of the new
+   object plus the stack of functions pushed with prof_enter. The header of a new object is
+   written by its constructor after vm_alloc returns, so a sample's type is read when the next
+   sample is taken (or before the next collection moves it).
+
+   The evaluator enters a frame with prof_call after saving the continuation of an application,
+   and the frame remembers how deep the dump was. Once that continuation has been restored the
+   dump is shallower and the frame is dropped, whichever way the application returned; the next
+   call made at the same depth is a sibling and replaces it. C callers that don't use the dump
+   pair prof_enter with prof_leave.
+
+   A heap census walks everything reachable from the roots after gc_run and totals the live
+   bytes and objects for each type key.
+
+   prof_report prints a flat summary; prof_collapsed writes one "frame;frame;type bytes" line
+   per site, the format flamegraph tools expect.
+ */
+
+#define PROF_MAX_DEPTH  64
+#define PROF_NBUCKETS   1024u
+#define PROF_OTHER      (GC_STAT_NKEYS - 1u)   // bucket for type keys past the table
+
+size_t  PROF_INTERVAL  = 0;
+int64_t PROF_COUNTDOWN = 0;
+bool    PROF_CENSUS    = false;
+
+typedef struct prof_name_t
+{
+  struct prof_name_t* next;
+  chr_t               name[];
+} prof_name_t;
+
+typedef struct prof_site_t
+{
+  struct prof_site_t* next;
+  hash_t              hash;
+  tpkey_t             type;
+  size_t              depth;
+  size_t              samples;
+  size_t              bytes;     // estimated bytes allocated here
+  const chr_t*        frames[];  // outermost first
+} prof_site_t;
+
+static prof_name_t* NAMES[PROF_NBUCKETS];
+static prof_site_t* SITES[PROF_NBUCKETS];
+static size_t       NSITES = 0;
+
+// the function stack (names are interned, so frames compare by address)
+static const chr_t* FRAMES[PROF_MAX_DEPTH];
+static val_t        FRAMEDP[PROF_MAX_DEPTH];   // DP when each frame was called (0 for prof_enter)
+static size_t       DEPTH = 0;
+
+// the most recent sample, waiting for its object to be initialized
+static struct
+{
+  void*        obj;
+  size_t       weight;
+  tpkey_t      type;
+  bool         headed;
+  bool         typed;      // type was supplied by the allocator
+  size_t       depth;
+  const chr_t* frames[PROF_MAX_DEPTH];
+} PENDING = { 0 };
+
+// the most recent census
+static uint64_t CENSUS_CYCLE = 0;
+static size_t   CENSUS_COUNT[GC_STAT_NKEYS];
+static size_t   CENSUS_BYTES[GC_STAT_NKEYS];
+
+static hash_t prof_strhash(const chr_t* s)
+{
+  hash_t h = 2166136261u;
+
+  for (; *s; s++)
+    h = (h ^ (uchr_t)*s) * 16777619u;
+
+  return h;
+}
+
+static const chr_t* prof_intern(const chr_t* name)
+{
+  hash_t h = prof_strhash(name) % PROF_NBUCKETS;
+
+  for (prof_name_t* n = NAMES[h]; n; n = n->next)
+    if (!strcmp(n->name,name))
+      return n->name;
+
+  prof_name_t* n = vm_cmalloc(sizeof(prof_name_t) + strlen(name) + 1);
+  strcpy(n->name,name);
+  n->next  = NAMES[h];
+  NAMES[h] = n;
+  return n->name;
+}
+
+/*
+   drop the frames of applications called at dp or deeper: either their continuations are off
+   the dump (dp is DP + 1), or a call is starting at dp, which can't be nested in one made at the
+   same depth (dp is DP). Frames past PROF_MAX_DEPTH aren't recorded, but they're deeper than the
+   last recorded one, so they've returned if it has.
+ */
+static void prof_returned(val_t dp)
+{
+  for (;;)
+    {
+      size_t top = min(DEPTH,(size_t)PROF_MAX_DEPTH);
+
+      if (!top || !FRAMEDP[top-1] || FRAMEDP[top-1] < dp)
+	return;
+
+      DEPTH = top - 1;
+    }
+}
+
+static void prof_push(const chr_t* name, val_t dp)
+{
+  if (DEPTH < PROF_MAX_DEPTH)
+    {
+      FRAMES[DEPTH]  = prof_intern(name);
+      FRAMEDP[DEPTH] = dp;
+    }
+
+  DEPTH++;
+  return;
+}
+
+void prof_enter(const chr_t* name)
+{
+  if (!PROF_INTERVAL)
+    return;
+
+  prof_returned(DP + 1);
+  prof_push(name,0);
+  return;
+}
+
+// an application whose continuation is on the dump
+void prof_call(const chr_t* name)
+{
+  if (!PROF_INTERVAL)
+    return;
+
+  prof_returned(DP);
+  prof_push(name,DP);
+  return;
+}
+
+void prof_leave(void)
+{
+  prof_returned(DP + 1);
+
+  if (PROF_INTERVAL && DEPTH)
+    DEPTH--;
+
+  return;
+}
+
+size_t prof_depth(void)
+{
+  prof_returned(DP + 1);
+  return DEPTH;
+}
+
+// drop the frames pushed since the function stack was depth deep
+void prof_unwind(size_t depth)
+{
+  if (DEPTH > depth)
+    DEPTH = depth;
+
+  return;
+}
+
+static const chr_t* prof_typename(tpkey_t tk)
+{
+  static chr_t buf[32];
+
+  if (tk < PROF_OTHER && GLOBAL_TYPES[tk])
+    return GLOBAL_TYPES[tk]->name;
+
+  snprintf(buf,sizeof(buf),tk == PROF_OTHER ? "other" : "type-%u",tk);
+  return buf;
+}
+
+static prof_site_t* prof_site(tpkey_t type, const chr_t** frames, size_t depth)
+{
+  hash_t h = type * 2654435761u;
+
+  for (size_t i = 0; i < depth; i++)
+    h = (h ^ (hash_t)(uptr_t)frames[i]) * 16777619u;
+
+  for (prof_site_t* s = SITES[h % PROF_NBUCKETS]; s; s = s->next)
+    if (s->hash == h && s->type == type && s->depth == depth
+	&& !memcmp(s->frames, frames, depth * sizeof(chr_t*)))
+      return s;
+
+  prof_site_t* s = vm_cmalloc(sizeof(prof_site_t) + depth * sizeof(chr_t*));
+  s->hash  = h;
+  s->type  = type;
+  s->depth = depth;
+  memcpy(s->frames, frames, depth * sizeof(chr_t*));
+
+  s->next                  = SITES[h % PROF_NBUCKETS];
+  SITES[h % PROF_NBUCKETS] = s;
+  NSITES++;
+  return s;
+}
+
+// charge the pending sample now that its object has a header
+void prof_resolve(void)
+{
+  if (!PENDING.obj)
+    return;
+
+  tpkey_t tk = PENDING.typed ? PENDING.type : PENDING.headed ? *(uint32_t*)PENDING.obj : LIST;
+  prof_site_t* s = prof_site(min(tk,PROF_OTHER), PENDING.frames, PENDING.depth);
+
+  s->samples++;
+  s->bytes   += PENDING.weight;
+  PENDING.obj = NULL;
+  return;
+}
+
+void prof_sample(void* obj, size_t nbytes, bool headed)
+{
+  size_t weight = 0;
+  (void)nbytes;
+
+  while (PROF_COUNTDOWN <= 0)
+    {
+      PROF_COUNTDOWN += PROF_INTERVAL;
+      weight         += PROF_INTERVAL;
+    }
+
+  prof_resolve();
+  prof_returned(DP + 1);
+  PENDING.obj    = obj;
+  PENDING.weight = weight;
+  PENDING.headed = headed;
+  PENDING.typed  = false;
+  PENDING.depth  = min(DEPTH,(size_t)PROF_MAX_DEPTH);
+  memcpy(PENDING.frames, FRAMES, PENDING.depth * sizeof(chr_t*));
+  return;
+}
+
+// for allocations whose header is copied from another object (vm_realloc)
+void prof_settype(void* obj, tpkey_t tk)
+{
+  if (PENDING.obj == obj)
+    {
+      PENDING.type  = tk;
+      PENDING.typed = true;
+    }
+
+  return;
+}
+
+/* census */
+static uptr_t* SEEN    = NULL;
+static size_t  SEENCAP = 0, SEENCNT = 0;
+static val_t*  WORK    = NULL;
+static size_t  WORKCAP = 0, WORKCNT = 0;
+
+static bool census_visit(uptr_t a)
+{
+  if (SEENCNT * 2 >= SEENCAP)
+    {
+      uptr_t* old = SEEN;
+      size_t  oldcap = SEENCAP;
+      SEENCAP = SEENCAP ? SEENCAP * 2 : 4096;
+      SEEN    = vm_cmalloc(SEENCAP * sizeof(uptr_t));
+      SEENCNT = 0;
+
+      for (size_t i = 0; i < oldcap; i++)
+	if (old[i])
+	  census_visit(old[i]);
+
+      vm_cfree(old);
+    }
+
+  size_t i = (a >> 4) * 0x9e3779b97f4a7c15ul & (SEENCAP - 1);
+
+  for (; SEEN[i]; i = (i + 1) & (SEENCAP - 1))
+    if (SEEN[i] == a)
+      return false;
+
+  SEEN[i] = a;
+  SEENCNT++;
+  return true;
+}
+
+static void census_push(val_t v)
+{
+  if (!gc_isheapref(v))
+    return;
+
+  while (isfptr(car_(v)))
+    v = fwd_(v);
+
+  if (!census_visit(addr(v)))
+    return;
+
+  if (WORKCNT == WORKCAP)
+    {
+      WORKCAP = WORKCAP ? WORKCAP * 2 : 1024;
+      WORK    = vm_crealloc(WORK, WORKCAP * sizeof(val_t), false);
+    }
+
+  WORK[WORKCNT++] = v;
+  return;
+}
+
+void prof_census(void)
+{
+  memset(CENSUS_COUNT,0,sizeof(CENSUS_COUNT));
+  memset(CENSUS_BYTES,0,sizeof(CENSUS_BYTES));
+
+  if (SEEN)
+    memset(SEEN,0,SEENCAP * sizeof(uptr_t));
+
+  SEENCNT = WORKCNT = 0;
+  size_t nroots = gc_nroots();
+
+  for (size_t i = 0; i < nroots; i++)
+    census_push(*gc_root(i));
+
+  while (WORKCNT)
+    {
+      val_t v = WORK[--WORKCNT];
+      type_t* to = val_type(v);
+      tpkey_t tk = min(to->tp_tpkey,PROF_OTHER);
+      size_t cnt;
+      val_t* fields = gc_fields(to,v,&cnt);
+
+      CENSUS_COUNT[tk]++;
+      CENSUS_BYTES[tk] += val_asizeof(v,to);
+
+      for (size_t i = 0; i < cnt; i++)
+	census_push(fields[i]);
+    }
+
+  CENSUS_CYCLE = GC_STATS.cycle;
+  return;
+}
+
+/* output */
+static int prof_cmp(const void* x, const void* y)
+{
+  size_t a = (*(prof_site_t**)x)->bytes, b = (*(prof_site_t**)y)->bytes;
+  return a < b ? 1 : a > b ? -1 : 0;
+}
+
+// every site, largest first
+static prof_site_t** prof_sorted(void)
+{
+  prof_site_t** out = vm_cmalloc((NSITES + 1) * sizeof(prof_site_t*));
+  size_t n = 0;
+
+  for (size_t b = 0; b < PROF_NBUCKETS; b++)
+    for (prof_site_t* s = SITES[b]; s; s = s->next)
+      out[n++] = s;
+
+  qsort(out, n, sizeof(prof_site_t*), prof_cmp);
+  return out;
+}
+
+void prof_report(FILE* f)
+{
+  prof_resolve();
+  prof_site_t** sites = prof_sorted();
+  size_t bytes[GC_STAT_NKEYS] = { 0 }, samples[GC_STAT_NKEYS] = { 0 }, total = 0;
+
+  for (size_t i = 0; i < NSITES; i++)
+    {
+      bytes[sites[i]->type]   += sites[i]->bytes;
+      samples[sites[i]->type] += sites[i]->samples;
+      total                   += sites[i]->bytes;
+    }
+
+  total = max(total,1ul); // for the percentages
+
+  // with only --heap-census on there are no samples to report
+  if (PROF_INTERVAL)
+    {
+      fprintf(f,"allocation profile (one sample every %zu bytes)\n",PROF_INTERVAL);
+      fprintf(f,"%14s %7s %9s  %s\n","bytes","%","samples","type");
+
+      for (size_t k = 0; k < GC_STAT_NKEYS; k++)
+	if (samples[k])
+	  fprintf(f,"%14zu %6.2f%% %9zu  %s\n",bytes[k],100.0 * bytes[k] / total,samples[k],prof_typename(k));
+
+      fprintf(f,"\n%14s %7s %9s  %-16s %s\n","bytes","%","samples","type","site");
+
+      for (size_t i = 0; i < NSITES; i++)
+	{
+	  prof_site_t* s = sites[i];
+	  fprintf(f,"%14zu %6.2f%% %9zu  %-16s %s\n",s->bytes,100.0 * s->bytes / total,s->samples,
+		  prof_typename(s->type),s->depth ? s->frames[s->depth-1] : "<toplevel>");
+	}
+    }
+
+  if (CENSUS_CYCLE)
+    {
+      fprintf(f,"%sheap census after collection #%lu\n",PROF_INTERVAL ? "\n" : "",CENSUS_CYCLE);
+      fprintf(f,"%14s %10s  %s\n","bytes","objects","type");
+
+      for (size_t k = 0; k < GC_STAT_NKEYS; k++)
+	if (CENSUS_COUNT[k])
+	  fprintf(f,"%14zu %10zu  %s\n",CENSUS_BYTES[k],CENSUS_COUNT[k],prof_typename(k));
+    }
+
+  vm_cfree(sites);
+  return;
+}
+
+void prof_collapsed(FILE* f)
+{
+  prof_resolve();
+  prof_site_t** sites = prof_sorted();
+
+  for (size_t i = 0; i < NSITES; i++)
+    {
+      prof_site_t* s = sites[i];
+
+      if (!s->depth)
+	fputs("<toplevel>;",f);
+
+      for (size_t d = 0; d < s->depth; d++)
+	fprintf(f,"%s;",s->frames[d]);
+
+      fprintf(f,"%s %zu\n",prof_typename(s->type),s->bytes);
+    }
+
+  vm_cfree(sites);
+  return;
+}
+
+void prof_start(size_t interval)
+{
+  PROF_INTERVAL  = interval;
+  PROF_COUNTDOWN = interval;
+  return;
+}
@@ -1,13 +1,16 @@
 #include "../include/rstr.h"
 
 
-MK_TYPE_PREDICATE(CVALUE,STRING,str)
+MK_TYPE_PREDICATE(CVALUE,STRING,heapstr)
 MK_TYPE_PREDICATE(CVALUE,BYTES,bytes)
 MK_SAFECAST_P(bytes_t*,bytes,addr)
-MK_SAFECAST_P(rstr_t*,str,addr)
+MK_SAFECAST_P(rstr_t*,heapstr,addr)
 
+inline bool isstr(val_t v) { return issstr(v) || isheapstr(v); }
 
-rstr_t* mk_str(const chr_t* s)
+
+// a heap string whatever its length (for code that needs an rstr_t*; most code wants mk_str)
+rstr_t* mk_rstr(const chr_t* s)
 {
   size_t b = strsz(s);
   rstr_t* new;
@@ -21,9 +24,46 @@ rstr_t* mk_str(const chr_t* s)
   return new;
 }
 
+// a string value, allocated only if it's too long to be immediate
+val_t mk_str(const chr_t* s)
+{
+  if (strlen(s) > SSTR_MAX)
+    return (val_t)mk_rstr(s) | CVALUE;
+
+  return mk_strval(s);
+}
+
+// the immediate form of a string of at most SSTR_MAX bytes
+val_t mk_strval(const chr_t* s)
+{
+  size_t n = strlen(s);
+  assert(n <= SSTR_MAX,BOUNDS_ERR,"string too long to be immediate");
+
+  val_t out = SSTR_TAG;
+
+  for (size_t i = 0; i < n; i++)
+    out |= (val_t)(uchr_t)s[i] << (8 * i + 8);
+
+  return out;
+}
+
+// buf needs room for SSTR_MAX + 1 bytes
+const chr_t* rstr_chars(val_t s, chr_t* buf)
+{
+  if (!issstr(s))
+    return ptr(rstr_t*,s)->chars;
+
+  for (size_t i = 0; i <= SSTR_MAX; i++)
+    buf[i] = i < SSTR_MAX ? (chr_t)(s >> (8 * i + 8)) : '\0';
+
+  return buf;
+}
+
 bytes_t* mk_bstr(const uchr_t* b, size_t nb)
 {
+  gc_defer(); // b may point into the heap
   bytes_t* new = vm_allocb(16,nb);
+  gc_allow();
   new->type = BYTES;
   new->cmeta = INLINED;
   new->size = nb;
@@ -35,30 +75,35 @@ bytes_t* mk_bstr(const uchr_t* b, size_t nb)
 
 inline size_t rstr_elcnt(val_t x)
 {
-  return u8strlen(ptr(rstr_t*,x)->chars);
+  chr_t buf[SSTR_MAX+1];
+  return u8strlen(rstr_chars(x,buf));
 }
 
 
-rchr_t rstr_assocn(rstr_t* s, rint_t n)
+rchr_t rstr_assocn(val_t s, rint_t n)
 {
-  return nthu8(s->chars,n);
+  chr_t buf[SSTR_MAX+1];
+  return nthu8(rstr_chars(s,buf),n);
 }
 
 
-rint_t rstr_assocv(rstr_t* s, rchr_t c)
+rint_t rstr_assocv(val_t s, rchr_t c)
 {
-  chr_t* sc = s->chars;
-  chr32_t curr; size_t inc; size_t cnt = 0;
+  chr_t buf[SSTR_MAX+1];
+  const chr_t* sc = rstr_chars(s,buf);
+  chr32_t curr; int inc; size_t cnt = 0;
   chr32_t cc = (chr32_t)c;
 
   while (*sc)
     {
-      inc = incu8(&curr,sc);
+      if ((inc = incu8(&curr,sc)) == -1)
+	return -1;
+
       if (curr == cc)
 	  return cnt;
 
-      else
-	  sc += inc;
+      sc += inc;
+      cnt++;
     }
 
   return -1;
@@ -67,10 +112,13 @@ rint_t rstr_assocv(rstr_t* s, rchr_t c)
 
 int32_t rstr_ord(val_t sx, val_t sy)
 {
-  chr_t* sxch = ptr(rstr_t*,sx)->chars;
-  chr_t* sxcy = ptr(rstr_t*,sy)->chars;
+  // byte-swapped, two immediates order like their bytes (UTF-8 byte order is code point order)
+  if (issstr(sx) && issstr(sy))
+    return compare(__builtin_bswap64(sx),__builtin_bswap64(sy));
 
-  return u8strcmp(sxch,sxcy);
+  chr_t bx[SSTR_MAX+1], by[SSTR_MAX+1];
+
+  return u8strcmp(rstr_chars(sx,bx),rstr_chars(sy,by));
 }
 
 int32_t bstr_ord(val_t bx, val_t by)
@@ -97,10 +145,11 @@ int32_t bstr_ord(val_t bx, val_t by)
     return 0;
 }
 
+// by content, so an immediate hashes like a heap string with the same characters
 hash_t rstr_hash(val_t s, uint32_t sd)
 {
-  chr_t* sch = ptr(rstr_t*,s)->chars;
-  return hash_string(sch, sd);
+  chr_t buf[SSTR_MAX+1];
+  return hash_string(rstr_chars(s,buf), sd);
 }
 
 hash_t bytes_hash(val_t b, uint32_t s)
@@ -113,9 +162,9 @@ hash_t bytes_hash(val_t b, uint32_t s)
 
 void rstr_prn(val_t s, riostrm_t* f)
 {
-  rstr_t* sx = ptr(rstr_t*,s);
+  chr_t buf[SSTR_MAX+1];
   fputc('"',f);
-  fputs(sx->chars,f);
+  fputs(rstr_chars(s,buf),f);
   fputc('"',f);
   return;
 }
@@ -166,6 +215,12 @@ capi_t BYTES_CAPI =
   };
 
 
+static uint8_t rstr_isalloc(type_t* to, val_t s)
+{
+  (void)to;
+  return !issstr(s);
+}
+
 cvspec_t RSTR_CVSPEC =
   {
     .el_cnum = CNUM_UINT8,
@@ -185,7 +240,7 @@ capi_t RSTR_CAPI =
     .builtin_new = rstr_new,
     .init        = NULL,
     .relocate    = cv_relocate,
-    .isalloc     = NULL,
+    .isalloc     = rstr_isalloc,
   };
 
 type_t RSTR_TYPE_OBJ =
@@ -0,0 +1,234 @@
+#include <stdatomic.h>
+#include "../include/symtab.h"
+
+#define SYMTAB_NODE  0x01u      // tags a slot holding a subnode (symbols are at least word aligned)
+
+typedef struct
+{
+  _Atomic(uptr_t) slots[32];
+} symnode_t;
+
+static symnode_t         SYMTAB_ROOT;
+static _Atomic(size_t)   SYMTAB_COUNT;
+static _Atomic(uint64_t) GENSYM_COUNTER;
+
+static inline uint8_t symtab_slot(hash_t h, uint8_t l)
+{
+  return (h >> (5 * l)) & 0x1f;
+}
+
+static inline symnode_t* symtab_child(uptr_t s)
+{
+  return (symnode_t*)(s & ~(uptr_t)SYMTAB_NODE);
+}
+
+static symbol_t* sm_new(const chr_t* sn, hash_t h, uint32_t fl)
+{
+  size_t ssz = strlen(sn) + 1;
+  symbol_t* out = vm_cmalloc(sizeof(symbol_t) + (ssz > 8 ? ssz - 8 : 0));
+  out->flags = fl;
+  out->hash  = h;
+  out->next  = NULL;
+  memcpy(out->name,sn,ssz);
+  return out;
+}
+
+static inline bool sm_match(symbol_t* s, const chr_t* sn, hash_t h)
+{
+  return s->hash == h && !strcmp(s->name,sn);
+}
+
+static symbol_t* sm_chain_find(symbol_t* s, const chr_t* sn, hash_t h)
+{
+  for (; s; s = s->next)
+    if (sm_match(s,sn,h))
+      return s;
+
+  return NULL;
+}
+
+/* lookup */
+// the interned symbol named sn, or NULL (every step is one load, so this never waits on writers)
+symbol_t* symtab_lookup(const chr_t* sn)
+{
+  hash_t h = hash_string(sn,0);
+  symnode_t* nd = &SYMTAB_ROOT;
+
+  for (uint8_t l = 0; l < SYMTAB_DEPTH; l++)
+    {
+      uptr_t s = atomic_load_explicit(&nd->slots[symtab_slot(h,l)], memory_order_acquire);
+
+      if (s & SYMTAB_NODE)
+	{
+	  nd = symtab_child(s);
+	  continue;
+	}
+
+      if (l == SYMTAB_DEPTH - 1)
+	return sm_chain_find((symbol_t*)s,sn,h);
+
+      return s && sm_match((symbol_t*)s,sn,h) ? (symbol_t*)s : NULL;
+    }
+
+  return NULL;
+}
+
+/* interning */
+/*
+   a slot only ever goes from empty to a symbol, from a symbol to a subnode holding it, or (in the
+   last level) from a chain to a longer chain. A failed compare-and-swap means another thread got
+   there first, so the slot is read again; whatever was built for the failed attempt was never
+   seen by anyone else and is freed (or kept for the next try).
+ */
+symbol_t* symtab_intern(const chr_t* sn, uint32_t fl)
+{
+  hash_t h = hash_string(sn,0);
+  symnode_t* nd = &SYMTAB_ROOT;
+  symbol_t* new = NULL, *found = NULL;
+  uint8_t l = 0;
+
+  for (;;)
+    {
+      _Atomic(uptr_t)* slot = &nd->slots[symtab_slot(h,l)];
+      uptr_t s = atomic_load_explicit(slot, memory_order_acquire);
+
+      if (s & SYMTAB_NODE)
+	{
+	  nd = symtab_child(s);
+	  l++;
+	  continue;
+	}
+
+      if (l == SYMTAB_DEPTH - 1)
+	{
+	  if ((found = sm_chain_find((symbol_t*)s,sn,h)))
+	    break;
+
+	  new       = new ? : sm_new(sn,h,fl);
+	  new->next = (symbol_t*)s;
+
+	  if (atomic_compare_exchange_strong_explicit(slot,&s,(uptr_t)new,memory_order_release,memory_order_relaxed))
+	    break;
+
+	  continue;
+	}
+
+      if (!s)
+	{
+	  new = new ? : sm_new(sn,h,fl);
+
+	  if (atomic_compare_exchange_strong_explicit(slot,&s,(uptr_t)new,memory_order_release,memory_order_relaxed))
+	    break;
+
+	  continue;
+	}
+
+      if (sm_match((symbol_t*)s,sn,h))
+	{
+	  found = (symbol_t*)s;
+	  break;
+	}
+
+      // another symbol has this slot, so move it down a level and try again
+      symnode_t* sub = vm_cmalloc(sizeof(symnode_t));
+      atomic_init(&sub->slots[symtab_slot(((symbol_t*)s)->hash,l+1)],s);
+
+      if (!atomic_compare_exchange_strong_explicit(slot,&s,(uptr_t)sub | SYMTAB_NODE,memory_order_release,memory_order_relaxed))
+	vm_cfree(sub);
+    }
+
+  if (found)
+    {
+      if (new)
+	vm_cfree(new);
+
+      return found;
+    }
+
+  atomic_fetch_add_explicit(&SYMTAB_COUNT,1,memory_order_relaxed);
+  return new;
+}
+
+size_t symtab_count(void)
+{
+  return atomic_load_explicit(&SYMTAB_COUNT, memory_order_relaxed);
+}
+
+/* traversal */
+static void symtab_walk(symnode_t* nd, void (*f)(symbol_t*))
+{
+  for (size_t i = 0; i < 32; i++)
+    {
+      uptr_t s = atomic_load_explicit(&nd->slots[i], memory_order_acquire);
+
+      if (s & SYMTAB_NODE)
+	symtab_walk(symtab_child(s),f);
+
+      else
+	for (symbol_t* sm = (symbol_t*)s; sm; sm = sm->next)
+	  f(sm);
+    }
+
+  return;
+}
+
+// call f on every interned symbol (symbols interned while this runs may or may not be seen)
+void symtab_each(void (*f)(symbol_t*))
+{
+  symtab_walk(&SYMTAB_ROOT,f);
+  return;
+}
+
+/* constructors */
+// gensyms are numbered from a shared counter, so every thread gets distinct names
+symbol_t* mk_symbol(chr_t* sn, uint32_t fl)
+{
+  if (fl & SM_GENSYM)
+    {
+      uint64_t n = atomic_fetch_add_explicit(&GENSYM_COUNTER,1,memory_order_relaxed);
+      chr_t gs_buf[32+strlen(sn)];
+      sprintf(gs_buf,"__gs__%lu__%s",n,sn);
+
+      return fl & SM_INTERNED ? symtab_intern(gs_buf,fl) : sm_new(gs_buf,hash_string(gs_buf,0),fl);
+    }
+
+  return fl & SM_INTERNED ? symtab_intern(sn,fl) : sm_new(sn,hash_string(sn,0),fl);
+}
+
+/* the type object (symbols are compared by identity and hashed by name, so tables keyed on them
+   hash the same in every process) */
+static hash_t sm_hash(val_t v, uint32_t r)
+{
+  return hash_int(ptr(symbol_t*,v)->hash,r);
+}
+
+capi_t SYMBOL_CAPI =
+  {
+    .prn         = NULL,
+    .call        = NULL,
+    .size        = NULL,
+    .elcnt       = NULL,
+    .hash        = sm_hash,
+    .ord         = NULL,
+    .new         = NULL,
+    .builtin_new = NULL,
+    .init        = NULL,
+    .relocate    = NULL,
+    .isalloc     = NULL,
+  };
+
+type_t SYMBOL_TYPE_OBJ =
+  {
+    .type              = DATATYPE,
+    .cmeta             = SYMBOL,
+    .tp_tpkey          = SYMBOL,
+    .tp_ltag           = SYMBOL,
+    .tp_isalloc        = false,
+    .tp_sizing         = FIXED,
+    .tp_init_sz        = 0,
+    .tp_base_sz        = sizeof(symbol_t),
+    .tp_nfields        = 0,
+    .tp_cvtable        = NULL,
+    .tp_capi           = &SYMBOL_CAPI,
+    .name              = "symbol",
+  };
@@ -1,209 +1,237 @@
-#include "../include/rsp_core.h"
-#include "hamt.c"
+#include "../include/table.h"
+#include "../include/rvec.h"
+#include "../include/pairs.h"
 
-/* internal definitions */
+/*
+   tables are a header over a HAMT root (see hamt.c): the number of keys and the root node,
+   which is the only field the collector traces. Sets store keys alone, dicts store bindings
+   (the BINDINGS flag in cmeta). Updates copy the path to the changed entry and store the new
+   root back into the table.
 
-table_t* mk_table(size_t nk, tpkey_t tp)
-{
-  table_t* new; tuple_t* lvl_1; pair_t* ord_k;
-
-  lvl_1 = mk_tuple(32,0,TUPLE);
-  ord_k = mk_pair(R_NIL,R_NIL);
-  tb_levels(new) = 1;
-  tb_nkeys(new) = 0;
-  tb_mapping(new) = tag_p(lvl_0,OBJ);
-  tb_ordkeys(new) = tag_p(ord_k,OBJ);
-  tb_flags(new) = flags;
-  otag(new) = tp;
-
-  return new;
-}
+   This is also where the builtins that build or walk tables live (gc-stats, table-from,
+   reduce and each); builtin.c binds them by name.
+ */
 
-table_t* 
+MK_TYPE_PREDICATE(OBJECT,TABLE,table)
 
-list_t* tb_bindings(table_t* d)
-{
-  pair_t* d_ok = ptr(pair_t*,tb_ordkeys(d));
-  return ptr(list_t*,pcar(d_ok));
-}
+#define TB_HDR_SZ 16
 
-list_t* tb_bindings_tail(dict_t* d)
+// an empty table (nk is the expected number of keys, which the root node doesn't need yet)
+table_t* mk_table(size_t nk)
 {
-  pair_t* d_ok = ptr(pair_t*,tb_ordkeys(d));
-  return ptr(list_t*,pcar(d_ok));
+  (void)nk;
+  gc_scope_t s = gc_scope_open();
+  table_t* out = vm_allocw(TB_HDR_SZ,1);
+  out->type    = TABLE;
+  out->cmeta   = BINDINGS;
+  out->nkeys   = 0;
+  out->keys    = R_NIL;
+  gc_preserve_ptr(out,OBJECT);
+
+  val_t root = (val_t)mk_hamt_nd(HLVL_ONE,32,BINDINGS) | OBJECT;
+  wbarrier(out->keys,root);
+  gc_scope_close(s);
+  return out;
 }
 
-list_t* tb_addkey_seq(table_t* tb, val_t k)
+// bind k to v in t, returning v
+val_t tb_putkey(table_t* t, val_t k, val_t v)
 {
-  pair_t* bindings = ptr(pair_t*,tb_ordkeys(tb));
-  pair_t* new_b = mk_pair(k,R_NIL);
-  list_t* out;
-  
-  if (tb_nkeys(tb))
-    {
-      list_t* curr = ptr(list_t*,pcdr(bindings));
-      out = list_append(&curr,tag_p(new_b,OBJ));
-    }
+  if (!hamt_search(t->keys,k))
+    t->nkeys++;
 
-  else
-    {
-      out = (list_t*)mk_pair(tag_p(new_b,OBJ),R_NIL);
-      pcar(bindings) = tag_p(out,LIST);
-      pcdr(bindings) = tag_p(out,LIST);
-    }
-
-  tb_nkeys(tb)++;
-  return out;
+  hamt_put(&t->keys,k,v,t->cmeta,0,NULL);
+  return v;
 }
 
-list_t* tb_addkey(table_t* tb, val_t k)
+// the value bound to k, or R_UNBOUND
+val_t tb_getkey(table_t* t, val_t k)
 {
-  hash32_t h = rsp_hash(k);
-  tuple_t* dmp = ptr(tuple_t*,tb_mapping(tb));
-  val_t* new = tbnode_addkey(tb,&dmp,k,h);
+  val_t* e = hamt_search(t->keys,k);
 
-  if (new == NULL)
-    return NULL;
+  if (!e)
+    return R_UNBOUND;
 
-  else if (*new == R_NIL)
-    {
-      list_t* out = tb_addkey_seq(tb,k);
-      *new = tag_p(out,LIST);
-      tb_mapping(tb) = tag_p(dmp,OBJ);
-      return out;
-    }
-
-  else
-    return ptr(list_t*,*new);
+  return hamt_width(t->cmeta) == 2 ? e[1] : e[0];
 }
 
-list_t* tb_lookup(table_t* d, val_t v)
+// remove k from t, returning R_TRUE if it was there
+val_t tb_rmvkey(table_t* t, val_t k)
 {
-  tuple_t* dmp = ptr(tuple_t*,tb_mapping(d));
-  hash32_t h = rsp_hash(v);
-  uint32_t idx = h, loc_idx;
-  val_t* rslt;
-
-  while (dmp)
-    {
-      if (!idx) // if our hashkey runs out, we extend the hash using the current level of the
-	        // tree
-	idx = rehash(h,tbnd_level(dmp));
-
-      loc_idx = local_idx(h,tbnd_level(dmp));
-      rslt = tuple_ref(dmp,loc_idx);
+  if (!hamt_remove(&t->keys,k,t->cmeta,0))
+    return R_FALSE;
 
-      if (!rslt)
-	return NULL;
-
-      else if (islist(*rslt))
-	return ptr(list_t*,rslt);
-
-      else
-	dmp = ptr(tuple_t*,*rslt);
-    }
-
-  return NULL;
+  t->nkeys--;
+  return R_TRUE;
 }
 
-
-val_t copy_table(type_t* to, val_t v)
+static size_t tb_elcnt(val_t v)
 {
-  uchr_t* frm = ptr(uchr_t*,v); dict_t* old_d = ptr(table_t*,v);
-  dict_t* new_d = ptr(table_t*,FREE);
-  size_t dsz = to->tp_base_size;
-  memcpy(FREE,frm,dsz);
-  FREE += calc_mem_size(dsz);
-
-  tb_mapping(new_d) = gc_trace(tb_mapping(old_d));
-  tb_ordkeys(new_d) = gc_trace(tb_ordkeys(old_d));
-  return vm_tag(to,(val_t)new_d);
+  return ptr(table_t*,v)->nkeys;
 }
 
-void prn_table(val_t v, iostrm_t* f, const chr_t* dlm)
+static uint8_t tb_isalloc(type_t* to, val_t v)
 {
-  table_t* t = ptr(table_t*,v);
-  fputs(dlm,f);
-
-  pair_t* d_ok = ecall(topair,tb_ordkeys(t));
-  list_t* d_ok_start = ptr(list_t*,pcar(d_ok));
-
-  while (d_ok_start)
-    {
-      vm_print(pcar(d_ok_start),f);
-      d_ok_start = pcdr(d_ok_start);
-
-      if (d_ok_start)
-	fputwc(' ',f);
-    }
-
-  fputs("}",f);
+  (void)to; (void)v;
+  return true;
 }
 
-void prn_dict(val_t v, iostrm_t* f)
+capi_t TABLE_CAPI =
+  {
+    .prn         = NULL,
+    .call        = NULL,
+    .size        = NULL,
+    .elcnt       = tb_elcnt,
+    .hash        = NULL,
+    .ord         = NULL,
+    .new         = NULL,
+    .builtin_new = NULL,
+    .init        = NULL,
+    .relocate    = NULL,
+    .isalloc     = tb_isalloc,
+  };
+
+type_t TABLE_TYPE_OBJ =
+  {
+    .type              = DATATYPE,
+    .cmeta             = TABLE,
+    .tp_tpkey          = TABLE,
+    .tp_ltag           = OBJECT,
+    .tp_isalloc        = true,
+    .tp_sizing         = FIXED,
+    .tp_init_sz        = TB_HDR_SZ,
+    .tp_base_sz        = sizeof(table_t),
+    .tp_nfields        = 0,
+    .tp_cvtable        = NULL,
+    .tp_capi           = &TABLE_CAPI,
+    .name              = "table",
+  };
+
+/* gc telemetry */
+static void gcstat_put(table_t* t, chr_t* k, val_t v)
 {
-  prn_table(v,f,"#d{");
+  gc_scope_t s = gc_scope_open();
+  gc_preserve_ptr(t,OBJECT);
+  gc_preserve(v);
+
+  val_t key = (val_t)mk_symbol(k,SM_INTERNED) | SYMBOL;
+  tb_putkey(t,key,v);
+  gc_scope_close(s);
   return;
 }
 
-
-
-void prn_set(val_t v, iostrm_t* f)
+// a table describing the most recent collection (objects maps type names to copy counts)
+val_t rsp_gc_stats(void)
 {
-  prn_table(v,f,"#{");
-  return;
+  gc_scope_t s = gc_scope_open();
+  table_t* out = mk_table(16);
+  gc_preserve_ptr(out,OBJECT);
+  table_t* objs = mk_table(GC_STAT_NKEYS);
+  gc_preserve_ptr(objs,OBJECT);
+
+  gcstat_put(out,"cycle",mk_int(GC_STATS.cycle));
+  gcstat_put(out,"kind",(val_t)mk_symbol(GC_STATS.minor ? "minor" : "major",SM_INTERNED) | SYMBOL);
+  gcstat_put(out,"start",mk_float(GC_STATS.start));
+  gcstat_put(out,"pause",mk_float(GC_STATS.pause));
+  gcstat_put(out,"copied",mk_int(GC_STATS.copied));
+  gcstat_put(out,"used-before",mk_int(GC_STATS.used_before));
+  gcstat_put(out,"used-after",mk_int(GC_STATS.used_after));
+  gcstat_put(out,"heap-before",mk_int(GC_STATS.heap_before));
+  gcstat_put(out,"heap-after",mk_int(GC_STATS.heap_after));
+  gcstat_put(out,"grew",mk_bool(GC_STATS.grew));
+  gcstat_put(out,"total-pause",mk_float(GC_TOTAL_PAUSE));
+  gcstat_put(out,"total-copied",mk_int(GC_TOTAL_COPIED));
+
+  for (size_t k = 0; k < GC_STAT_NKEYS; k++)
+    if (GC_STATS.objects[k] && GLOBAL_TYPES[k])
+      gcstat_put(objs,GLOBAL_TYPES[k]->name,mk_int(GC_STATS.objects[k]));
+
+  gcstat_put(out,"objects",(val_t)objs | OBJECT);
+  gc_scope_close(s);
+  return (val_t)out | OBJECT;
 }
 
-atom_t* mk_atom(chr_t* sn, uint16_t fl)
+/* bulk table construction */
+// a table binding the car of each pair in an rvec or list to its cdr (later pairs win)
+val_t rsp_table_from(val_t src)
 {
-  static uint32_t GENSYM_COUNTER = 0;
-  size_t ssz = strsz(sn);
+  gc_defer();
+  size_t n = 0, nk;
+  val_t* elts = NULL;
 
-  if (fl & GENSYM)
+  if (hastype(src,RVECTOR))
     {
-      chr_t gs_buf[20+ssz];
-      sprintf(gs_buf,"__gs__%u__%s",GENSYM_COUNTER,sn);
-      GENSYM_COUNTER++;
-      hash32_t h = hash_string(gs_buf);
-      if (fl & INTERNED)
-	return intern_string(gs_buf,h,fl);
-
-      else
-	return new_atom(gs_buf,ssz,h,fl);
+      n    = ptr(rvec_t*,src)->elcnt;
+      elts = ptr(rvec_t*,src)->rv_elements;
     }
 
   else
-    {
-      hash32_t h = hash_string(sn);
+    for (val_t l = src; l != R_NIL; l = cdr(l))
+      n++;
 
-      if (fl & INTERNED)
-	return intern_string(sn,h,fl);
+  val_t* keys = vm_cmalloc(max(2 * n,1ul) * sizeof(val_t)), *vals = keys + n, l = src;
 
-      else
-	return new_atom(sn,ssz,h,fl);
+  for (size_t i = 0; i < n; i++)
+    {
+      val_t p = elts ? elts[i] : car(l);
+      assert(p != R_NIL && (ispair(p) || islist(p)),TYPE_ERR,"pair",val_typename(p));
+      keys[i] = car(p);
+      vals[i] = cdr(p);
+
+      if (!elts)
+	l = cdr(l);
     }
+
+  table_t* out = vm_allocw(TB_HDR_SZ,1);
+  out->type    = TABLE;
+  out->cmeta   = BINDINGS;
+  out->keys    = hamt_build(keys,vals,n,BINDINGS,&nk);
+  out->nkeys   = nk;
+
+  gc_allow();
+  vm_cfree(keys);
+  return (val_t)out | OBJECT;
 }
 
-atom_t* intern_string(chr_t* sn, hash32_t h, uint16_t fl)
+/* table traversal */
+// call f on every entry of a table (the key, then the value) or set (the key), followed by acc if given
+static val_t tb_walk(val_t* f, val_t* tb, val_t acc, bool fold)
 {
-  
-  set_t* st = ecall(toset,R_SYMTAB);
-  size_t nk = tb_nkeys(st);
-  size_t ssz = strsz(sn);
-  
-  atom_t* tmp = vm_cmalloc(8 + ssz);
-  atm_hash(tmp) = h;
-  strcpy(atm_name(tmp),sn);
-  atm_flags(tmp) = fl;
-  otag(tmp) = ATOM;
-  list_t* new = tb_addkey(st,tag_p(tmp,OBJ));
-
-  if (tb_nkeys(st) == nk)
+  assert(istable(*tb),TYPE_ERR,"table",val_typename(*tb));
+  gc_scope_t s = gc_scope_open();
+  table_t* t   = ptr(table_t*,*tb);
+  size_t w     = hamt_width(t->cmeta);
+  val_t args[3] = { R_NIL, R_NIL, R_NIL };
+  hamt_cursor_t c;
+
+  for (size_t i = 0; i < 3; i++)
+    gc_preserve(args[i]);
+
+  args[w] = acc;
+  hamt_cursor_init(&c,t->keys);
+  hamt_cursor_preserve(&c);
+
+  for (val_t* e; (e = hamt_cursor_next(&c));)
     {
-      vm_cfree(tmp);
-      return ptr(atom_t*,pcar(new));
+      memcpy(args,e,w * sizeof(val_t));
+      val_t r = rsp_apply(*f,args,w+fold);
+
+      if (fold)
+	args[w] = r;
     }
 
-  else
-    return tmp;
+  gc_scope_close(s);
+  return fold ? args[w] : R_NIL;
+}
+
+// (reduce f init tb) - (f key value acc) over the entries (or (f key acc) over a set), in hash order, starting from init
+val_t rsp_tb_reduce(val_t* a)
+{
+  return tb_walk(a,a+2,a[1],true);
+}
+
+// (each f tb) - (f key value) over the entries, in hash order
+val_t rsp_tb_each(val_t* a)
+{
+  return tb_walk(a,a+1,R_NIL,false);
 }
@@ -20,17 +20,136 @@ void repl() {
 }
 
 
+/* command line options */
+// sizes can have a k, m or g suffix; the result is in words
+static val_t rsp_getsize(const chr_t* s)
+{
+  chr_t* end;
+  double n = strtod(s,&end);
+
+  switch (*end)
+    {
+    case 'g': case 'G': n *= 1024; // fall through
+    case 'm': case 'M': n *= 1024; // fall through
+    case 'k': case 'K': n *= 1024;
+    default: break;
+    }
+
+  return max((val_t)n / 8, 1ul);
+}
+
+// allocation profile output (a flat report on stderr, collapsed stacks when a file is given)
+static const chr_t* PROF_OUT = NULL;
+
+static void rsp_prof_dump(void)
+{
+  if (!PROF_OUT)
+    {
+      prof_report(stderr);
+      return;
+    }
+
+  FILE* f = fopen(PROF_OUT,"w");
+
+  if (!f)
+    {
+      fprintf(stderr,"Couldn't open %s for the allocation profile.\n",PROF_OUT);
+      return;
+    }
+
+  prof_collapsed(f);
+  fclose(f);
+  return;
+}
+
+// heap image to start from, and one to write after the core is loaded
+static const chr_t* IMAGE_IN  = NULL;
+static const chr_t* IMAGE_OUT = NULL;
+
+static void rsp_getopts(int argc, char** argv)
+{
+  for (int i = 1; i < argc; i++)
+    {
+      if (!strncmp(argv[i],"--gc-threads=",13))
+	GC_NTHREADS = max(atoi(argv[i]+13),1);
+
+      else if (!strncmp(argv[i],"--heap-init=",12))
+	HEAPINIT = rsp_getsize(argv[i]+12);
+
+      else if (!strncmp(argv[i],"--heap-max=",11))
+	HEAPMAX = rsp_getsize(argv[i]+11);
+
+      else if (!strncmp(argv[i],"--gc-time=",10))
+	GC_TIME_TARGET = min(max(atof(argv[i]+10),0.001),0.9);
+
+      else if (!strncmp(argv[i],"--heap-policy=",14))
+	{
+	  if (!gc_set_policy(argv[i]+14))
+	    fprintf(stderr,"Unknown heap policy %s, using %s.\n",argv[i]+14,GC_POLICY->name);
+	}
+
+      else if (!strncmp(argv[i],"--gc=",5))
+	{
+	  if (!gc_set_collector(argv[i]+5))
+	    fprintf(stderr,"Unknown collector %s, using %s.\n",argv[i]+5,
+		    GC_COLLECTOR == GC_IMMIX ? "immix" : "semispace");
+	}
+
+      else if (!strncmp(argv[i],"--alloc-profile=",16))
+	prof_start(rsp_getsize(argv[i]+16) * 8);
+
+      else if (!strncmp(argv[i],"--alloc-profile-out=",20))
+	PROF_OUT = argv[i]+20;
+
+      else if (!strncmp(argv[i],"--image=",8))
+	IMAGE_IN = argv[i]+8;
+
+      else if (!strncmp(argv[i],"--save-image=",13))
+	IMAGE_OUT = argv[i]+13;
+
+      else if (!strcmp(argv[i],"--heap-census"))
+	PROF_CENSUS = true;
+
+      else if (!strcmp(argv[i],"--huge-pages"))
+	HEAP_HUGEPAGES = true;
+
+      else
+	fprintf(stderr,"Ignoring unknown option %s.\n",argv[i]);
+    }
+
+  if (PROF_INTERVAL || PROF_CENSUS)
+    atexit(rsp_prof_dump);
+
+  return;
+}
+
+
 int main(int argc, char** argv) {
+  rsp_getopts(argc,argv);
   R_STREAMS[0] = ((val_t)stdin) | LTAG_CFILE;
   R_STREAMS[1] = ((val_t)stdout) | LTAG_CFILE;
   R_STREAMS[2] = ((val_t)stderr) | LTAG_CFILE;
 
-  bootstrap_rascal();
-  fprintf(stdout, "Welcome to rascal2 v 0.0.1.0\n");
+  // an image already holds the interned names and everything system.rsp defines
+  if (IMAGE_IN && image_load(IMAGE_IN))
+    {
+      init_types();
+      init_registers();
+    }
 
-  // load the lisp core
-  port_t* r_system = vm_open("system.rsp", "r");
-  vm_load(r_system);
+  else
+    {
+      bootstrap_rascal();
+
+      // load the lisp core
+      port_t* r_system = vm_open("system.rsp", "r");
+      vm_load(r_system);
+    }
+
+  if (IMAGE_OUT)
+    return image_save(IMAGE_OUT) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+  fprintf(stdout, "Welcome to rascal2 v 0.0.1.0\n");
   repl();
   return 0;
 }
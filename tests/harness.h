@@ -0,0 +1,148 @@
+#ifndef harness_h
+#define harness_h
+
+/*
+   a unity build of the runtime core for the tests and the benchmarks.
+
+   globals.h defines its constants in every file that includes it, so the core can't be linked
+   from separately compiled objects; each driver includes the sources it needs instead. This file
+   supplies what rspmain.c and the object files that don't build yet would otherwise provide: the
+   heap and stack globals, the type table, and types for nil and the immediate values.
+ */
+#include "../lib/values.c"
+#include "../lib/capi.c"
+#include "../lib/hashing.c"
+#include "../lib/strlib.c"
+#include "../obj/mem.c"
+#include "../obj/gcpar.c"
+#include "../obj/gcpolicy.c"
+#include "../obj/immix.c"
+#include "../obj/los.c"
+#include "../obj/profile.c"
+#include "../obj/cval.c"
+#include "../obj/bignum.c"
+#include "../obj/nvec.c"
+#include "../obj/rstr.c"
+#include "../obj/bvec.c"
+#include "../obj/hamt.c"
+#include "../obj/table.c"
+#include "../obj/symtab.c"
+#include "../obj/image.c"
+#include "../obj/pairs.c"
+#include "../obj/direct.c"
+#include "../lib/arith.c"
+
+/* globals normally defined by the interpreter */
+uchr_t *RAM = NULL, *FREE = NULL, *EXTRA = NULL;
+val_t  HEAPSIZE = 0, STACKSIZE = 0, DUMPSIZE = 0, HEAPCRITICAL = 0;
+val_t  *STACK = NULL, *DUMP = NULL, DP = 0;
+val_t  R_GLOBAL_CONSTANTS[16];
+
+static type_t* HARNESS_TYPES[256];
+type_t** GLOBAL_TYPES = HARNESS_TYPES;
+
+/* declared in values.h but not defined anywhere yet */
+inline bool islist(val_t v) { return ltag(v) == LIST; }
+
+int32_t val_eql(val_t x, val_t y)
+{
+  if (x == y)
+    return true;
+
+  tpkey_t tk = tpkey(x);
+
+  if (tk != tpkey(y) || !GLOBAL_TYPES[tk] || !GLOBAL_TYPES[tk]->tp_capi->ord)
+    return false;
+
+  return GLOBAL_TYPES[tk]->tp_capi->ord(x,y) == 0;
+}
+
+// declared in obj.h and rstr.h but not written yet (only their addresses are taken)
+static val_t hn_missing(const chr_t* fname)
+{
+  fprintf(stderr,"%s is not implemented\n",fname);
+  abort();
+}
+
+val_t   fobj_new(type_t* t, val_t a, size_t n) { (void)t; (void)a; (void)n; return hn_missing(__func__); }
+val_t   rstr_new(val_t a, size_t n)            { (void)a; (void)n; return hn_missing(__func__); }
+val_t   bytes_new(val_t a, size_t n)           { (void)a; (void)n; return hn_missing(__func__); }
+int32_t bytes_ord(val_t x, val_t y)            { (void)x; (void)y; return hn_missing(__func__); }
+
+// nil and the immediate values without a type object of their own are never allocated
+static capi_t HN_DIRECT_CAPI = { .hash = hash_small };
+
+#define HN_DIRECT_TYPE(tk,lt,tnm)                 \
+  static type_t HN_##tk##_TYPE =                  \
+    {                                             \
+      .type       = DATATYPE,                     \
+      .tp_tpkey   = tk,                           \
+      .tp_ltag    = lt,                           \
+      .tp_isalloc = false,                        \
+      .tp_sizing  = FIXED,                        \
+      .tp_base_sz = 8,                            \
+      .tp_capi    = &HN_DIRECT_CAPI,              \
+      .name       = tnm,                          \
+    }
+
+HN_DIRECT_TYPE(NIL,LIST,"nil");
+HN_DIRECT_TYPE(INTEGER,DIRECT,"int");
+HN_DIRECT_TYPE(CHAR,DIRECT,"char");
+HN_DIRECT_TYPE(BOOL,DIRECT,"bool");
+
+// the type table and an empty heap and stack; the collector options have to be set before this
+static void hn_init(void)
+{
+  HARNESS_TYPES[NIL]          = &HN_NIL_TYPE;
+  HARNESS_TYPES[PAIR]         = (type_t*)&PAIR_TYPE_OBJ;
+  HARNESS_TYPES[SYMBOL]       = &SYMBOL_TYPE_OBJ;
+  HARNESS_TYPES[LIST]         = (type_t*)&LIST_TYPE_OBJ;
+  HARNESS_TYPES[INTEGER]      = &HN_INTEGER_TYPE;
+  HARNESS_TYPES[FLOAT]        = &FLOAT_TYPE_OBJ;
+  HARNESS_TYPES[CHAR]         = &HN_CHAR_TYPE;
+  HARNESS_TYPES[BOOL]         = &HN_BOOL_TYPE;
+  HARNESS_TYPES[STRING]       = &RSTR_TYPE_OBJ;
+  HARNESS_TYPES[BIGNUM]       = &BIGNUM_TYPE_OBJ;
+  HARNESS_TYPES[NVECTOR]      = &NVEC_TYPE_OBJ;
+  HARNESS_TYPES[BVECTOR]      = &BVEC_TYPE_OBJ;
+  HARNESS_TYPES[TABLE]        = &TABLE_TYPE_OBJ;
+
+  init_heap();
+  init_stack();
+
+  // the registers are roots
+  for (size_t i = 1; i <= SP; i++)
+    *stack_ref(i) = R_NIL;
+
+  return;
+}
+
+static inline double hn_clock(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* checks - a failed check is reported and counted, and the test returns hn_status() */
+static size_t HN_FAILED = 0;
+
+#define check(cond)                                                     \
+  do                                                                    \
+    {                                                                   \
+      if (!(cond))                                                      \
+	{                                                               \
+	  fprintf(stderr,"%s:%d: check failed: %s\n",__FILE__,__LINE__,#cond); \
+	  HN_FAILED++;                                                  \
+	}                                                               \
+    } while (0)
+
+static inline int hn_status(void)
+{
+  if (HN_FAILED)
+    fprintf(stderr,"%zu checks failed\n",HN_FAILED);
+
+  return HN_FAILED ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,168 @@
+#include "harness.h"
+
+/*
+   mixed-type arithmetic and comparison: every pair of scalar kinds (fixnum, bignum and float,
+   in either order) goes to the kernel for their common type, fixnum results that overflow
+   become bignums and bignum results that fit become fixnums again, and numeric vectors of
+   different element types are promoted to their common element type.
+ */
+
+#define E30 "1000000000000000000000000000000"
+
+static bool is_flt(val_t v, rflt_t f)
+{
+  return isfloat(v) && fval(v) == f;
+}
+
+static bool is_big(val_t v, const chr_t* s)
+{
+  return isbignum(v) && bn_ord(v,bn_parse(s)) == 0;
+}
+
+static void test_promotion(void)
+{
+  val_t big = bn_parse(E30), two = fixnum(2), half = mk_float(0.5);
+
+  // fixnum with fixnum, and the overflow into a bignum
+  check(bltn_add(two,fixnum(3)) == fixnum(5));
+  check(is_big(bltn_add(fixnum(FIXNUM_MAX),fixnum(1)),"288230376151711744"));
+  check(is_big(bltn_mul(fixnum(FIXNUM_MAX),fixnum(FIXNUM_MAX)),"83076749736557241480027188964098049"));
+  check(is_big(bltn_sub(fixnum(FIXNUM_MIN),fixnum(1)),"-288230376151711745"));
+
+  // fixnum with bignum, in either order
+  check(is_big(bltn_add(two,big),"1000000000000000000000000000002"));
+  check(is_big(bltn_sub(big,two),"999999999999999999999999999998"));
+  check(is_big(bltn_mul(two,big),"2" "000000000000000000000000000000"));
+  check(bltn_div(big,bn_parse("500000000000000000000000000000")) == two);
+  check(bltn_rem(big,fixnum(7)) == fixnum(1));
+  check(bltn_sub(bltn_add(big,two),big) == two);
+
+  // fixnum with float, in either order
+  check(is_flt(bltn_add(two,half),2.5));
+  check(is_flt(bltn_sub(half,two),-1.5));
+  check(is_flt(bltn_mul(two,half),1.0));
+  check(is_flt(bltn_div(two,mk_float(4.0)),0.5));
+  check(is_flt(bltn_rem(mk_float(5.5),two),1.5));
+
+  // bignum with float, in either order
+  rflt_t fbig = bn_fval(big);
+  check(is_flt(bltn_add(big,half),fbig + 0.5));
+  check(is_flt(bltn_mul(half,big),fbig * 0.5));
+  check(is_flt(bltn_div(big,mk_float(fbig)),1.0));
+
+  // float with float
+  check(is_flt(bltn_add(half,half),1.0));
+
+  // negation of each kind
+  check(bltn_neg(two) == fixnum(-2));
+  check(is_big(bltn_neg(fixnum(FIXNUM_MIN)),"288230376151711744"));
+  check(is_big(bltn_neg(big),"-" E30));
+  check(is_flt(bltn_neg(half),-0.5));
+
+  // anything else is a type error
+  check(bltn_add(two,R_NIL) == NIL);
+  check(bltn_lt(R_TRUE,half) == NIL);
+}
+
+static void test_comparison(void)
+{
+  val_t big = bn_parse(E30), nbig = bn_neg(bn_parse(E30)), two = fixnum(2), half = mk_float(0.5);
+
+  // fixnum with fixnum
+  check(bltn_lt(fixnum(-3),two) == R_TRUE);
+  check(bltn_ge(fixnum(-3),two) == R_FALSE);
+  check(bltn_eql(two,fixnum(2)) == R_TRUE);
+
+  // fixnum with bignum, in either order
+  check(bltn_lt(two,big) == R_TRUE);
+  check(bltn_gt(two,nbig) == R_TRUE);
+  check(bltn_le(big,two) == R_FALSE);
+  check(bltn_ge(big,two) == R_TRUE);
+  check(bltn_eql(two,big) == R_FALSE);
+  check(bltn_neql(big,two) == R_TRUE);
+
+  // bignum with bignum
+  check(bltn_lt(nbig,big) == R_TRUE);
+  check(bltn_eql(big,bn_parse(E30)) == R_TRUE);
+
+  // fixnum with float, in either order
+  check(bltn_lt(half,two) == R_TRUE);
+  check(bltn_gt(two,half) == R_TRUE);
+  check(bltn_eql(two,mk_float(2.0)) == R_TRUE);
+  check(bltn_neql(mk_float(2.0),two) == R_FALSE);
+
+  // bignum with float, in either order
+  check(bltn_gt(big,mk_float(1e29)) == R_TRUE);
+  check(bltn_lt(mk_float(1e31),big) == R_FALSE);
+  check(bltn_le(nbig,half) == R_TRUE);
+  check(bltn_eql(big,mk_float(bn_fval(big))) == R_TRUE);
+
+  // float with float
+  check(bltn_ge(half,mk_float(0.5)) == R_TRUE);
+}
+
+// a vector with element type code holding 0, 1, ..., n-1 scaled by k
+static val_t nv_iota(c_num_t code, size_t n, rint_t k)
+{
+  val_t v = (val_t)mk_nvec(code,n) | CVALUE;
+
+  for (size_t i = 0; i < n; i++)
+    nvec_rplcn(v,i,fixnum(k * (rint_t)i));
+
+  return v;
+}
+
+static void test_vectors(void)
+{
+  static const struct { c_num_t x, y, common; } pairs[] =
+    {
+      { CNUM_INT8,   CNUM_INT8,    CNUM_INT8    },
+      { CNUM_INT8,   CNUM_UINT8,   CNUM_INT16   },
+      { CNUM_UINT8,  CNUM_INT16,   CNUM_INT16   },
+      { CNUM_INT16,  CNUM_UINT32,  CNUM_INT64   },
+      { CNUM_INT32,  CNUM_UINT32,  CNUM_INT64   },
+      { CNUM_UINT16, CNUM_UINT32,  CNUM_UINT32  },
+      { CNUM_INT64,  CNUM_UINT64,  CNUM_FLOAT64 },
+      { CNUM_INT8,   CNUM_FLOAT32, CNUM_FLOAT32 },
+      { CNUM_INT32,  CNUM_FLOAT32, CNUM_FLOAT32 },
+      { CNUM_UINT64, CNUM_FLOAT32, CNUM_FLOAT64 },
+      { CNUM_FLOAT32, CNUM_FLOAT64, CNUM_FLOAT64 },
+    };
+
+  size_t n = 37;   // past a full vector register for every element width
+
+  for (size_t p = 0; p < sizeof(pairs) / sizeof(pairs[0]); p++)
+    {
+      // the element types in either order
+      for (size_t o = 0; o < 2; o++)
+	{
+	  c_num_t cx = o ? pairs[p].y : pairs[p].x, cy = o ? pairs[p].x : pairs[p].y;
+	  val_t x = nv_iota(cx,n,1), y = nv_iota(cy,n,2);
+
+	  val_t s = bltn_add(x,y), d = bltn_sub(y,x), lt = bltn_vlt(x,y), eq = bltn_veql(x,y);
+	  check(ptr(nvec_t*,s)->cmeta == pairs[p].common);
+	  check(ptr(nvec_t*,lt)->cmeta == CNUM_UINT8);
+
+	  for (size_t i = 0; i < n; i++)
+	    {
+	      check(bltn_eql(nvec_assocn(s,i),fixnum(3 * i)) == R_TRUE);
+	      check(bltn_eql(nvec_assocn(d,i),fixnum(i)) == R_TRUE);
+	      check(nvec_assocn(lt,i) == fixnum(i > 0));
+	      check(nvec_assocn(eq,i) == fixnum(i == 0));
+	    }
+	}
+    }
+}
+
+int main(void)
+{
+  // operands are held in C locals throughout
+  GC_AUTO = false;
+  hn_init();
+
+  test_promotion();
+  test_comparison();
+  test_vectors();
+
+  return hn_status();
+}
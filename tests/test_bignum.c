@@ -0,0 +1,169 @@
+#include "harness.h"
+
+/*
+   bignum arithmetic against known values: mixed fixnum/bignum operands in either order of
+   magnitude and sign, truncating division, and products big enough for Karatsuba (checked
+   against the schoolbook method and by dividing back).
+ */
+
+#define E59   "100000000000000000000000000000000000000000000000000000000000"
+#define N59   "99999999999999999999999999999999999999999999999999999999999"
+
+// an integer in decimal (fixnums print through printf, bignums through bn_prn)
+static const chr_t* num_str(val_t v)
+{
+  static chr_t*  buf = NULL;
+  static size_t  sz  = 0;
+
+  if (isfixnum(v))
+    {
+      buf = realloc(buf,32);
+      sprintf(buf,"%ld",(long)ival(v));
+      return buf;
+    }
+
+  FILE* f = open_memstream(&buf,&sz);
+  bn_prn(v,f);
+  fclose(f);
+  return buf;
+}
+
+static bool is_num(val_t v, const chr_t* s)
+{
+  return !strcmp(num_str(v),s);
+}
+
+static void test_parse(void)
+{
+  static const chr_t* cases[] =
+    {
+      "0", "42", "-42", "9223372036854775807", "-9223372036854775808", "18446744073709551616",
+      "340282366920938463463374607431768211456", "-" E59, E59,
+    };
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    check(is_num(bn_parse(cases[i]),cases[i]));
+
+  check(is_num(bn_parse("+123"),"123"));
+  check(bn_parse("288230376151711743") == fixnum(FIXNUM_MAX));
+  check(isbignum(bn_parse("1" "000000000000000000000")));
+  check(bn_parse("12a") == R_EOF);
+  check(bn_parse("") == R_EOF);
+}
+
+static void test_addsub(void)
+{
+  val_t big = bn_parse(E59), one = fixnum(1), mone = fixnum(-1);
+
+  // a fixnum on either side, smaller or larger in magnitude, with either sign
+  check(is_num(bn_add(one,big),"1" "00000000000000000000000000000000000000000000000000000000001"));
+  check(is_num(bn_add(big,one),"1" "00000000000000000000000000000000000000000000000000000000001"));
+  check(is_num(bn_add(mone,big),N59));
+  check(is_num(bn_add(big,mone),N59));
+  check(is_num(bn_sub(one,big),"-" N59));
+  check(is_num(bn_sub(big,one),N59));
+  check(is_num(bn_sub(mone,big),"-1" "00000000000000000000000000000000000000000000000000000000001"));
+  check(is_num(bn_add(bn_neg(big),mone),"-1" "00000000000000000000000000000000000000000000000000000000001"));
+
+  // results that fit are fixnums again
+  check(bn_sub(big,big) == fixnum(0));
+  check(bn_add(bn_add(big,one),bn_neg(big)) == fixnum(1));
+  check(isbignum(bn_add(fixnum(FIXNUM_MAX),one)));
+  check(is_num(bn_add(fixnum(FIXNUM_MAX),one),"288230376151711744"));
+  check(is_num(bn_add(fixnum(FIXNUM_MAX),fixnum(FIXNUM_MAX)),"576460752303423486"));
+
+  // a carry out of every limb
+  val_t ones = bn_parse("340282366920938463463374607431768211455");   // 2^128 - 1
+  check(is_num(bn_add(ones,one),"340282366920938463463374607431768211456"));
+  check(is_num(bn_add(one,ones),"340282366920938463463374607431768211456"));
+}
+
+static void test_mul(void)
+{
+  check(is_num(bn_mul(bn_parse("12345678901234567890123"),bn_parse("98765432109876543210")),
+	       "1219326311370217952249611949260778341714830"));
+  check(is_num(bn_mul(bn_parse("18446744073709551616"),bn_parse("-18446744073709551616")),
+	       "-340282366920938463463374607431768211456"));
+  check(is_num(bn_mul(fixnum(-3),bn_parse(E59)),"-3" "00000000000000000000000000000000000000000000000000000000000"));
+  check(bn_mul(fixnum(0),bn_parse(E59)) == fixnum(0));
+}
+
+static void test_divrem(void)
+{
+  val_t e40 = bn_parse("10000000000000000000000000000000000000000");
+
+  check(is_num(bn_div(e40,fixnum(7)),"1428571428571428571428571428571428571428"));
+  check(bn_rem(e40,fixnum(7)) == fixnum(4));
+  check(is_num(bn_div(bn_neg(e40),fixnum(7)),"-1428571428571428571428571428571428571428"));
+  check(bn_rem(bn_neg(e40),fixnum(7)) == fixnum(-4));
+
+  val_t e30 = bn_parse("1000000000000000000000000000000"), p70 = bn_parse("1180591620717411303424");
+  check(bn_div(e30,p70) == fixnum(847032947));
+  check(is_num(bn_rem(e30,p70),"300224849449658089472"));
+  check(bn_div(bn_neg(e30),p70) == fixnum(-847032947));
+  check(is_num(bn_rem(bn_neg(e30),p70),"-300224849449658089472"));
+
+  // a smaller dividend
+  check(bn_div(fixnum(5),e40) == fixnum(0));
+  check(bn_rem(fixnum(5),e40) == fixnum(5));
+}
+
+static uint64_t SEED = 88172645463325252ull;
+
+static uint64_t xorshift(void)
+{
+  SEED ^= SEED << 13;
+  SEED ^= SEED >> 7;
+  SEED ^= SEED << 17;
+  return SEED;
+}
+
+// Karatsuba, both the balanced split and slices of a much longer operand
+static void test_karatsuba(void)
+{
+  static const size_t sizes[][2] =
+    {
+      { KARATSUBA_CUTOFF, KARATSUBA_CUTOFF }, { 63, 40 }, { 100, 99 }, { 150, 33 }, { 257, 129 },
+    };
+
+  for (size_t c = 0; c < sizeof(sizes) / sizeof(sizes[0]); c++)
+    {
+      size_t na = sizes[c][0], nb = sizes[c][1];
+      limb_t* a = malloc(na * sizeof(limb_t)), *b = malloc(nb * sizeof(limb_t));
+      limb_t* r = malloc((na + nb) * sizeof(limb_t)), *s = calloc(na + nb,sizeof(limb_t));
+
+      for (size_t i = 0; i < na; i++)
+	a[i] = xorshift();
+
+      for (size_t i = 0; i < nb; i++)
+	b[i] = c % 2 ? ~0ul : xorshift();    // all-ones limbs carry everywhere
+
+      mag_mul(r,a,na,b,nb);
+      mag_mul_school(s,a,na,b,nb);
+      check(!memcmp(r,s,(na + nb) * sizeof(limb_t)));
+
+      // and the product divides back exactly
+      val_t x = mk_bignum(a,na,false), y = mk_bignum(b,nb,true);
+      val_t p = bn_mul(x,y);
+      check(bn_ord(bn_div(p,y),x) == 0);
+      check(bn_rem(p,y) == fixnum(0));
+      check(bn_ord(bn_div(p,x),y) == 0);
+
+      free(a); free(b); free(r); free(s);
+    }
+}
+
+int main(void)
+{
+  // operands are held in C locals throughout
+  GC_AUTO = false;
+  hn_init();
+
+  test_parse();
+  test_addsub();
+  test_mul();
+  test_divrem();
+  test_karatsuba();
+
+  return hn_status();
+}
@@ -0,0 +1,143 @@
+#include <sys/wait.h>
+#include <unistd.h>
+#include "harness.h"
+
+// the same double, bit for bit (so -0.0 and 0.0 differ)
+static bool same_bits(rflt_t x, rflt_t y)
+{
+  return !memcmp(&x,&y,sizeof(rflt_t));
+}
+
+static void test_fixnums(void)
+{
+  static const rint_t cases[] =
+    {
+      0, 1, -1, 42, -42, INT32_MAX, INT32_MIN, 1l << 40, -(1l << 40),
+      FIXNUM_MAX, FIXNUM_MIN, FIXNUM_MAX - 1, FIXNUM_MIN + 1,
+    };
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+      val_t v = mk_int(cases[i]);
+      check(isfixnum(v));
+      check(!isflonum(v));
+      check(tpkey(v) == INTEGER);
+      check(ival(v) == cases[i]);
+    }
+
+  // one past either end is a bignum
+  check(!isfixnum(mk_int(FIXNUM_MAX + 1)));
+  check(!isfixnum(mk_int(FIXNUM_MIN - 1)));
+  check(isint(mk_int(FIXNUM_MAX + 1)));
+}
+
+static void test_flonums(void)
+{
+  static const rflt_t cases[] =
+    {
+      0.0, -0.0, 1.0, -1.0, 0.1, -2.5, 3.141592653589793, 1e-18, -1e18,
+      0x1p-62, -0x1p-62, 0x1.fffffffffffffp64, -0x1.fffffffffffffp64,
+    };
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+      val_t v = mk_float(cases[i]);
+      check(isflonum(v));
+      check(!isfixnum(v));
+      check(tpkey(v) == FLOAT);
+      check(same_bits(fval(v),cases[i]));
+    }
+
+  check(mk_float(-0.0) != mk_float(0.0));
+  check(signbit(fval(mk_float(-0.0))));
+
+  // everything outside the flonum range is boxed, and reads back the same
+  static const rflt_t boxed[] =
+    {
+      0x1p-63, 0x1p65, -0x1p65, 1e300, 5e-324, INFINITY, -INFINITY,
+    };
+
+  for (size_t i = 0; i < sizeof(boxed) / sizeof(boxed[0]); i++)
+    {
+      val_t v = mk_float(boxed[i]);
+      check(!isflonum(v));
+      check(isfloat(v));
+      check(tpkey(v) == FLOAT);
+      check(same_bits(fval(v),boxed[i]));
+    }
+
+  check(isnan(fval(mk_float(NAN))));
+}
+
+static void test_conversions(void)
+{
+  check(val_ftoi(mk_float(2.9)) == fixnum(2));
+  check(val_ftoi(mk_float(-2.9)) == fixnum(-2));
+  check(val_ftoi(mk_float(-0.0)) == fixnum(0));
+  check(!isfixnum(val_ftoi(mk_float(0x1p62))));
+  check(isint(val_ftoi(mk_float(-0x1p63))));
+  check(same_bits(fval(val_itof(fixnum(-7))),-7.0));
+}
+
+// integer literals are decimal, whatever their leading digits, and have to be used up entirely
+static void test_literals(void)
+{
+  check(stoi("010") == fixnum(10));
+  check(stoi("09") == fixnum(9));
+  check(stoi("-0012") == fixnum(-12));
+  check(stoi("+7") == fixnum(7));
+  check(stoi("0") == fixnum(0));
+  check(stoi("0x10") == R_EOF);
+  check(stoi("12abc") == R_EOF);
+  check(stoi("-") == R_EOF);
+  check(stoi("") == R_EOF);
+  check(stoi(" 1") == R_EOF);
+
+  // too long for strtoll, so read as a bignum, still in decimal
+  val_t big = stoi("0100000000000000000000");
+  check(isint(big) && !isfixnum(big));
+  check(bn_ord(big,bn_parse("100000000000000000000")) == 0);
+  check(bn_parse("010") == fixnum(10));
+  check(bn_parse("0x1f") == R_EOF);
+  check(bn_parse("-") == R_EOF);
+}
+
+// a conversion the runtime has to refuse exits with a failure status
+static bool ftoi_fails(rflt_t f)
+{
+  fflush(stderr);
+  pid_t pid = fork();
+
+  if (!pid)
+    {
+      freopen("/dev/null","w",stderr);
+      val_ftoi(mk_float(f));
+      _exit(EXIT_SUCCESS);
+    }
+
+  int status;
+  waitpid(pid,&status,0);
+  return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_FAILURE;
+}
+
+static void test_conversion_errors(void)
+{
+  check(ftoi_fails(NAN));
+  check(ftoi_fails(INFINITY));
+  check(ftoi_fails(-INFINITY));
+  check(ftoi_fails(0x1p63));
+  check(ftoi_fails(-0x1p64));
+}
+
+int main(void)
+{
+  hn_init();
+
+  test_fixnums();
+  test_flonums();
+  test_conversions();
+  test_literals();
+  test_conversion_errors();
+
+  return hn_status();
+}
@@ -0,0 +1,215 @@
+#include "harness.h"
+#include "../include/rvec.h"
+
+/*
+   collector stress: every object is reachable from several roots, so each collection meets
+   objects it has already forwarded (and whose headers read R_FPTR) and has to follow them
+   instead of dispatching on the header. Run with serial, parallel or immix. Also checks that a
+   store into the middle of an old large object is remembered by the write barrier.
+ */
+
+#define NOBJS   512
+#define NCOPIES 4
+#define NROUNDS 40
+
+static const chr_t* LONGSTR = "a string long enough to be allocated on the heap";
+
+// one of each kind of object the collector moves, chosen by i
+static val_t mk_object(size_t i)
+{
+  switch (i % 5)
+    {
+    case 0:
+      return mk_str(LONGSTR);
+
+    case 1:
+      return mk_int(FIXNUM_MAX + 1 + (rint_t)i);
+
+    case 2:
+      return (val_t)mk_pair(fixnum(i),R_NIL);
+
+    case 3:
+      {
+	val_t args[8];
+
+	for (size_t j = 0; j < 8; j++)
+	  args[j] = fixnum(i + j);
+
+	return mk_list(args,8);
+      }
+
+    default:
+      {
+	// big enough for the large object space
+	size_t n = LOS_THRESHOLD + i;
+	chr_t* s = malloc(n + 1);
+	memset(s,'x',n);
+	s[n] = '\0';
+
+	val_t out = mk_str(s);
+	free(s);
+	return out;
+      }
+    }
+}
+
+static bool is_object(val_t v, size_t i)
+{
+  switch (i % 5)
+    {
+    case 0:
+      return isheapstr(v) && !strcmp(ptr(rstr_t*,v)->chars,LONGSTR);
+
+    case 1:
+      return isint(v) && !isfixnum(v) && bn_ord(v,mk_int(FIXNUM_MAX + 1 + (rint_t)i)) == 0;
+
+    case 2:
+      return car(v) == fixnum(i) && cdr(v) == R_NIL;
+
+    case 3:
+      {
+	for (size_t j = 0; j < 8; j++, v = cdr(v))
+	  if (car(v) != fixnum(i + j))
+	    return false;
+
+	return v == R_NIL;
+      }
+
+    default:
+      return isheapstr(v) && strlen(ptr(rstr_t*,v)->chars) == LOS_THRESHOLD + i;
+    }
+}
+
+static val_t BASE;
+
+#define ROOT(i,c) (*stack_ref(BASE + 1 + (c) * NOBJS + (i)))
+
+// every copy of a root still names the same, intact object
+static void check_roots(void)
+{
+  for (size_t i = 0; i < NOBJS; i++)
+    {
+      check(is_object(ROOT(i,0),i));
+
+      for (size_t c = 1; c < NCOPIES; c++)
+	{
+	  // lists are also referenced from their second cell
+	  if (i % 5 == 3 && c == NCOPIES - 1)
+	    check(ROOT(i,c) == cdr(ROOT(i,0)));
+
+	  else
+	    check(ROOT(i,c) == ROOT(i,0));
+	}
+    }
+}
+
+static void set_roots(size_t i)
+{
+  val_t v = mk_object(i);
+
+  for (size_t c = 0; c < NCOPIES; c++)
+    ROOT(i,c) = v;
+
+  if (i % 5 == 3)
+    ROOT(i,NCOPIES - 1) = cdr(v);
+
+  return;
+}
+
+// a vector of rascal values, for large objects with fields (rvec.c doesn't build yet)
+static size_t hn_vec_sizeof(type_t* to, val_t v)
+{
+  return to->tp_base_sz + ptr(rvec_t*,v)->elcnt * 8;
+}
+
+static uint8_t hn_vec_isalloc(type_t* to, val_t v)
+{
+  (void)to; (void)v;
+  return true;
+}
+
+static capi_t HN_VEC_CAPI = { .size = hn_vec_sizeof, .isalloc = hn_vec_isalloc };
+
+static type_t HN_VEC_TYPE =
+  {
+    .type       = DATATYPE,
+    .tp_tpkey   = RVECTOR,
+    .tp_ltag    = OBJECT,
+    .tp_isalloc = true,
+    .tp_sizing  = VARIABLE,
+    .tp_init_sz = 24,
+    .tp_base_sz = 24,
+    .tp_capi    = &HN_VEC_CAPI,
+    .name       = "vector",
+  };
+
+static void test_large_fields(void)
+{
+  size_t  n  = LOS_THRESHOLD / 8;
+  rvec_t* rv = vm_allocw(24,n);
+  rv->type   = RVECTOR;
+  rv->cmeta  = 0;
+  rv->size   = 24 + n * 8;
+  rv->elcnt  = n;
+
+  for (size_t i = 0; i < n; i++)
+    rv->rv_elements[i] = R_NIL;
+
+  check(los_contains(rv));
+  push((val_t)rv | OBJECT);
+
+  // old after this, so the store below is the only way the collector learns of the new cell
+  gc_minor();
+  gc_wbarrier(&rv->rv_elements[n / 2],(val_t)mk_pair(fixnum(7),R_NIL));
+  gc_minor();
+
+  val_t p = rv->rv_elements[n / 2];
+  check(!in_nursery(ptr(void*,p)));
+
+  // and the nursery it came from is reused
+  for (size_t i = 0; i < 64; i++)
+    mk_pair(fixnum(-1),fixnum(-1));
+
+  check(car(p) == fixnum(7) && cdr(p) == R_NIL);
+  pop();
+}
+
+int main(int argc, char** argv)
+{
+  const chr_t* mode = argc > 1 ? argv[1] : "serial";
+
+  if (!strcmp(mode,"parallel"))
+    GC_NTHREADS = 4;
+
+  else if (!strcmp(mode,"immix"))
+    gc_set_collector("immix");
+
+  hn_init();
+
+  BASE = pushn(0);
+
+  for (size_t i = 0; i < NOBJS * NCOPIES; i++)
+    push(R_NIL);
+
+  for (size_t i = 0; i < NOBJS; i++)
+    set_roots(i);
+
+  for (size_t r = 0; r < NROUNDS; r++)
+    {
+      // replace a different slice of the objects each round, leaving garbage behind
+      for (size_t i = r % 4; i < NOBJS; i += 4)
+	set_roots(i);
+
+      gc_run();
+
+      check_roots();
+    }
+
+  gc_major();
+  check_roots();
+
+  HARNESS_TYPES[RVECTOR] = &HN_VEC_TYPE;
+  test_large_fields();
+
+  return hn_status();
+}
@@ -0,0 +1,167 @@
+#include "harness.h"
+
+/*
+   the three ways of building a table - hamt_build, persistent hamt_put and hamt_put under a
+   transient - agree: the same entries in the same cursor order, the same node shapes, and the
+   same lookups, before and after removing some of the keys. The tables are rooted and collected
+   between edits, so the nodes are moved (and traced through their type) while they're built.
+ */
+
+#define NKEYS 20000
+#define MAJOR 1024   // edits between major collections (there's a minor one after every edit)
+
+static uint64_t SEED = 88172645463325252ull;
+
+static uint64_t xorshift(void)
+{
+  SEED ^= SEED << 13;
+  SEED ^= SEED >> 7;
+  SEED ^= SEED << 17;
+  return SEED;
+}
+
+static val_t mk_root(void)
+{
+  return (val_t)mk_hamt_nd(1,32,BINDINGS) | OBJECT;
+}
+
+// the same bitmaps and entries all the way down (spare room in transient nodes aside)
+static bool same_nodes(val_t x, val_t y)
+{
+  bvec_t* xb = ptr(bvec_t*,x), *yb = ptr(bvec_t*,y);
+
+  if (xb->bv_bmap != yb->bv_bmap || xb->bv_nmap != yb->bv_nmap)
+    return false;
+
+  size_t ne = popcnt(xb->bv_bmap) * xb->bv_width, ns = popcnt(xb->bv_nmap);
+
+  if (memcmp(xb->bv_elements,yb->bv_elements,ne * sizeof(val_t)))
+    return false;
+
+  for (size_t i = 0; i < ns; i++)
+    if (!same_nodes(xb->bv_elements[ne+i],yb->bv_elements[ne+i]))
+      return false;
+
+  return true;
+}
+
+// the cursors over x and y yield the same entries, and there are n of them
+static bool same_entries(val_t x, val_t y, size_t n)
+{
+  hamt_cursor_t cx, cy;
+  val_t* ex, *ey;
+  size_t cnt = 0;
+
+  hamt_cursor_init(&cx,x);
+  hamt_cursor_init(&cy,y);
+
+  while ((ex = hamt_cursor_next(&cx)))
+    {
+      if (!(ey = hamt_cursor_next(&cy)) || ex[0] != ey[0] || ex[1] != ey[1])
+	return false;
+
+      cnt++;
+    }
+
+  return !hamt_cursor_next(&cy) && cnt == n;
+}
+
+static void collect(size_t i)
+{
+  if (i % MAJOR == MAJOR - 1)
+    gc_major();
+
+  else
+    gc_minor();
+
+  return;
+}
+
+int main(void)
+{
+  hn_init();
+
+  // about one key in eight is repeated, so later bindings have to win everywhere
+  static val_t keys[NKEYS], vals[NKEYS];
+
+  for (size_t i = 0; i < NKEYS; i++)
+    {
+      keys[i] = i % 8 == 7 ? keys[xorshift() % i] : fixnum(xorshift() >> 8);
+      vals[i] = fixnum(i);
+    }
+
+  size_t nk;
+  val_t bulk = R_NIL, pers = R_NIL, trans = R_NIL, after = R_NIL;
+  gc_scope_t s = gc_scope_open();
+  gc_preserve(bulk);
+  gc_preserve(pers);
+  gc_preserve(trans);
+  gc_preserve(after);
+
+  bulk  = hamt_build(keys,vals,NKEYS,BINDINGS,&nk);
+  pers  = mk_root();
+  trans = mk_root();
+  uint64_t edit = hamt_transient();
+
+  for (size_t i = 0; i < NKEYS; i++)
+    {
+      hamt_put(&pers,keys[i],vals[i],BINDINGS,0,NULL);
+      hamt_put(&trans,keys[i],vals[i],BINDINGS,edit,NULL);
+      collect(i);
+    }
+
+  check(nk < NKEYS);
+  check(same_nodes(bulk,pers));
+  check(same_nodes(bulk,trans));
+  check(same_entries(bulk,pers,nk));
+  check(same_entries(bulk,trans,nk));
+
+  // the last binding of every key is the one found
+  for (size_t i = NKEYS; i--;)
+    {
+      val_t* e = hamt_search(bulk,keys[i]);
+      check(e && e[0] == keys[i]);
+
+      if (e && ival(e[1]) > (rint_t)i)
+	continue;
+
+      check(e && e[1] == vals[i]);
+      check(hamt_search(pers,keys[i]) && hamt_search(pers,keys[i])[1] == vals[i]);
+      check(hamt_search(trans,keys[i]) && hamt_search(trans,keys[i])[1] == vals[i]);
+    }
+
+  check(!hamt_search(bulk,fixnum(-1)));
+
+  // removing every third distinct key from the put tables leaves what a bulk load of the rest builds
+  static val_t rest[NKEYS], restv[NKEYS];
+  size_t nrest = 0, nrm = 0;
+  hamt_cursor_t c;
+  hamt_cursor_init(&c,bulk);
+  hamt_cursor_preserve(&c);
+
+  for (val_t* e; (e = hamt_cursor_next(&c)); nrm++)
+    if (nrm % 3)
+      {
+	rest[nrest]  = e[0];
+	restv[nrest] = e[1];
+	nrest++;
+      }
+
+    else
+      {
+	check(hamt_remove(&pers,e[0],BINDINGS,0));
+	check(hamt_remove(&trans,e[0],BINDINGS,edit));
+	collect(nrm);
+      }
+
+  after = hamt_build(rest,restv,nrest,BINDINGS,&nk);
+
+  check(nk == nrest);
+  check(same_nodes(after,pers));
+  check(same_nodes(after,trans));
+  check(same_entries(after,pers,nrest));
+  check(same_entries(after,trans,nrest));
+
+  gc_scope_close(s);
+  return hn_status();
+}
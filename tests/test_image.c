@@ -0,0 +1,116 @@
+#include <unistd.h>
+#include <sys/wait.h>
+#include "harness.h"
+
+/*
+   heap images round trip: a list of symbols, heap data and a pointer to a static type object is
+   saved from a global constant and loaded back twice - by a fresh run of this executable (which,
+   being position independent, is loaded somewhere else) and into a fresh heap in the same
+   process (so RAM lands somewhere else and is relocated). Interned symbols come back as the same
+   symbols, uninterned ones as new symbols with the same names and flags, and the type object
+   as the one in the loading process.
+ */
+
+static const chr_t* LONGSTR = "a string long enough to be allocated on the heap";
+
+// the list image_save wrote, as seen by the process that loaded it
+static void check_loaded(const chr_t* gsname)
+{
+  check(F_QUOTE == ((val_t)symtab_lookup("quote") | SYMBOL));
+
+  val_t l = R_MAIN;
+  check(car(l) == ((val_t)symtab_lookup("foo") | SYMBOL));
+  l = cdr(l);
+
+  check(car(l) == ((val_t)symtab_lookup(":key") | SYMBOL));
+  check(ptr(symbol_t*,car(l))->flags == (SM_INTERNED | SM_KEYWORD));
+  l = cdr(l);
+
+  symbol_t* un = ptr(symbol_t*,car(l));
+  check(ltag(car(l)) == SYMBOL && un != symtab_lookup("loose"));
+  check(!strcmp(un->name,"loose") && un->flags == 0);
+  l = cdr(l);
+
+  symbol_t* gs = ptr(symbol_t*,car(l));
+  check(ltag(car(l)) == SYMBOL);
+  check(!strcmp(gs->name,gsname) && gs->flags == SM_GENSYM);
+  l = cdr(l);
+
+  check(isheapstr(car(l)) && !strcmp(ptr(rstr_t*,car(l))->chars,LONGSTR));
+  l = cdr(l);
+
+  check(car(l) == ((val_t)&NVEC_TYPE_OBJ | OBJECT));
+  l = cdr(l);
+
+  check(car(l) == fixnum(42));
+  check(cdr(l) == R_NIL);
+}
+
+// test_image load <path> <gensym name>: the second process
+static int load_child(const chr_t* path, const chr_t* gsname)
+{
+  hn_init();
+  check(image_load(path));
+  check_loaded(gsname);
+  return hn_status();
+}
+
+int main(int argc, char** argv)
+{
+  if (argc == 4 && !strcmp(argv[1],"load"))
+    return load_child(argv[2],argv[3]);
+
+  hn_init();
+
+  symbol_t* foo = mk_symbol("foo",SM_INTERNED);
+  symbol_t* kw  = mk_symbol(":key",SM_INTERNED | SM_KEYWORD);
+  symbol_t* un  = mk_symbol("loose",0);
+  symbol_t* gs  = mk_symbol("tmp",SM_GENSYM);
+  chr_t gsname[64];
+  strcpy(gsname,gs->name);
+
+  val_t elts[7] =
+    {
+      (val_t)foo | SYMBOL, (val_t)kw | SYMBOL, (val_t)un | SYMBOL,
+      (val_t)gs | SYMBOL, mk_str(LONGSTR), (val_t)&NVEC_TYPE_OBJ | OBJECT, fixnum(42),
+    };
+
+  R_MAIN  = mk_list(elts,7);
+  F_QUOTE = (val_t)mk_symbol("quote",SM_INTERNED) | SYMBOL;
+
+  chr_t path[] = "/tmp/rsp-image-XXXXXX";
+  int fd = mkstemp(path);
+  check(fd >= 0);
+  close(fd);
+
+  uchr_t* oldram = RAM;
+  check(image_save(path));
+
+  // a separate run of the executable
+  pid_t pid = fork();
+
+  if (!pid)
+    {
+      execl("/proc/self/exe",argv[0],"load",path,gsname,(chr_t*)NULL);
+      _exit(127);
+    }
+
+  int status;
+  check(pid > 0 && waitpid(pid,&status,0) == pid);
+  check(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  // and this one
+  R_MAIN = F_QUOTE = R_NIL;
+  check(image_load(path));
+  unlink(path);
+
+  check(RAM != oldram);
+  check_loaded(gsname);
+
+  // uninterned symbols are new even in the process that saved them
+  val_t l = cdr(cdr(R_MAIN));
+  check(ptr(symbol_t*,car(l)) != un);
+  check(ptr(symbol_t*,car(cdr(l))) != gs);
+
+  return hn_status();
+}
@@ -0,0 +1,153 @@
+#include "harness.h"
+
+/*
+   the numeric vector kernels against scalar references, for every element type. The lengths
+   are those where the vector loop and the scalar tail split differently: empty, one element,
+   around a full register (and around the four lanes of the integer sums), and a few registers
+   plus a tail. Every operand and result starts at each element offset into a register, so the
+   loads and stores are unaligned, and the element after each result is checked to be left
+   alone. The kernels run in whichever clone this CPU selects.
+ */
+
+#define NV_MAXLEN 128
+#define NV_MAXOFF 4
+#define NV_GUARD  0x5a
+
+// register aligned, so offset 0 is the only aligned start
+static uchr_t XBUF[(NV_MAXLEN + NV_MAXOFF) * 8] __attribute__((__aligned__(NV_VBYTES)));
+static uchr_t YBUF[(NV_MAXLEN + NV_MAXOFF) * 8] __attribute__((__aligned__(NV_VBYTES)));
+static uchr_t RBUF[(NV_MAXLEN + NV_MAXOFF + 1) * 8] __attribute__((__aligned__(NV_VBYTES)));
+
+// the lengths to try for a register of w elements
+static size_t nv_lengths(size_t w, size_t* out)
+{
+  size_t c[] = { 0, 1, 2, 3, 4, 5, w - 1, w, w + 1, 2 * w - 1, 2 * w + 1, 3 * w + 2 }, k = 0;
+
+  for (size_t i = 0; i < sizeof(c) / sizeof(c[0]); i++)
+    if (c[i] <= NV_MAXLEN)
+      out[k++] = c[i];
+
+  return k;
+}
+
+static bool same_num(val_t x, val_t y)
+{
+  if (isfloat(x) || isfloat(y))
+    return isfloat(x) && isfloat(y) && fval(x) == fval(y);
+
+  return x == y;
+}
+
+/*
+   operands are small (so nothing overflows a lane except where the reference wraps the same
+   way) and the divisors are never zero. Integer results are truncated to the element type
+   exactly as the kernels store them.
+ */
+#define NV_REF_REM_I(ct,a,b) ((ct)((a) % (b)))
+#define NV_REF_REM_F(ct,a,b) ((ct)fmod((a),(b)))
+
+#define NV_CHECK(tn,ct,cn,box,kind)                                             \
+  static void check_##tn(size_t n, size_t off)                                  \
+  {                                                                             \
+    const nv_eltype_t* et = nv_eltype(cn);                                      \
+    ct* x = (ct*)XBUF + off, *y = (ct*)YBUF + off, *r = (ct*)RBUF + off;        \
+    bool neg = (ct)-1 < (ct)1;                                                  \
+                                                                                \
+    for (size_t i = 0; i < n; i++)                                              \
+      {                                                                         \
+	x[i] = (ct)((rint_t)(i * 7 % 23) - (neg ? 11 : 0));                     \
+	y[i] = (ct)((rint_t)(i * 5 % 13) + 1);                                  \
+	if (neg && i % 3 == 0)                                                  \
+	  y[i] = -y[i];                                                         \
+      }                                                                         \
+                                                                                \
+    ct want[NV_MAXLEN];                                                         \
+                                                                                \
+    for (nv_op_t op = NV_ADD; op <= NV_REM; op++)                               \
+      {                                                                         \
+	memset(RBUF,NV_GUARD,sizeof(RBUF));                                     \
+	et->binop[op](r,x,y,n);                                                 \
+                                                                                \
+	for (size_t i = 0; i < n; i++)                                          \
+	  switch (op)                                                           \
+	    {                                                                   \
+	    case NV_ADD: want[i] = (ct)(x[i] + y[i]); break;                    \
+	    case NV_SUB: want[i] = (ct)(x[i] - y[i]); break;                    \
+	    case NV_MUL: want[i] = (ct)(x[i] * y[i]); break;                    \
+	    case NV_DIV: want[i] = (ct)(x[i] / y[i]); break;                    \
+	    default:     want[i] = NV_REF_REM_##kind(ct,x[i],y[i]); break;      \
+	    }                                                                   \
+                                                                                \
+	check(!memcmp(r,want,n * sizeof(ct)));                                  \
+	check(((uchr_t*)(r + n))[0] == NV_GUARD);                               \
+      }                                                                         \
+                                                                                \
+    uint8_t* m = RBUF + off;                                                    \
+                                                                                \
+    for (nv_op_t op = NV_EQ; op <= NV_GE; op++)                                 \
+      {                                                                         \
+	memset(RBUF,NV_GUARD,sizeof(RBUF));                                     \
+	et->cmpop[op - NV_EQ](m,x,y,n);                                         \
+	bool ok = m[n] == NV_GUARD;                                             \
+                                                                                \
+	for (size_t i = 0; i < n; i++)                                          \
+	  {                                                                     \
+	    bool c = op == NV_EQ ? x[i] == y[i] : op == NV_LT ? x[i] < y[i]     \
+	           : op == NV_LE ? x[i] <= y[i] : op == NV_GT ? x[i] > y[i]     \
+	           : x[i] >= y[i];                                              \
+	    ok = ok && m[i] == c;                                               \
+	  }                                                                     \
+                                                                                \
+	check(ok);                                                              \
+      }                                                                         \
+                                                                                \
+    int64_t isum = 0, idot = 0;                                                 \
+    flt64_t fsum = 0, fdot = 0;                                                 \
+                                                                                \
+    for (size_t i = 0; i < n; i++)                                              \
+      {                                                                         \
+	isum += (int64_t)x[i];                                                  \
+	idot += (int64_t)x[i] * (int64_t)y[i];                                  \
+	fsum += x[i];                                                           \
+	fdot += (flt64_t)x[i] * y[i];                                           \
+      }                                                                         \
+                                                                                \
+    bool isint = #kind[0] == 'I';                                               \
+    check(same_num(et->sum(x,n),isint ? mk_int(isum) : mk_float(fsum)));        \
+    check(same_num(et->dot(x,y,n),isint ? mk_int(idot) : mk_float(fdot)));      \
+                                                                                \
+    if (!n)                                                                     \
+      return;                                                                   \
+                                                                                \
+    ct lo = x[0], hi = x[0];                                                    \
+                                                                                \
+    for (size_t i = 1; i < n; i++)                                              \
+      {                                                                         \
+	lo = x[i] < lo ? x[i] : lo;                                             \
+	hi = x[i] > hi ? x[i] : hi;                                             \
+      }                                                                         \
+                                                                                \
+    check(same_num(et->least(x,n),box(lo)));                                    \
+    check(same_num(et->greatest(x,n),box(hi)));                                 \
+  }
+
+NV_TYPES(NV_CHECK)
+
+#define NV_RUN(tn,ct,cn,box,kind)                                               \
+  {                                                                             \
+    size_t lens[16], nl = nv_lengths(NV_VBYTES / sizeof(ct),lens);              \
+                                                                                \
+    for (size_t l = 0; l < nl; l++)                                             \
+      for (size_t off = 0; off < NV_MAXOFF; off++)                              \
+	check_##tn(lens[l],off);                                                \
+  }
+
+int main(void)
+{
+  GC_AUTO = false;
+  hn_init();
+
+  NV_TYPES(NV_RUN)
+
+  return hn_status();
+}
@@ -0,0 +1,168 @@
+#include "harness.h"
+
+// the list (from, from+1, ... from+n-1) in cells built by mk_list
+static val_t range_list(size_t n, rint_t from)
+{
+  val_t* args = malloc(n * sizeof(val_t));
+
+  for (size_t i = 0; i < n; i++)
+    args[i] = fixnum(from + (rint_t)i);
+
+  val_t out = mk_list(args,n);
+  free(args);
+  return out;
+}
+
+static bool is_range(val_t l, size_t n, rint_t from)
+{
+  for (size_t i = 0; i < n; i++, l = cdr(l))
+    if (!l || car(l) != fixnum(from + (rint_t)i))
+      return false;
+
+  return l == R_NIL;
+}
+
+static void test_mk_list(void)
+{
+  check(mk_list(NULL,0) == R_NIL);
+
+  // a single cell isn't worth a run
+  val_t one = range_list(1,7);
+  check(!cdr_coded(one));
+  check(is_range(one,1,7));
+
+  val_t two = range_list(2,0);
+  check(cdr_coded(two));
+  check(is_range(two,2,0));
+
+  // one cell left over at the front of a chain of full runs
+  val_t odd = range_list(CDR_RUN_MAX + 1,0);
+  check(!cdr_coded(odd));
+  check(cdr_coded(cdr(odd)));
+  check(is_range(odd,CDR_RUN_MAX + 1,0));
+  check(pair_elcnt(odd) == CDR_RUN_MAX + 1);
+}
+
+static void test_access(void)
+{
+  val_t l = range_list(10,100);
+
+  check(pair_assocn(l,0) == fixnum(100));
+  check(pair_assocn(l,9) == fixnum(109));
+  check(pair_assocv(l,fixnum(104)) == 4);
+  check(pair_assocv(l,fixnum(110)) == -1);
+
+  // replacing a car inside a run writes the run's own slot
+  val_t c = pair_rplcn(l,3,fixnum(-3));
+  check(cdr_coded(c));
+  check(pair_assocn(l,3) == fixnum(-3));
+  check(pair_assocv(l,fixnum(-3)) == 3);
+}
+
+static void test_append(void)
+{
+  val_t l = range_list(5,0);
+  val_t run = l;
+
+  pair_append(&l,fixnum(5));
+  check(l == run);
+  check(is_range(l,6,0));
+
+  val_t empty = R_NIL;
+  pair_append(&empty,fixnum(1));
+  check(is_range(empty,1,1));
+}
+
+static void test_split(void)
+{
+  val_t l = range_list(6,0);
+  val_t orig = l;
+  val_t second = cdr(l);
+
+  // replacing an implicit cdr copies the rest of the run out, leaving the run itself alone
+  val_t* slot = cdr_loc(&l);
+  check(l != orig);
+  check(!cdr_coded(l));
+  check(car(l) == fixnum(0));
+
+  *slot = (val_t)mk_pair(fixnum(42),R_NIL);
+  check(car(cdr(l)) == fixnum(42));
+  check(cdr(cdr(l)) == R_NIL);
+  check(is_range(orig,6,0));
+  check(cdr(orig) == second);
+
+  // the end of a run has a slot of its own
+  val_t last = orig;
+
+  while (cdr(last))
+    last = cdr(last);
+
+  check(cdr_loc(&last) == &cdr_tail(last));
+}
+
+// runs and the pairs hanging off them survive being copied by both collections
+static void test_collect(void)
+{
+  val_t base = pushn(3);
+
+  *stack_ref(base + 1) = range_list(CDR_RUN_MAX * 2 + 1,0);
+  *stack_ref(base + 2) = cdr(cdr(cdr(*stack_ref(base + 1))));   // a cell in the middle of a run
+  *stack_ref(base + 3) = R_NIL;
+  pair_append(stack_ref(base + 1),fixnum(CDR_RUN_MAX * 2 + 1));
+
+  gc_minor();
+  gc_major();
+
+  check(is_range(*stack_ref(base + 1),CDR_RUN_MAX * 2 + 2,0));
+  check(is_range(*stack_ref(base + 2),CDR_RUN_MAX * 2 - 1,3));
+  check(cdr_index(*stack_ref(base + 2)) == 2);
+
+  popn(3);
+}
+
+/*
+   a long list built the way the reader builds one: each element is allocated and pushed in
+   turn, then the list is made from the stack with a dotted tail. The nursery is shrunk so that
+   collections happen throughout, moving the elements pushed so far and the tail.
+ */
+static void test_stack_list(void)
+{
+  size_t n = CDR_RUN_MAX * 3 + 1;
+  val_t sp = SP, nsz = NURSERYSIZE;
+
+  // empty the nursery before shrinking it, so nothing in it lies past the new end
+  gc_minor();
+  uint64_t cycle = GC_STATS.cycle;
+  NURSERYSIZE = 512;
+
+  for (size_t i = 0; i < n; i++)
+    push((val_t)mk_pair(fixnum(i),R_NIL));
+
+  val_t l = mk_stack_list(n,(val_t)mk_pair(fixnum(-1),R_NIL));
+
+  check(SP == sp);
+  check(GC_STATS.cycle > cycle);
+
+  // counted, so a list corrupted by a collection can't loop
+  for (size_t i = 0; i < n; i++, l = cdr(l))
+    check(car(car(l)) == fixnum(i) && cdr(car(l)) == R_NIL);
+
+  check(car(l) == fixnum(-1) && cdr(l) == R_NIL);
+  check(mk_stack_list(0,R_NIL) == R_NIL);
+
+  NURSERYSIZE = nsz;
+}
+
+int main(void)
+{
+  hn_init();
+
+  test_mk_list();
+  test_access();
+  test_append();
+  test_split();
+  test_collect();
+  test_stack_list();
+
+  return hn_status();
+}
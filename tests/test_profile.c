@@ -0,0 +1,93 @@
+#include "harness.h"
+
+/*
+   allocation profiling: samples are charged to the frames that were live when they were taken.
+   Applications are simulated the way the evaluator makes them - the continuation is saved on the
+   dump, then the frame is entered - so a frame ends when its continuation is restored, and a
+   call made after a nested call has returned is charged to its caller alone.
+ */
+
+static const chr_t* LONGSTR = "a string long enough to be allocated on the heap";
+
+#define CONT_SZ 4   // dump slots taken by a saved continuation
+
+static void call(const chr_t* name)
+{
+  DP += CONT_SZ;
+  prof_call(name);
+}
+
+static void ret(void)
+{
+  DP -= CONT_SZ;
+}
+
+// the bytes prof_collapsed charged to exactly this stack (0 if there's no such line)
+static size_t site_bytes(const chr_t* out, const chr_t* stack)
+{
+  size_t n = strlen(stack);
+
+  for (const chr_t* l = out; *l; l = strchr(l,'\n') + 1)
+    {
+      if (!strncmp(l,stack,n) && l[n] == ' ')
+	return strtoul(l + n + 1,NULL,10);
+
+      if (!strchr(l,'\n'))
+	break;
+    }
+
+  return 0;
+}
+
+int main(void)
+{
+  GC_AUTO = false;
+  hn_init();
+  prof_start(1);      // every allocation is a sample weighing its size
+
+  size_t base = prof_depth();
+  mk_str(LONGSTR);
+
+  call("outer");
+  mk_str(LONGSTR);
+
+  call("inner");
+  mk_str(LONGSTR);
+  ret();
+
+  call("sibling");
+  mk_str(LONGSTR);
+  mk_str(LONGSTR);
+  ret();
+
+  mk_str(LONGSTR);
+  ret();
+
+  // frames entered from C are left explicitly
+  prof_enter("native");
+  mk_str(LONGSTR);
+  prof_leave();
+
+  mk_str(LONGSTR);
+  check(prof_depth() == base);
+
+  chr_t* out = NULL;
+  size_t sz  = 0;
+  FILE*  f   = open_memstream(&out,&sz);
+  prof_collapsed(f);
+  fclose(f);
+
+  size_t one = site_bytes(out,"outer;inner;str");
+  check(one > 0);
+  check(site_bytes(out,"outer;str") == 2 * one);
+  check(site_bytes(out,"outer;sibling;str") == 2 * one);
+  check(site_bytes(out,"native;str") == one);
+  check(site_bytes(out,"<toplevel>;str") == 2 * one);
+
+  // the sibling never runs inside the call before it
+  check(!site_bytes(out,"outer;inner;sibling;str"));
+  check(!strstr(out,"inner;sibling"));
+
+  free(out);
+  return hn_status();
+}
@@ -0,0 +1,88 @@
+#include <locale.h>
+#include "harness.h"
+
+static const chr_t* WORDS[] =
+  {
+    "", "a", "aa", "ab", "abc", "abcdefg", "abcdefgh", "abcdefghij", "b", "ba",
+    "z", "zzzzzzz", "zzzzzzzz", "é", "été", "€", "€1", "A", "Z", "0",
+  };
+
+#define NWORDS (sizeof(WORDS) / sizeof(WORDS[0]))
+
+static int32_t sign(int32_t x)
+{
+  return (x > 0) - (x < 0);
+}
+
+static void test_forms(void)
+{
+  check(issstr(mk_str("")));
+  check(issstr(mk_str("abcdefg")));
+  check(isheapstr(mk_str("abcdefgh")));
+  check(mk_str("abc") == mk_strval("abc"));
+  check(tpkey(mk_str("abc")) == STRING);
+  check(isstr(mk_str("abc")) && isstr(mk_str("abcdefghij")));
+
+  chr_t buf[SSTR_MAX+1];
+  check(!strcmp(rstr_chars(mk_str("abcdefg"),buf),"abcdefg"));
+  check(!strcmp(rstr_chars(mk_str("€1"),buf),"€1"));
+}
+
+// every pair orders like strcmp (UTF-8 byte order), whichever forms the two strings take
+static void test_ordering(void)
+{
+  for (size_t i = 0; i < NWORDS; i++)
+    for (size_t j = 0; j < NWORDS; j++)
+      {
+	int32_t want = sign(strcmp(WORDS[i],WORDS[j]));
+	val_t x = mk_str(WORDS[i]), y = mk_str(WORDS[j]);
+
+	check(sign(rstr_ord(x,y)) == want);
+
+	// the same comparisons with both strings on the heap
+	val_t hx = (val_t)mk_rstr(WORDS[i]) | CVALUE, hy = (val_t)mk_rstr(WORDS[j]) | CVALUE;
+	check(sign(rstr_ord(hx,hy)) == want);
+	check(sign(rstr_ord(x,hy)) == want);
+	check(sign(rstr_ord(hx,y)) == want);
+      }
+}
+
+static void test_hash(void)
+{
+  for (size_t i = 0; i < NWORDS; i++)
+    {
+      val_t x = mk_str(WORDS[i]), hx = (val_t)mk_rstr(WORDS[i]) | CVALUE;
+      check(rstr_hash(x,1) == rstr_hash(hx,1));
+    }
+}
+
+static void test_access(void)
+{
+  val_t s = mk_str("été"), h = mk_str("héllo wörld");
+
+  check(issstr(s));
+  check(rstr_elcnt(s) == 3);
+  check(rstr_assocn(s,1) == 't');
+  check(rstr_assocn(s,2) == 0xe9);
+  check(rstr_assocv(s,'t') == 1);
+  check(rstr_assocv(s,'x') == -1);
+
+  check(isheapstr(h));
+  check(rstr_elcnt(h) == 11);
+  check(rstr_assocn(h,1) == 0xe9);
+  check(rstr_assocv(h,0xf6) == 7);
+}
+
+int main(void)
+{
+  // the UTF-8 helpers decode through mbtowc
+  setlocale(LC_CTYPE,"C.UTF-8");
+  hn_init();
+
+  test_forms();
+  test_ordering();
+  test_hash();
+  test_access();
+
+  return hn_status();
+}
@@ -0,0 +1,120 @@
+#include <pthread.h>
+#include "harness.h"
+
+/*
+   symbol interning from several threads at once: every thread interns the same names in its own
+   order (and makes gensyms), and afterwards each name has exactly one symbol, which every thread
+   got back. Symbols live outside the heap, so the collectors have to leave references to them
+   alone.
+ */
+
+#define NTHREADS 8
+#define NNAMES   4096
+#define NGENSYMS 512
+
+static symbol_t* GOT[NTHREADS][NNAMES];
+static symbol_t* GENSYMS[NTHREADS][NGENSYMS];
+
+static void sym_name(chr_t* buf, size_t i)
+{
+  sprintf(buf,"sym-%zu",i);
+}
+
+static void* intern_all(void* arg)
+{
+  size_t t = (size_t)arg;
+  chr_t buf[32];
+
+  // each thread starts somewhere else and strides through the names
+  for (size_t n = 0; n < NNAMES; n++)
+    {
+      size_t i = (n * (2 * t + 1) + t * (NNAMES / NTHREADS)) % NNAMES;
+      sym_name(buf,i);
+      GOT[t][i] = mk_symbol(buf,SM_INTERNED);
+    }
+
+  for (size_t n = 0; n < NGENSYMS; n++)
+    GENSYMS[t][n] = mk_symbol("g",SM_GENSYM);
+
+  return NULL;
+}
+
+static size_t NSEEN = 0;
+
+static void count_symbol(symbol_t* s)
+{
+  (void)s;
+  NSEEN++;
+}
+
+static int name_cmp(const void* x, const void* y)
+{
+  return strcmp((*(symbol_t**)x)->name,(*(symbol_t**)y)->name);
+}
+
+static void test_concurrent(void)
+{
+  pthread_t th[NTHREADS];
+
+  for (size_t t = 0; t < NTHREADS; t++)
+    pthread_create(&th[t],NULL,intern_all,(void*)t);
+
+  for (size_t t = 0; t < NTHREADS; t++)
+    pthread_join(th[t],NULL);
+
+  chr_t buf[32];
+
+  for (size_t i = 0; i < NNAMES; i++)
+    {
+      sym_name(buf,i);
+      check(GOT[0][i] && !strcmp(GOT[0][i]->name,buf));
+      check(symtab_lookup(buf) == GOT[0][i]);
+
+      for (size_t t = 1; t < NTHREADS; t++)
+	check(GOT[t][i] == GOT[0][i]);
+    }
+
+  check(symtab_count() == NNAMES);
+  symtab_each(count_symbol);
+  check(NSEEN == NNAMES);
+
+  // the shared counter gives every gensym its own name
+  static symbol_t* all[NTHREADS * NGENSYMS];
+  memcpy(all,GENSYMS,sizeof(all));
+  qsort(all,NTHREADS * NGENSYMS,sizeof(symbol_t*),name_cmp);
+
+  for (size_t i = 1; i < NTHREADS * NGENSYMS; i++)
+    check(strcmp(all[i-1]->name,all[i]->name));
+}
+
+// cells holding symbols keep the same symbols through both kinds of collection
+static void test_collect(void)
+{
+  val_t base = pushn(NNAMES / 64);
+
+  for (size_t i = 0; i < NNAMES / 64; i++)
+    *stack_ref(base + 1 + i) = (val_t)mk_pair((val_t)GOT[0][i] | SYMBOL,(val_t)GENSYMS[0][i] | SYMBOL);
+
+  gc_minor();
+  gc_major();
+  gc_major();
+
+  for (size_t i = 0; i < NNAMES / 64; i++)
+    {
+      val_t p = *stack_ref(base + 1 + i);
+      check(car(p) == ((val_t)GOT[0][i] | SYMBOL));
+      check(cdr(p) == ((val_t)GENSYMS[0][i] | SYMBOL));
+    }
+
+  popn(NNAMES / 64);
+}
+
+int main(void)
+{
+  hn_init();
+
+  test_concurrent();
+  test_collect();
+
+  return hn_status();
+}
@@ -0,0 +1,172 @@
+#include "harness.h"
+
+/*
+   the table builtins: gc-stats describes the last collection, table-from binds the car of each
+   pair to its cdr (later pairs win), and reduce and each call a function on every entry. The
+   tables are rooted and collected between calls, so they're moved and traced through their
+   type; the callbacks are C functions behind a callable type.
+ */
+
+#define NPAIRS 500
+
+// a C function called through rsp_apply (the runtime doesn't use this type key)
+#define HN_NATIVE 0x0eu
+
+typedef struct
+{
+  tpkey_t  type;
+  uint32_t cmeta;
+  val_t    (*fn)(val_t*,size_t);
+} hn_native_t;
+
+static val_t hn_native_call(type_t* self, val_t* args, size_t n)
+{
+  return ((hn_native_t*)self)->fn(args,n);
+}
+
+static capi_t HN_NATIVE_CAPI = { .call = hn_native_call };
+
+static type_t HN_NATIVE_TYPE =
+  {
+    .type       = DATATYPE,
+    .tp_tpkey   = HN_NATIVE,
+    .tp_ltag    = OBJECT,
+    .tp_isalloc = false,
+    .tp_sizing  = FIXED,
+    .tp_base_sz = sizeof(hn_native_t),
+    .tp_capi    = &HN_NATIVE_CAPI,
+    .name       = "native",
+  };
+
+// (f key value acc) - acc plus the value
+static val_t sum_values(val_t* a, size_t n)
+{
+  check(n == 3);
+  return fixnum(ival(a[2]) + ival(a[1]));
+}
+
+static size_t NSEEN = 0;
+static rint_t KEYSUM = 0;
+
+// (f key value) - counts the entries and totals the keys
+static val_t see_entry(val_t* a, size_t n)
+{
+  check(n == 2);
+  NSEEN++;
+  KEYSUM += ival(a[0]);
+  gc_minor();    // a collection while the walk is on
+  return R_NIL;
+}
+
+static hn_native_t SUM  = { .type = HN_NATIVE, .fn = sum_values };
+static hn_native_t SEE  = { .type = HN_NATIVE, .fn = see_entry };
+
+static val_t sym(chr_t* name)
+{
+  return (val_t)mk_symbol(name,SM_INTERNED) | SYMBOL;
+}
+
+static void test_gc_stats(void)
+{
+  val_t st = R_NIL;
+  gc_scope_t s = gc_scope_open();
+  gc_preserve(st);
+
+  gc_minor();
+  st = rsp_gc_stats();
+  uint64_t cycle = GC_STATS.cycle;
+  gc_major();
+
+  table_t* t = ptr(table_t*,st);
+  check(istable(st));
+  check(tb_getkey(t,sym("kind")) == sym("minor"));
+  check(tb_getkey(t,sym("cycle")) == mk_int(cycle));
+  check(tb_getkey(t,sym("grew")) == R_TRUE || tb_getkey(t,sym("grew")) == R_FALSE);
+  check(istable(tb_getkey(t,sym("objects"))));
+  check(tb_getkey(t,sym("missing")) == R_UNBOUND);
+  check(t->nkeys == 13);
+
+  gc_scope_close(s);
+}
+
+static void test_table_from(void)
+{
+  val_t src = R_NIL, tb = R_NIL;
+  gc_scope_t s = gc_scope_open();
+  gc_preserve(src);
+  gc_preserve(tb);
+
+  // every key appears twice, and the second binding is the one kept
+  for (size_t i = 0; i < 2 * NPAIRS; i++)
+    {
+      val_t p = (val_t)mk_pair(fixnum(i % NPAIRS),fixnum(i));
+      src = (val_t)mk_pair(p,src);
+    }
+
+  tb = rsp_table_from(src);
+  gc_major();
+
+  table_t* t = ptr(table_t*,tb);
+  check(t->nkeys == NPAIRS);
+
+  for (size_t k = 0; k < NPAIRS; k++)
+    check(tb_getkey(t,fixnum(k)) == fixnum(k));
+
+  check(tb_getkey(t,fixnum(NPAIRS)) == R_UNBOUND);
+
+  // and the table is updated like any other
+  tb_putkey(t,fixnum(NPAIRS),fixnum(-1));
+  check(tb_rmvkey(t,fixnum(0)) == R_TRUE);
+  check(tb_rmvkey(t,fixnum(0)) == R_FALSE);
+  gc_minor();
+  t = ptr(table_t*,tb);
+  check(t->nkeys == NPAIRS);
+  check(tb_getkey(t,fixnum(NPAIRS)) == fixnum(-1));
+  check(tb_getkey(t,fixnum(0)) == R_UNBOUND);
+
+  gc_scope_close(s);
+}
+
+static void test_walk(void)
+{
+  val_t args[3] = { R_NIL, R_NIL, R_NIL };
+  gc_scope_t s = gc_scope_open();
+
+  for (size_t i = 0; i < 3; i++)
+    gc_preserve(args[i]);
+
+  val_t tb = (val_t)mk_table(NPAIRS) | OBJECT;
+  args[2]  = tb;
+
+  for (size_t k = 1; k <= NPAIRS; k++)
+    {
+      tb_putkey(ptr(table_t*,args[2]),fixnum(k),fixnum(2 * k));
+      gc_minor();
+    }
+
+  // (reduce sum 0 tb)
+  args[0] = (val_t)&SUM | OBJECT;
+  args[1] = fixnum(0);
+  check(rsp_tb_reduce(args) == fixnum(NPAIRS * (NPAIRS + 1)));
+
+  // (each see tb)
+  args[0] = (val_t)&SEE | OBJECT;
+  args[1] = args[2];
+  check(rsp_tb_each(args) == R_NIL);
+  check(NSEEN == NPAIRS);
+  check(KEYSUM == NPAIRS * (NPAIRS + 1) / 2);
+
+  gc_scope_close(s);
+}
+
+int main(void)
+{
+  hn_init();
+  HARNESS_TYPES[HN_NATIVE] = &HN_NATIVE_TYPE;
+
+  test_gc_stats();
+  test_table_from();
+  test_walk();
+
+  return hn_status();
+}
@@ -10,7 +10,7 @@ static val_t vm_form_type(val_t exp)
     case LIST:
       {
 	if (!exp) return LBL_LITERAL;
-	val_t f = car_(exp);
+	val_t f = car(exp);
 
 	if (f == F_SETV) return LBL_SETV;
 	else if (f == F_DEF) return LBL_DEF;
@@ -42,7 +42,8 @@ val_t rsp_eval(val_t expr, val_t envt, val_t nmspc)
   else
     envt = (val_t)mk_listn(2,envt,nmspc);
 
-  val_t* BASE = STACK + SP + 1;
+  val_t BASE = SP + 1;       // frames are addressed by index (see stack_ref)
+  size_t PDEPTH = prof_depth(); // profiler frames pushed below this call are dropped when it halts
   
   
  lbl_start:
@@ -55,6 +56,7 @@ val_t rsp_eval(val_t expr, val_t envt, val_t nmspc)
   goto lbl_dispatch;
 
  lbl_halt:
+  prof_unwind(PDEPTH);
   return VAL;
 
  lbl_next:
@@ -128,7 +130,7 @@ val_t rsp_eval(val_t expr, val_t envt, val_t nmspc)
 
  lbl_do:
   save(RX_BODY | RX_NEXT);
-  BODY = cdr_(EXP);
+  BODY = cdr(EXP);
 
   goto lbl_seq_start;
 
@@ -165,9 +167,14 @@ val_t rsp_eval(val_t expr, val_t envt, val_t nmspc)
 
  lbl_funapp:
   save(CONTINUATION);
-  TMP[0] = car_(EXP);
-  TMP[1] = cdr_(EXP);
+  TMP[0] = car(EXP);
+  TMP[1] = cdr(EXP);
   EXP    = TMP[0];
+
+  // charge allocations from here on to the function being called (until CONTINUATION is restored)
+  if (unlikely(PROF_INTERVAL))
+    prof_call(issymbol(TMP[0]) ? ptr(symbol_t*,TMP[0])->name : "<anonymous>");
+
   NEXT   = LBL_OP_DONE;
   save(RX_TMP1 | NEXT);
 
@@ -1,4 +1,7 @@
 #include "rascal.h"
+#include "bignum.h"
+#include "rstr.h"
+#include "pairs.h"
 
 
 
@@ -6,7 +9,7 @@ val_t vm_load(FILE* f,val_t e)
 {
   val_t OSP = SP;
   val_t *envp = SAVE(e);
-  val_t *base = (&EVAL[SP+1]);
+  val_t base = SP + 1;
   size_t cnt = 0;
 
   while (!feof(f))
@@ -19,7 +22,7 @@ val_t vm_load(FILE* f,val_t e)
   // evaluate the saved expressions in the order they were read
   for (size_t i = 0; i < cnt; i++)
     {
-      rsp_eval(base[i],*envp);
+      rsp_eval(*stack_ref(base + i),*envp);
     }
 
   // restore the stack pointer and return
@@ -110,7 +113,7 @@ void prn_dvec(val_t v, FILE* f)
 
 void prn_int(val_t i, FILE* f)
 {
-  fprintf(f,"%d",toint_(i));
+  fprintf(f,"%" PRId64,ival(i));
   return;
 }
 
@@ -267,7 +270,7 @@ rsp_tok_t vm_get_token(FILE* f)
 val_t vm_read_expr(FILE* f)
 {
   rsp_tok_t tt = vm_get_token(f);
-  val_t expr, tl; int iexpr; float fexpr;
+  val_t expr; int64_t iexpr; double fexpr;
 
   switch (tt)
     {
@@ -278,21 +281,26 @@ val_t vm_read_expr(FILE* f)
       }
     case TOK_QUOT:
       {
+	// (quote expr) - mk_list roots the quoted expression while it allocates
 	take();
-	tl = vm_read_cons(f);
-	return vm_mk_cons(F_QUOTE,tl);
+	val_t q[2] = { F_QUOTE, vm_read_expr(f) };
+	return mk_list(q,2);
       }
     case TOK_INT:
       {
-	iexpr = atoi(TOKBUFF);
-	expr = vm_mk_int(iexpr);
+	// a sign on its own is a symbol
+	expr = stoi(TOKBUFF);
+
+	if (expr == R_EOF)
+	  expr = vm_mk_sym(TOKBUFF,0);
+
 	take();
 	return expr;
       }
     case TOK_FLOAT:
       {
-	fexpr = atof(TOKBUFF);
-	expr = vm_mk_float(fexpr);
+	fexpr = strtod(TOKBUFF,NULL);
+	expr = mk_float(fexpr);
 	take();
 	return expr;
       }
@@ -312,7 +320,7 @@ val_t vm_read_expr(FILE* f)
       }
     case TOK_STR:
       {
-	expr = vm_mk_str(TOKBUFF);
+	expr = mk_str(TOKBUFF);
 	take();
 	return expr;
       }
@@ -331,11 +339,15 @@ val_t vm_read_expr(FILE* f)
     }
 }
 
+/*
+   the elements are pushed as they're read, so the partial list is rooted by the stack (a
+   collection can happen while any later element is read), and mk_stack_list builds the list
+   from the stack, keeping the dotted tail rooted.
+ */
 val_t vm_read_cons(FILE* f)
 {
   size_t cnt = 0; rsp_tok_t c;
   val_t expr;
-  SAVESP;                      // save the current stack pointer
 
   while ((c = vm_get_token(f)) != TOK_RPAR && c != TOK_DOT)
     {
@@ -347,20 +359,17 @@ val_t vm_read_cons(FILE* f)
 	}
 
       expr = vm_read_expr(f);
-      PUSH(expr);
+      push(expr);
       cnt++;
     }
 
   if (c == TOK_RPAR)
     {
       take();
-      val_t ls = vm_mk_list(cnt);
-      init_list(ls,EVAL,cnt);
-      RESTORESP;               // restore the saved stack pointer
-      return ls;
+      return mk_stack_list(cnt,R_NIL);
     }
 
-  else // read the last expression, then begin consing up the dotted list
+  else // read the last expression, then cons up the dotted list
     {
       take();
       expr = vm_read_expr(f);
@@ -369,15 +378,7 @@ val_t vm_read_cons(FILE* f)
 
       if (c != TOK_RPAR) rsp_raise(SYNTAX_ERR);
 
-      val_t ca, cd = expr;
-
-      while (SP != __OSP__)
-	{
-	  ca = POP();
-	  cd = vm_mk_cons(ca,cd);
-	}
-
-      return cd;
+      return mk_stack_list(cnt,expr);
     }
 }
 